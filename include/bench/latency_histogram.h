@@ -0,0 +1,85 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * High-dynamic-range histogram of latencies (the HdrHistogram layout).
+ *
+ * Values from 1 to highestTrackable are recorded with a fixed relative
+ * precision of significantDigits decimal digits, in constant time and
+ * without allocating. Buckets cover successive powers of two, each split
+ * into the same number of linear sub-buckets, so a range of hours at
+ * microsecond resolution fits in a couple of hundred kilobytes.
+ *
+ * Units are up to the caller; http_load records microseconds.
+ */
+class LatencyHistogram {
+public:
+    /**
+     * Constructor
+     * @param highestTrackable Largest value recorded exactly; larger values are clamped
+     * @param significantDigits Relative precision, 1 to 5 (3 keeps values within 0.1%)
+     */
+    explicit LatencyHistogram(uint64_t highestTrackable = 3600ULL * 1000 * 1000, int significantDigits = 3);
+
+    /**
+     * Record a value
+     * @param value Value to record (0 is counted as 1)
+     * @param count Number of times to record it
+     */
+    void record(uint64_t value, uint64_t count = 1);
+
+    /**
+     * Record a value and back-fill the samples a stalled measurement missed.
+     * When a request that should have been issued every expectedInterval takes
+     * longer than that, the requests that would have been sent while it was
+     * outstanding saw value - expectedInterval, value - 2 * expectedInterval, ...
+     * of delay; those are recorded too (coordinated omission correction).
+     * @param value Value to record
+     * @param expectedInterval Expected time between samples; 0 disables correction
+     */
+    void recordCorrected(uint64_t value, uint64_t expectedInterval, uint64_t count = 1);
+
+    /**
+     * Copy of this histogram with every value re-recorded through recordCorrected()
+     */
+    LatencyHistogram corrected(uint64_t expectedInterval) const;
+
+    /**
+     * Merge another histogram with the same configuration into this one
+     */
+    void add(const LatencyHistogram& other);
+
+    void reset();
+
+    /**
+     * Value at or below which the given percentage of samples fall
+     * @param percentile 0 to 100
+     */
+    uint64_t valueAtPercentile(double percentile) const;
+
+    uint64_t getTotalCount() const { return totalCount; }
+    uint64_t getMin() const { return totalCount == 0 ? 0 : minValue; }
+    uint64_t getMax() const { return maxValue; }
+    double getMean() const;
+
+private:
+    uint64_t highestTrackable;
+    int significantDigits;
+    int subBucketHalfCountMagnitude;
+    uint64_t subBucketHalfCount;
+    uint64_t subBucketMask;
+    int leadingZeroCountBase;
+    std::vector<uint64_t> counts;
+    uint64_t totalCount;
+    uint64_t minValue;
+    uint64_t maxValue;
+
+    size_t indexOf(uint64_t value) const;
+    uint64_t valueAtIndex(size_t index) const;
+    uint64_t highestEquivalentValue(uint64_t value) const;
+};
+
+#endif // LATENCY_HISTOGRAM_H
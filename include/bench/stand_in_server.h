@@ -0,0 +1,87 @@
+#ifndef STAND_IN_SERVER_H
+#define STAND_IN_SERVER_H
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+/**
+ * Default shape of the responses served by StandInServer
+ */
+struct StandInOptions {
+    size_t responseSize;              // body bytes
+    bool chunked;                     // chunked transfer coding instead of Content-Length
+    size_t chunkSize;                 // payload bytes per chunk
+    bool keepAlive;                   // false closes the connection after each response
+    std::chrono::microseconds delay;  // artificial think time before each response
+
+    StandInOptions()
+        : responseSize(1024), chunked(false), chunkSize(4096), keepAlive(true), delay(0) {}
+};
+
+/**
+ * Minimal HTTP/1.1 server on 127.0.0.1 for reproducible loopback benchmarks.
+ *
+ * Every request is answered with a 200 whose body is responseSize bytes of
+ * filler. The defaults can be overridden per request with query parameters,
+ * e.g. "/?size=65536&chunked=1&delay_us=500&close=1&status=503". Pipelined
+ * requests are answered in order. Each connection is served by its own
+ * thread, which keeps the server simple and rarely the bottleneck for the
+ * concurrency levels benchmarks use.
+ */
+class StandInServer {
+public:
+    /**
+     * Constructor
+     * @param options Default response shape
+     */
+    explicit StandInServer(const StandInOptions& options = StandInOptions());
+
+    /**
+     * Destructor - stops the server
+     */
+    ~StandInServer();
+
+    StandInServer(const StandInServer&) = delete;
+    StandInServer& operator=(const StandInServer&) = delete;
+
+    /**
+     * Bind and start accepting connections
+     * @param port Port to listen on; 0 picks a free one (see getPort())
+     * @return false if the socket could not be bound
+     */
+    bool start(int port = 0);
+
+    /**
+     * Close the listener and every open connection, and wait for the threads to finish
+     */
+    void stop();
+
+    int getPort() const { return port; }
+    uint64_t getRequestsServed() const { return requestsServed.load(); }
+    uint64_t getConnectionsAccepted() const { return connectionsAccepted.load(); }
+
+private:
+    StandInOptions options;
+    int listenFd;
+    int port;
+    std::thread acceptThread;
+    std::atomic<bool> stopping;
+    std::atomic<uint64_t> requestsServed;
+    std::atomic<uint64_t> connectionsAccepted;
+
+    std::mutex mutex;
+    std::condition_variable connectionsDone;
+    std::set<int> openConnections;
+
+    void acceptLoop();
+    void serveConnection(int fd);
+    bool answer(int fd, const std::string& requestHead, bool& keepOpen);
+};
+
+#endif // STAND_IN_SERVER_H
@@ -0,0 +1,193 @@
+#ifndef ASYNC_CLIENT_H
+#define ASYNC_CLIENT_H
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <sys/socket.h>
+#include "processing/processing.h"
+#include "processing/timer_wheel.h"
+#include "request/response_reader.h"
+#include "socket/resolver.h"
+
+/**
+ * Event-driven HTTP client built on epoll and non-blocking sockets.
+ *
+ * Any number of requests can be submitted at once; a single thread drives
+ * all of their connections concurrently. Host names are resolved on the
+ * resolver's worker threads so lookups never stall the loop. Requests are formatted and
+ * responses parsed with the same code as SimpleHttpClient, and keep-alive
+ * connections are reused per origin.
+ *
+ * The loop is driven either by the caller (runOnce()/run()) or by a
+ * background thread (start()/stop()). submit() is safe to call from any
+ * thread; callbacks run on the thread driving the loop.
+ *
+ * Buffer and file request bodies are supported (files go out with
+ * sendfile as the socket drains); generator bodies are refused, and a
+ * request with expectContinue sends its body without waiting for 100 Continue.
+ *
+ * Request time limits (RequestTimeouts) are enforced by a timer wheel
+ * driven by the loop; the total limit runs from submit().
+ */
+class AsyncHttpClient {
+public:
+    typedef std::function<void(HttpResponse)> ResponseCallback;
+
+    /**
+     * Constructor
+     * @param maxConnections Upper bound on concurrently open sockets (default: 1024)
+     * @param resolver Resolver for host names (default: the process-wide resolver)
+     */
+    explicit AsyncHttpClient(size_t maxConnections = 1024,
+                             std::shared_ptr<DnsResolver> resolver = nullptr);
+
+    /**
+     * Destructor - stops the loop thread and fails any outstanding request
+     */
+    ~AsyncHttpClient();
+
+    AsyncHttpClient(const AsyncHttpClient&) = delete;
+    AsyncHttpClient& operator=(const AsyncHttpClient&) = delete;
+
+    /**
+     * Queue a request; the callback receives the response when it completes
+     * @param request The request to make
+     * @param callback Invoked exactly once on the loop thread
+     */
+    void submit(const HttpRequest& request, ResponseCallback callback);
+
+    /**
+     * Queue a request and get a future for its response.
+     * Something must drive the loop (start() or run()) for the future to become ready.
+     * @param request The request to make
+     * @return Future resolved with the response
+     */
+    std::future<HttpResponse> submit(const HttpRequest& request);
+
+    /**
+     * Process ready sockets once
+     * @param timeoutMs How long to wait for activity (-1 waits indefinitely)
+     * @return Number of requests completed during this call
+     */
+    size_t runOnce(int timeoutMs);
+
+    /**
+     * Drive the loop on the calling thread until every submitted request completed
+     */
+    void run();
+
+    /**
+     * Drive the loop on a background thread
+     */
+    void start();
+
+    /**
+     * Stop the background thread started by start()
+     */
+    void stop();
+
+    /**
+     * Number of requests submitted but not yet completed
+     */
+    size_t pendingCount() const;
+
+    /**
+     * Set the time limits of requests that leave them at zero (see RequestTimeouts).
+     * Not to be called while another thread submits.
+     * @param timeouts Default limits (initially none)
+     */
+    void setTimeouts(const RequestTimeouts& timeouts);
+
+    const RequestTimeouts& getTimeouts() const { return timeouts; }
+
+private:
+    enum class Phase { Connecting, Sending, Receiving, Idle };
+
+    struct Connection {
+        int sockfd = -1;
+        Phase phase = Phase::Connecting;
+        std::string origin;
+        bool reused = false;
+        std::vector<ResolvedAddress> addresses;  // connect candidates, port filled in
+        size_t nextAddress = 0;
+        HttpRequest request;
+        ResponseCallback callback;
+        OutgoingRequest outgoing;  // points into request; rebuilt whenever request changes
+        size_t sent = 0;
+        ResponseReader reader;
+        RequestTimeouts limits;
+        TimerWheel::Clock::time_point deadline = TimerWheel::Clock::time_point::max();         // of the whole request
+        TimerWheel::Clock::time_point connectDeadline = TimerWheel::Clock::time_point::max();  // of lookup and handshake
+        TimerWheel::Timer timer;  // armed for whichever limit of the current phase runs out first
+        uint64_t resolveId = 0;
+    };
+
+    struct PendingRequest {
+        HttpRequest request;
+        ResponseCallback callback;
+        RequestTimeouts limits;
+        TimerWheel::Clock::time_point deadline;
+    };
+
+    // Lookups complete on resolver threads; results are handed to the loop
+    // through this inbox, which outlives the client if a lookup is still running.
+    struct ResolveInbox {
+        std::mutex mutex;
+        std::deque<std::pair<uint64_t, ResolveResult>> results;
+        int wakeFd = -1;
+        bool closed = false;
+    };
+
+    size_t maxConnections;
+    int epollFd;
+    int wakeFd;
+    SimpleHttpClient formatter;  // shared request formatting / response parsing
+    std::shared_ptr<DnsResolver> resolver;
+    std::shared_ptr<ResolveInbox> inbox;
+
+    mutable std::mutex queueMutex;
+    std::deque<PendingRequest> queue;
+    std::atomic<size_t> outstanding;
+    RequestTimeouts timeouts;
+
+    TimerWheel timers;  // outlives the connections whose timers it holds
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+    std::map<std::string, std::vector<int>> idleConnections;  // origin -> keep-alive sockets
+    std::unordered_map<uint64_t, std::unique_ptr<Connection>> resolving;  // waiting on DNS
+    uint64_t nextResolveId;
+
+    std::thread loopThread;
+    std::atomic<bool> running;
+
+    size_t completedCount;  // requests finished during the current runOnce()
+
+    void startQueuedRequests();
+    void startRequest(PendingRequest pending);
+    void deliverResolved();
+    void connectNext(std::unique_ptr<Connection> connection);
+    void handleEvent(int sockfd, uint32_t events);
+    void handleConnecting(int sockfd);
+    void handleWritable(int sockfd);
+    void handleReadable(int sockfd);
+    void completeRequest(int sockfd, HttpResponse response, bool reusable);
+    void failRequest(int sockfd, const std::string& errorMessage, HttpError errorKind);
+    void armTimer(Connection& connection);
+    void timeOut(Connection& connection);
+    bool retryOnFreshConnection(int sockfd);
+    void watch(int sockfd, uint32_t events, bool add);
+    void closeConnection(int sockfd);
+    bool evictIdleConnection();
+};
+
+#endif // ASYNC_CLIENT_H
@@ -0,0 +1,147 @@
+#ifndef CONNECTION_POOL_H
+#define CONNECTION_POOL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Counters describing how well the pool is reusing connections
+ */
+struct PoolStats {
+    uint64_t hits;       // acquire() returned an idle keep-alive socket
+    uint64_t misses;     // acquire() found nothing reusable; caller opened a new socket
+    uint64_t evictions;  // idle sockets closed because they expired, went stale or overflowed
+
+    PoolStats() : hits(0), misses(0), evictions(0) {}
+};
+
+/**
+ * Per-origin (host, port) pool of idle HTTP/1.1 keep-alive sockets.
+ *
+ * A connection slot is taken by acquire() and handed back with release().
+ * acquire() returns an idle socket when one is available, otherwise -1,
+ * in which case a slot has been reserved and the caller is expected to open
+ * a new connection itself. Every acquire() must be paired with exactly one
+ * release(), including when the new connection could not be established
+ * (pass -1 as the socket in that case).
+ *
+ * The pool is safe to use from several threads.
+ */
+class ConnectionPool {
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct IdleConnection {
+        int sockfd;
+        Clock::time_point idleSince;
+    };
+
+    struct HostEntry {
+        std::vector<IdleConnection> idle;  // most recently released at the back
+        size_t openCount = 0;              // idle + checked-out sockets
+    };
+
+    size_t maxConnectionsPerHost;
+    std::chrono::milliseconds idleTimeout;
+
+    mutable std::mutex mutex;
+    std::condition_variable slotAvailable;
+    std::map<std::pair<std::string, int>, HostEntry> hosts;
+    PoolStats stats;
+
+    bool takeLocked(HostEntry& entry, int& sockfd);
+    bool isExpired(const IdleConnection& connection, Clock::time_point now) const;
+    static bool isStale(int sockfd);
+    void evictLocked(HostEntry& entry, size_t index);
+
+public:
+    /**
+     * Constructor
+     * @param maxConnectionsPerHost Upper bound on open sockets per origin (default: 6)
+     * @param idleTimeout How long an idle socket may sit in the pool (default: 30s)
+     */
+    explicit ConnectionPool(size_t maxConnectionsPerHost = 6,
+                            std::chrono::milliseconds idleTimeout = std::chrono::seconds(30));
+
+    /**
+     * Destructor - closes every idle socket still held by the pool
+     */
+    ~ConnectionPool();
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    /**
+     * Take a connection slot for the given origin.
+     * Blocks while the origin is at its connection cap.
+     * @param hostname The origin hostname
+     * @param port The origin port
+     * @return An idle, live socket, or -1 if the caller must connect itself
+     */
+    int acquire(const std::string& hostname, int port);
+
+    /**
+     * Take a connection slot for the given origin, waiting no later than a deadline
+     * while the origin is at its connection cap
+     * @param hostname The origin hostname
+     * @param port The origin port
+     * @param deadline When to stop waiting (time_point::max() waits indefinitely)
+     * @param sockfd Receives an idle, live socket, or -1 if the caller must connect itself
+     * @return false, with no slot taken, if the deadline passed first
+     */
+    bool acquire(const std::string& hostname, int port, std::chrono::steady_clock::time_point deadline,
+                 int& sockfd);
+
+    /**
+     * Take a connection slot for the given origin without waiting
+     * @param hostname The origin hostname
+     * @param port The origin port
+     * @param sockfd Receives an idle, live socket, or -1 if the caller must connect itself
+     * @return false, with no slot taken, if the origin is at its connection cap
+     */
+    bool tryAcquire(const std::string& hostname, int port, int& sockfd);
+
+    /**
+     * Give a connection slot back to the pool
+     * @param hostname The origin hostname
+     * @param port The origin port
+     * @param sockfd The socket to return, or -1 if no connection was made
+     * @param reusable true to keep the socket idle for reuse, false to close it
+     */
+    void release(const std::string& hostname, int port, int sockfd, bool reusable);
+
+    /**
+     * Close idle sockets that have outlived the idle timeout
+     */
+    void pruneExpired();
+
+    /**
+     * Close every idle socket held by the pool
+     */
+    void closeIdle();
+
+    /**
+     * Number of idle sockets currently pooled for an origin
+     */
+    size_t idleCount(const std::string& hostname, int port) const;
+
+    /**
+     * Snapshot of the reuse counters
+     */
+    PoolStats getStats() const;
+
+    void setMaxConnectionsPerHost(size_t maxConnectionsPerHost);
+    size_t getMaxConnectionsPerHost() const;
+
+    void setIdleTimeout(std::chrono::milliseconds idleTimeout);
+    std::chrono::milliseconds getIdleTimeout() const;
+};
+
+#endif // CONNECTION_POOL_H
@@ -0,0 +1,179 @@
+#ifndef CORO_CLIENT_H
+#define CORO_CLIENT_H
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "processing/io_scheduler.h"
+#include "processing/processing.h"
+#include "processing/task.h"
+#include "processing/transport.h"
+#include "request/response_reader.h"
+#include "socket/resolver.h"
+
+/**
+ * HTTP client whose operations are coroutines driven by an IoScheduler.
+ *
+ * Every step suspends on socket readiness instead of blocking a thread, so
+ * one scheduler thread can keep tens of thousands of requests in flight:
+ *
+ *     Task<void> fetch(CoroHttpClient& client) {
+ *         std::vector<Task<HttpResponse>> pages;
+ *         pages.push_back(client.get("example.com/a"));
+ *         pages.push_back(client.get("example.com/b"));
+ *         std::vector<HttpResponse> responses = co_await whenAll(std::move(pages));
+ *         ...
+ *     }
+ *     scheduler.run(fetch(client));
+ *
+ * Requests are formatted and responses parsed as by SimpleHttpClient,
+ * redirects are followed the same way and keep-alive connections are reused
+ * per origin. Bytes move through a Transport: io_uring where the kernel
+ * supports it, the scheduler's epoll otherwise (see Transport::create).
+ * Each operation takes a CancellationToken; a cancelled
+ * request closes its socket and fails with "Request cancelled". A host name
+ * lookup in progress is abandoned, not interrupted: its thread finishes it.
+ *
+ * Request time limits (RequestTimeouts) are timers on the scheduler's
+ * wheel that cancel the request's operations when they run out; the
+ * request then fails with HttpError::Timeout.
+ *
+ * Buffer and file bodies are supported; generator bodies are refused, and
+ * expectContinue is ignored (the body follows the headers at once). There
+ * is no response cache.
+ *
+ * The client belongs to the scheduler's thread, and the scheduler must
+ * outlive it.
+ */
+class CoroHttpClient {
+public:
+    /**
+     * Constructor
+     * @param scheduler The loop the client's coroutines run on
+     * @param resolver Resolver for host names (default: the process-wide resolver)
+     * @param maxRedirects Maximum number of redirects to follow (default: 5)
+     * @param transport Moves the bytes (default: Transport::create(scheduler)); must use the same scheduler
+     */
+    explicit CoroHttpClient(IoScheduler& scheduler, std::shared_ptr<DnsResolver> resolver = nullptr,
+                            int maxRedirects = 5, std::shared_ptr<Transport> transport = nullptr);
+
+    /**
+     * Destructor - closes idle keep-alive sockets
+     */
+    ~CoroHttpClient();
+
+    CoroHttpClient(const CoroHttpClient&) = delete;
+    CoroHttpClient& operator=(const CoroHttpClient&) = delete;
+
+    /**
+     * Resolve a host and connect to its addresses in turn
+     * @param hostname The hostname to connect to
+     * @param port The port number to connect to
+     * @param token Cancels the connect
+     * @return A connected non-blocking socket, or -1
+     */
+    Task<int> connect(std::string hostname, int port, CancellationToken token = CancellationToken());
+
+    /**
+     * Write a serialized request and its body
+     * @param sockfd A connected non-blocking socket
+     * @param request Built with buildRequest(); must outlive the task
+     * @param body The request's body (sent after request when request.bodyFollows()); must outlive the task
+     * @param token Cancels the write
+     * @return true once every byte is written
+     */
+    Task<bool> send(int sockfd, const OutgoingRequest& request, const RequestBody& body,
+                    CancellationToken token = CancellationToken());
+
+    /**
+     * Read one response into reader (like readHttpResponse)
+     * @param sockfd A connected non-blocking socket
+     * @param reader Receives the response; must outlive the task
+     * @param pending Bytes read past the end of the response; must outlive the task
+     * @param token Cancels the read
+     * @return true once the response is complete
+     */
+    Task<bool> receive(int sockfd, ResponseReader& reader, std::string& pending,
+                       CancellationToken token = CancellationToken());
+
+    /**
+     * Make a request, following redirects like SimpleHttpClient::makeHttpRequest
+     * @param request The request to make
+     * @param token Cancels the request
+     * @return The final response, with the hops followed in redirectChain
+     */
+    Task<HttpResponse> makeHttpRequest(HttpRequest request, CancellationToken token = CancellationToken());
+
+    /**
+     * GET a URL (same format as SimpleHttpClient::get)
+     * @param url The URL to fetch
+     * @param token Cancels the request
+     * @return The response
+     */
+    Task<HttpResponse> get(std::string url, CancellationToken token = CancellationToken());
+
+    /**
+     * Serialize a request (see SimpleHttpClient::buildRequest)
+     */
+    void buildRequest(const HttpRequest& request, OutgoingRequest& out);
+
+    /**
+     * Close every idle keep-alive socket
+     */
+    void closeIdle();
+
+    /**
+     * Number of idle keep-alive sockets held for an origin
+     */
+    size_t idleCount(const std::string& hostname, int port) const;
+
+    void setMaxRedirects(int maxRedirects);
+    int getMaxRedirects() const;
+
+    /**
+     * Set the time limits of requests that leave them at zero (see RequestTimeouts)
+     * @param timeouts Default limits (initially none)
+     */
+    void setTimeouts(const RequestTimeouts& timeouts);
+    const RequestTimeouts& getTimeouts() const;
+
+    /**
+     * The transport the client's sockets use
+     */
+    std::shared_ptr<Transport> getTransport() const;
+
+private:
+    // Lookups finish on resolver threads; they only post back while the client is alive
+    struct ResolveInbox {
+        std::mutex mutex;
+        IoScheduler* scheduler;
+    };
+
+    IoScheduler& scheduler;
+    std::shared_ptr<Transport> transport;
+    std::shared_ptr<DnsResolver> resolver;
+    std::shared_ptr<ResolveInbox> inbox;
+    SimpleHttpClient formatter;  // shared request formatting / response parsing
+    int maxRedirects;
+    RequestTimeouts timeouts;
+    std::map<std::string, std::vector<int>> idleConnections;  // origin -> keep-alive sockets
+    std::vector<char> receiveBuffer;  // only used between suspension points, so one per client
+
+    Task<int> openConnection(std::string hostname, int port, CancellationToken token, RequestTiming& timing,
+                             HttpError& error);
+    Task<HttpResponse> performRequest(const HttpRequest& request, CancellationToken token,
+                                      TimerWheel::Clock::time_point deadline);
+    Task<bool> sendWatched(int sockfd, const OutgoingRequest& request, const RequestBody& body,
+                           CancellationToken token, const std::function<void()>& progress);
+    Task<bool> receiveWatched(int sockfd, ResponseReader& reader, std::string& pending,
+                              CancellationToken token, const std::function<void()>& progress);
+    int takeIdle(const std::string& origin);
+    void release(const std::string& origin, int sockfd, bool reusable);
+    void closeSocket(int sockfd);
+};
+
+#endif // CORO_CLIENT_H
@@ -0,0 +1,145 @@
+#ifndef FETCH_POOL_H
+#define FETCH_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "processing/processing.h"
+
+/**
+ * Counters describing how a FetchPool spread its work
+ */
+struct FetchStats {
+    uint64_t completed;  // requests finished (successfully or not)
+    uint64_t steals;     // requests a worker took from another worker's queue
+    uint64_t deferred;   // requests held back because their origin was at its cap
+
+    FetchStats() : completed(0), steals(0), deferred(0) {}
+};
+
+/**
+ * Runs batches of blocking requests on a work-stealing thread pool.
+ *
+ * A batch is dealt round-robin onto per-worker queues. A worker takes its
+ * own requests from the front of its queue and, once it runs dry, steals
+ * from the back of the others', so one slow origin does not leave the
+ * remaining threads idle. Each worker makes its requests through its own
+ * copy of the client with a private connection pool: keep-alive sockets
+ * stay with the thread that opened them and workers never contend on a
+ * pool lock. The response cache and resolver are shared with the client.
+ *
+ * At most maxPerHost requests to one origin run at once across all
+ * workers; a request over the cap is parked and picked up by the worker
+ * that finishes the next request to that origin.
+ *
+ * fetchAll() may be called from several threads at once.
+ */
+class FetchPool {
+public:
+    typedef std::function<void(size_t index, HttpResponse& response)> CompletionCallback;
+
+    /**
+     * Constructor
+     * @param client Client whose settings the workers copy (redirects, headers, cache, resolver...)
+     * @param threads Number of worker threads (default: 0, one per CPU)
+     * @param maxPerHost Requests in flight per origin (default: 0, the client pool's per-host cap)
+     */
+    explicit FetchPool(const SimpleHttpClient& client, size_t threads = 0, size_t maxPerHost = 0);
+
+    /**
+     * Destructor - waits for running requests and stops the workers
+     */
+    ~FetchPool();
+
+    FetchPool(const FetchPool&) = delete;
+    FetchPool& operator=(const FetchPool&) = delete;
+
+    /**
+     * Make every request (following redirects) and wait for them all
+     * @param requests The requests to make
+     * @return One response per request, in input order
+     */
+    std::vector<HttpResponse> fetchAll(const std::vector<HttpRequest>& requests);
+
+    /**
+     * Make every request, handing each response over as soon as it completes.
+     * Returns once the last callback has returned.
+     * @param requests The requests to make
+     * @param onComplete Called on a worker thread with the request's index and its response
+     */
+    void fetchAll(const std::vector<HttpRequest>& requests, const CompletionCallback& onComplete);
+
+    /**
+     * GET every URL (same URL format as SimpleHttpClient::get)
+     * @param urls The URLs to fetch
+     * @return One response per URL, in input order
+     */
+    std::vector<HttpResponse> getMany(const std::vector<std::string>& urls);
+
+    size_t getThreadCount() const { return workers.size(); }
+    size_t getMaxPerHost() const { return maxPerHost; }
+
+    /**
+     * Snapshot of the counters
+     */
+    FetchStats getStats() const;
+
+private:
+    struct Batch;
+
+    struct Task {
+        Batch* batch;
+        size_t index;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> queue;  // own work taken from the front, stolen from the back
+        SimpleHttpClient client;
+        std::thread thread;
+
+        explicit Worker(const SimpleHttpClient& client) : client(client) {}
+    };
+
+    typedef std::pair<std::string, int> Origin;
+
+    struct HostSlots {
+        size_t active = 0;
+        std::deque<Task> parked;
+    };
+
+    size_t maxPerHost;
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    std::mutex sleepMutex;
+    std::condition_variable workAvailable;
+    std::atomic<size_t> queued;  // tasks sitting in worker queues
+    bool stopping;
+
+    std::mutex hostMutex;
+    std::map<Origin, HostSlots> hosts;
+
+    std::atomic<size_t> nextWorker;
+    std::atomic<uint64_t> completedCount;
+    std::atomic<uint64_t> stealCount;
+    std::atomic<uint64_t> deferredCount;
+
+    void run(Batch& batch);
+    void workerLoop(size_t id);
+    bool takeTask(size_t id, Task& task);
+    bool enterHost(const Origin& origin, const Task& task);
+    bool leaveHost(const Origin& origin, Task& next);
+    void runTask(Worker& worker, const Task& task);
+};
+
+#endif // FETCH_POOL_H
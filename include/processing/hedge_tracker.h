@@ -0,0 +1,115 @@
+#ifndef HEDGE_TRACKER_H
+#define HEDGE_TRACKER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * When a slow request gets a second copy (see SimpleHttpClient::setHedgePolicy)
+ */
+struct HedgePolicy {
+    bool enabled;
+    std::chrono::milliseconds delay;  // wait this long for a first byte before hedging (0: adaptive)
+    double percentile;                // adaptive delay: this percentile of the origin's first-byte latency
+    size_t minSamples;                // adaptive delay: latencies an origin needs before it is hedged
+    double budget;                    // hedges allowed per request, e.g. 0.05 for at most 5% extra
+
+    HedgePolicy() : enabled(false), delay(0), percentile(0.95), minSamples(20), budget(0.05) {}
+};
+
+/**
+ * Counters describing how hedging is doing
+ */
+struct HedgeStats {
+    uint64_t requests;  // requests that could be hedged
+    uint64_t sent;      // hedges sent
+    uint64_t won;       // hedges whose response was used; the original was cancelled
+    uint64_t denied;    // hedges not sent because the budget was spent
+
+    HedgeStats() : requests(0), sent(0), won(0), denied(0) {}
+};
+
+/**
+ * Shared state behind hedged requests: first-byte latency per origin and
+ * the hedge budget.
+ *
+ * The budget is a token bucket. Every hedgeable request adds budget tokens
+ * and every hedge takes one, so hedges stay within that fraction of the
+ * traffic; up to kMaxBurst unused hedges are saved for a bad spell.
+ *
+ * Latencies are kept for the last kWindow requests of each origin. The
+ * percentile is recomputed every kRefresh samples, not on every request.
+ *
+ * The tracker is safe to use from several threads.
+ */
+class HedgeTracker {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static constexpr size_t kWindow = 256;
+    static constexpr size_t kRefresh = 16;
+    static constexpr double kMaxBurst = 10.0;
+
+    /**
+     * Constructor
+     * @param policy Delay and budget to apply
+     */
+    explicit HedgeTracker(const HedgePolicy& policy);
+
+    HedgeTracker(const HedgeTracker&) = delete;
+    HedgeTracker& operator=(const HedgeTracker&) = delete;
+
+    const HedgePolicy& getPolicy() const { return policy; }
+
+    /**
+     * Count a hedgeable request against the budget and say when to hedge it
+     * @param origin "host:port"
+     * @return How long to wait for a first byte before hedging, or
+     *         milliseconds::max() if the origin has too few samples yet
+     */
+    std::chrono::milliseconds startRequest(const std::string& origin);
+
+    /**
+     * Take a hedge from the budget
+     * @return false if the budget is spent (counted as denied)
+     */
+    bool tryHedge();
+
+    /**
+     * Record the first-byte latency seen by a hedgeable request
+     * @param origin "host:port"
+     * @param latency From the request written to the first response byte
+     */
+    void recordLatency(const std::string& origin, Clock::duration latency);
+
+    void recordSent();
+    void recordWon();
+
+    /**
+     * Snapshot of the counters
+     */
+    HedgeStats getStats() const;
+
+private:
+    struct OriginLatency {
+        std::vector<Clock::duration> samples;  // ring of the last kWindow latencies
+        size_t next = 0;
+        size_t sinceRefresh = 0;
+        std::chrono::milliseconds delay = std::chrono::milliseconds::max();
+    };
+
+    HedgePolicy policy;
+    mutable std::mutex mutex;
+    std::map<std::string, OriginLatency> origins;
+    double tokens;
+    HedgeStats stats;
+
+    void refresh(OriginLatency& origin);
+};
+
+#endif // HEDGE_TRACKER_H
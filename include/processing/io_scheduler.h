@@ -0,0 +1,285 @@
+#ifndef IO_SCHEDULER_H
+#define IO_SCHEDULER_H
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "processing/task.h"
+#include "processing/timer_wheel.h"
+
+/**
+ * Single-threaded event loop that resumes coroutines on socket readiness.
+ *
+ * Coroutines suspend with co_await readable(fd) / writable(fd) /
+ * sleepFor(...) and are resumed by runOnce() once epoll reports the socket
+ * ready or the timer expires. Each wait takes an optional
+ * CancellationToken; a cancelled wait resumes at once and returns false.
+ *
+ * Only post() may be called from other threads. To spread work over
+ * several cores, run one scheduler (and one CoroHttpClient) per thread.
+ */
+class IoScheduler {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * Awaitable returned by readable() and writable()
+     * @return (from co_await) true once the socket is ready, false if cancelled
+     */
+    class IoAwaiter {
+    public:
+        IoAwaiter(IoScheduler& scheduler, int sockfd, bool write, CancellationToken token)
+            : scheduler(scheduler), sockfd(sockfd), write(write), token(std::move(token)), cancelled(false) {}
+
+        bool await_ready() const noexcept { return token.isCancelled(); }
+        void await_suspend(std::coroutine_handle<> handle);
+        bool await_resume() noexcept { return !cancelled && !token.isCancelled(); }
+
+    private:
+        friend class IoScheduler;
+
+        IoScheduler& scheduler;
+        int sockfd;
+        bool write;
+        CancellationToken token;
+        CancellationRegistration registration;
+        std::coroutine_handle<> handle;
+        bool cancelled;
+    };
+
+    /**
+     * Awaitable returned by sleepFor()
+     * @return (from co_await) true once the time has passed, false if cancelled
+     */
+    class SleepAwaiter {
+    public:
+        SleepAwaiter(IoScheduler& scheduler, Clock::time_point deadline, CancellationToken token)
+            : scheduler(scheduler), deadline(deadline), token(std::move(token)), cancelled(false) {}
+
+        bool await_ready() const noexcept { return token.isCancelled(); }
+        void await_suspend(std::coroutine_handle<> handle);
+        bool await_resume() noexcept { return !cancelled && !token.isCancelled(); }
+
+    private:
+        friend class IoScheduler;
+
+        IoScheduler& scheduler;
+        Clock::time_point deadline;
+        CancellationToken token;
+        CancellationRegistration registration;
+        std::coroutine_handle<> handle;
+        TimerWheel::Timer timer;
+        bool cancelled;
+    };
+
+    /**
+     * Awaitable returned by schedule(): resumes the coroutine from the loop
+     * on the scheduler's thread (also a way to hop onto that thread)
+     */
+    class ScheduleAwaiter {
+    public:
+        explicit ScheduleAwaiter(IoScheduler& scheduler) : scheduler(scheduler) {}
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { scheduler.post(handle); }
+        void await_resume() noexcept {}
+
+    private:
+        IoScheduler& scheduler;
+    };
+
+    /**
+     * A source of completions other than socket readiness (e.g. an
+     * io_uring) that the loop drives alongside its sockets
+     */
+    class Poller {
+    public:
+        virtual ~Poller() {}
+
+        /**
+         * Called each round before the loop waits: submit the work queued so far
+         */
+        virtual void flush() = 0;
+
+        /**
+         * Called when the poller's descriptor is readable: wake() the
+         * coroutines whose work completed
+         */
+        virtual void poll() = 0;
+    };
+
+    IoScheduler();
+
+    /**
+     * Destructor - destroys spawned tasks that have not finished
+     */
+    ~IoScheduler();
+
+    IoScheduler(const IoScheduler&) = delete;
+    IoScheduler& operator=(const IoScheduler&) = delete;
+
+    /**
+     * Wait until a socket can be read (or has hung up)
+     * @param sockfd A non-blocking socket; only one coroutine may wait to read it at a time
+     */
+    IoAwaiter readable(int sockfd, CancellationToken token = CancellationToken()) {
+        return IoAwaiter(*this, sockfd, false, std::move(token));
+    }
+
+    /**
+     * Wait until a socket can be written (or a connect finished)
+     * @param sockfd A non-blocking socket; only one coroutine may wait to write it at a time
+     */
+    IoAwaiter writable(int sockfd, CancellationToken token = CancellationToken()) {
+        return IoAwaiter(*this, sockfd, true, std::move(token));
+    }
+
+    SleepAwaiter sleepFor(std::chrono::milliseconds duration, CancellationToken token = CancellationToken()) {
+        return SleepAwaiter(*this, Clock::now() + duration, std::move(token));
+    }
+
+    ScheduleAwaiter schedule() { return ScheduleAwaiter(*this); }
+
+    /**
+     * Timers checked every round (sleepFor() uses them too). Loop thread
+     * only; callbacks run on it before the round's coroutines resume.
+     */
+    TimerWheel& getTimers() { return timers; }
+
+    /**
+     * Stop watching a socket; call before closing it
+     */
+    void forget(int sockfd);
+
+    /**
+     * Drive a poller from this loop until removePoller()
+     * @param fd Descriptor that becomes readable when the poller has completions
+     */
+    void addPoller(int fd, Poller& poller);
+    void removePoller(int fd);
+
+    /**
+     * Resume a suspended coroutine in the current round. Loop thread only
+     * (post() from other threads).
+     */
+    void wake(std::coroutine_handle<> handle) { ready.push_back(handle); }
+
+    /**
+     * Run a task in the background; it is destroyed when it finishes
+     */
+    void spawn(Task<void> task);
+
+    /**
+     * Queue work for the loop thread. Safe to call from any thread.
+     */
+    void post(std::function<void()> work);
+    void post(std::coroutine_handle<> handle);
+
+    /**
+     * Wait for readiness, expired timers or posted work once and resume
+     * the coroutines concerned
+     * @param timeoutMs How long to wait when nothing is ready (-1 waits indefinitely)
+     * @return Number of coroutines resumed
+     */
+    size_t runOnce(int timeoutMs);
+
+    /**
+     * Drive the loop until every spawned task finished
+     */
+    void run();
+
+    /**
+     * Drive the loop until a task finished and return its result
+     */
+    template <typename T>
+    T run(Task<T> task) {
+        std::optional<T> result;
+        bool finished = false;
+        spawn(capture(std::move(task), result, finished));
+        while (!finished) {
+            runOnce(-1);
+        }
+        return std::move(*result);
+    }
+
+    void run(Task<void> task) {
+        bool finished = false;
+        spawn(signal(std::move(task), finished));
+        while (!finished) {
+            runOnce(-1);
+        }
+    }
+
+    /**
+     * Number of spawned tasks not yet finished
+     */
+    size_t pendingCount() const { return spawned.size(); }
+
+private:
+    // Waiters are the awaiters themselves, which live in the suspended
+    // coroutines' frames until they are resumed
+    struct Watch {
+        IoAwaiter* reader = nullptr;
+        IoAwaiter* writer = nullptr;
+        uint32_t registered = 0;  // events epoll currently reports for the socket
+        bool added = false;
+    };
+
+    int epollFd;
+    int wakeFd;
+    std::unordered_map<int, Watch> watches;
+    std::unordered_map<int, Poller*> pollers;
+    TimerWheel timers;
+    std::deque<std::coroutine_handle<>> ready;
+
+    std::mutex postMutex;
+    std::vector<std::function<void()>> posted;
+
+    // Owns a spawned task; its frame goes away as soon as the task finishes
+    class Detached {
+    public:
+        struct promise_type {
+            Detached get_return_object() {
+                return Detached(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+
+        explicit Detached(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    uint64_t nextSpawnId;
+    std::unordered_map<uint64_t, std::coroutine_handle<>> spawned;  // unfinished detached drivers
+
+    void watch(IoAwaiter& waiter);
+    void unwatch(IoAwaiter& waiter);
+    static uint32_t interestOf(const Watch& entry);
+    void update(int sockfd, Watch& entry);
+    void runPosted();
+    Detached detach(Task<void> task, uint64_t id);
+
+    template <typename T>
+    static Task<void> capture(Task<T> task, std::optional<T>& result, bool& finished) {
+        result.emplace(co_await task);
+        finished = true;
+    }
+
+    static Task<void> signal(Task<void> task, bool& finished) {
+        co_await task;
+        finished = true;
+    }
+};
+
+#endif // IO_SCHEDULER_H
@@ -1,39 +1,127 @@
 #ifndef PROCESSING_H
 #define PROCESSING_H
 
+#include <chrono>
 #include <string>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string_view>
 #include <vector>
+#include "processing/connection_pool.h"
+#include "processing/hedge_tracker.h"
+#include "processing/response_cache.h"
+#include "processing/response_view.h"
+#include "request/body_sink.h"
+#include "request/http_response.h"
+#include "request/request_builder.h"
+#include "request/response_reader.h"
+#include "socket/resolver.h"
+#include "socket/socket.h"
 
 /**
- * Structure to hold parsed HTTP response data
+ * How long a request may take; a zero duration means no limit.
+ * A request that runs out of time fails with HttpError::Timeout.
  */
-struct HttpResponse {
-    std::string httpVersion;    // e.g., "HTTP/1.1"
-    int statusCode;            // e.g., 200, 404, 500
-    std::string reasonPhrase;  // e.g., "OK", "Not Found"
-    std::map<std::string, std::string> headers;
-    std::string body;
-    bool isSuccess;
-    std::string errorMessage;
+struct RequestTimeouts {
+    std::chrono::milliseconds total;      // the whole request, redirects and retries included
+    std::chrono::milliseconds connect;    // host lookup and TCP handshake of each new connection
+    std::chrono::milliseconds firstByte;  // from the request written to the first response byte
+    std::chrono::milliseconds idle;       // longest wait for a write or read to make progress
+                                          // (also for the first byte when firstByte is zero)
+
+    RequestTimeouts() : total(0), connect(0), firstByte(0), idle(0) {}
+
+    /**
+     * These limits, with the ones left at zero taken from defaults
+     */
+    RequestTimeouts withDefaults(const RequestTimeouts& defaults) const {
+        RequestTimeouts merged = *this;
+        merged.total = total.count() != 0 ? total : defaults.total;
+        merged.connect = connect.count() != 0 ? connect : defaults.connect;
+        merged.firstByte = firstByte.count() != 0 ? firstByte : defaults.firstByte;
+        merged.idle = idle.count() != 0 ? idle : defaults.idle;
+        return merged;
+    }
+};
+
+/**
+ * Description of a request to be made by one of the clients
+ */
+struct HttpRequest {
+    std::string hostname;
+    std::string path;
+    int port;
+    std::string method;
+    HeaderList headers;  // sent after the client's default headers (same name replaces a default)
+    RequestBody body;    // buffer, file (sendfile) or generator (chunked)
+    bool expectContinue; // send Expect: 100-continue and hold the body until the server agrees
+    RequestTimeouts timeouts;  // limits left at zero come from the client's setTimeouts()
     
     // Constructor
-    HttpResponse() : statusCode(0), isSuccess(false) {}
+    HttpRequest(const std::string& hostname = "", const std::string& path = "/",
+                int port = 80, const std::string& method = "GET")
+        : hostname(hostname), path(path), port(port), method(method), expectContinue(false) {}
 };
 
 /**
  * Simple HTTP client for making HTTP requests
  * Supports GET requests, response parsing, and error handling
+ *
+ * One client may be shared between threads: the request methods
+ * (makeHttpRequest, get, streamHttpRequest, makePipelinedRequests...) can
+ * run concurrently, since the connection pool, resolver and response cache
+ * are thread-safe and the header templates are built under a lock. The
+ * setters are not synchronized; configure the client before sharing it.
+ * See FetchPool (and getMany/fetchAll) for running many requests in parallel.
  */
 class SimpleHttpClient {
 private:
+    struct TemplateCache {
+        std::mutex mutex;
+        std::map<std::string, RequestTemplate> templates;  // origin -> prebuilt header block
+    };
+    
     int maxRedirects;
+    std::shared_ptr<ConnectionPool> connectionPool;  // shared between copies of the client
+    std::shared_ptr<DnsResolver> resolver;
+    ConnectOptions connectOptions;
+    size_t pipelineDepth;
+    std::set<std::string> pipeliningDisabledHosts;
+    size_t streamingThreshold;
+    HeaderList defaultHeaders;
+    int continueTimeoutMs;
+    RequestTimeouts timeouts;  // for the limits a request leaves at zero
+    std::shared_ptr<ResponseCache> responseCache;  // optional; shared between copies of the client
+    std::shared_ptr<HedgeTracker> hedging;  // optional; shared between copies of the client
+    std::shared_ptr<TemplateCache> requestTemplates;  // shared between copies until setDefaultHeaders()
     
     // Private helper methods
-    bool parseStatusLine(const std::string& line, HttpResponse& response);
-    void parseHeaderLine(const std::string& line, HttpResponse& response);
-    bool isChunkedEncoding(const std::string& headerSection);
-    std::string decodeChunkedBody(const std::string& chunkedBody);
+    HttpResponse parseRawResponse(const std::string& rawResponse, bool bodyDechunked);
+    bool parseStatusLine(std::string_view line, HttpResponse& response);
+    void parseHeaderLine(std::string_view line, HttpResponse& response);
+    bool isChunkedEncoding(const HttpResponse& response);
+    bool decodeChunkedBody(std::string& body, HttpResponse& response);
+    bool decodeContentEncoding(HttpResponse& response);
+    std::string receiveHttpResponse(int sockfd, const std::string& method, bool& keepAlive);
+    int openConnection(const std::string& hostname, int port, RequestTiming& timing,
+                       RequestTiming::Clock::time_point deadline, HttpError& error);
+    const RequestTemplate& requestTemplateFor(const std::string& hostname, int port);
+    HttpResponse performRequest(const HttpRequest& request, ResponseReader& reader,
+                                RequestTiming::Clock::time_point deadline, bool hedgeable);
+    HttpResponse performCachedRequest(const HttpRequest& request, RequestTiming::Clock::time_point deadline);
+    HttpError sendRequestBody(int sockfd, const HttpRequest& request, std::string& pending,
+                              bool& bodySkipped, std::string& error);
+    bool receiveHedged(const HttpRequest& request, const OutgoingRequest& outgoing, int& sockfd,
+                       ResponseReader& reader, std::string& pending, const ReadDeadline& limits,
+                       std::chrono::milliseconds connectLimit);
+    bool openHedge(const HttpRequest& request, const OutgoingRequest& outgoing, int primary,
+                   std::chrono::milliseconds connectLimit, RequestTiming::Clock::time_point deadline, int& hedgefd);
+    size_t sendPipelineBatch(const std::vector<HttpRequest>& requests,
+                             const std::vector<size_t>& batch,
+                             std::vector<HttpResponse>& responses);
     
     // Response processing helpers
     void handleSuccessResponse(const HttpResponse& response);
@@ -42,8 +130,12 @@ private:
     void handleServerErrorResponse(const HttpResponse& response);
     void displayImportantHeaders(const HttpResponse& response);
     void displayBodyInfo(const HttpResponse& response);
+    void displayTiming(const HttpResponse& response);
+    void displayRedirectChain(const HttpResponse& response);
 
 public:
+    typedef std::function<void(const HttpResponse& headers)> HeadersCallback;
+    
     /**
      * Constructor
      * @param maxRedirects Maximum number of redirects to follow (default: 5)
@@ -55,12 +147,14 @@ public:
      */
     ~SimpleHttpClient() = default;
     
-    // Copy constructor and assignment operator
+    // Copy constructor and assignment operator (copies share one connection pool)
     SimpleHttpClient(const SimpleHttpClient&) = default;
     SimpleHttpClient& operator=(const SimpleHttpClient&) = default;
     
     /**
-     * Create a TCP connection to the specified hostname and port
+     * Create a TCP connection to the specified hostname and port.
+     * The hostname is looked up through the client's caching resolver and
+     * its addresses are raced Happy Eyeballs style under the connect deadlines.
      * @param hostname The hostname to connect to
      * @param port The port number to connect to
      * @return Socket file descriptor on success, -1 on failure
@@ -78,6 +172,15 @@ public:
                                  const std::string& path, 
                                  const std::string& method = "GET");
     
+    /**
+     * Serialize a request for writev.
+     * The origin's static headers come from a cached RequestTemplate; only the
+     * request line, the request's own headers and the Content-Length are formatted.
+     * @param request The request; must outlive out, since its body is not copied
+     * @param out Receives the request segments
+     */
+    void buildRequest(const HttpRequest& request, OutgoingRequest& out);
+    
     /**
      * Send an HTTP request through the socket
      * @param sockfd The socket file descriptor
@@ -86,6 +189,15 @@ public:
      */
     bool sendHttpRequest(int sockfd, const std::string& request);
     
+    /**
+     * Send a serialized request through the socket with writev
+     * @param sockfd The socket file descriptor
+     * @param request The request built by buildRequest()
+     * @param errorKind Receives HttpError::Timeout or HttpError::Send on failure (optional)
+     * @return true on success, false on failure
+     */
+    bool sendHttpRequest(int sockfd, const OutgoingRequest& request, HttpError* errorKind = nullptr);
+    
     /**
      * Receive HTTP response from the socket
      * @param sockfd The socket file descriptor
@@ -101,7 +213,35 @@ public:
     HttpResponse parseHttpResponse(const std::string& rawResponse);
     
     /**
-     * Make a complete HTTP request and return the response
+     * Parse the response a reader has finished, taking its message.
+     * A body the reader already de-chunked is not decoded again.
+     * @param reader Reader holding a complete response
+     * @return Parsed HttpResponse structure
+     */
+    HttpResponse parseHttpResponse(ResponseReader& reader);
+    
+    /**
+     * Parse a raw HTTP response without copying it.
+     * The returned view points into rawResponse and must not outlive it.
+     * Headers go into a flat inline array, so no per-header allocation is made.
+     * @param rawResponse The raw HTTP response bytes
+     * @return Parsed HttpResponseView (check isSuccess / errorMessage)
+     */
+    HttpResponseView parseHttpResponseView(std::string_view rawResponse);
+    
+    /**
+     * Copy a response view into an owning HttpResponse.
+     * Header names keep the case they arrived in (lookups ignore case); a chunked
+     * body is decoded and then any Content-Encoding is removed.
+     * @param view The view to materialize
+     * @return HttpResponse that no longer depends on the receive buffer
+     */
+    HttpResponse materialize(const HttpResponseView& view);
+    
+    /**
+     * Make a complete HTTP request and return the response.
+     * Connections are taken from and returned to the keep-alive pool.
+     * Redirects are followed up to the redirect limit (see makeHttpRequest(const HttpRequest&)).
      * @param hostname The hostname to connect to
      * @param path The path to request
      * @param port The port number (default: 80)
@@ -113,12 +253,187 @@ public:
                                 int port = 80, 
                                 const std::string& method = "GET");
     
+    /**
+     * Make a request, following 301, 302, 303, 307 and 308 redirects.
+     * 303 turns the request into a GET (HEAD stays HEAD), and so do 301 and
+     * 302 for a POST; 307 and 308 resend the same method and body. A hop to
+     * the same origin reuses the pooled keep-alive connection. Credentials
+     * (Authorization, Cookie) are not forwarded to another origin.
+     * Following stops at the redirect limit, at a Location that is not
+     * plain HTTP, or when the body could not be sent again; the last
+     * redirect response is then returned as is.
+     * @param request The request to make
+     * @return The final response, with the hops followed in redirectChain
+     */
+    HttpResponse makeHttpRequest(const HttpRequest& request);
+    
+    /**
+     * Make a request and stream the response body into a sink.
+     * The status line and headers are delivered first through onHeaders; body
+     * bytes then go to the sink as they arrive, so memory use stays bounded by
+     * the receive buffer. Bodies whose Content-Length is at or below the
+     * streaming threshold are kept in HttpResponse::body instead.
+     * @param request The request to make
+     * @param sink Destination for the body
+     * @param onHeaders Optional callback receiving the response without its body
+     * @return HttpResponse with status and headers; bodyStreamed tells where the body went
+     */
+    HttpResponse streamHttpRequest(const HttpRequest& request, BodySink& sink,
+                                   const HeadersCallback& onHeaders = nullptr);
+    
+    /**
+     * Set the size below which streamHttpRequest buffers a body in memory
+     * @param bytes Content-Length threshold; 0 always streams (default)
+     */
+    void setStreamingThreshold(size_t bytes);
+    
+    /**
+     * Get the in-memory fallback threshold for streamed requests
+     * @return Threshold in bytes
+     */
+    size_t getStreamingThreshold() const;
+    
+    /**
+     * Make several requests, pipelining them on keep-alive connections.
+     * Requests to the same origin are written back to back (up to the
+     * pipeline depth) and their responses read off the stream in order.
+     * Non-idempotent requests and requests whose body is not sent with the
+     * headers (file, generator, Expect: 100-continue) are never pipelined, and idempotent requests
+     * left unanswered when the server closes mid-pipeline are retried.
+     * @param requests The requests to make (may span several origins)
+     * @return One response per request, in input order
+     */
+    std::vector<HttpResponse> makePipelinedRequests(const std::vector<HttpRequest>& requests);
+    
+    /**
+     * Make several requests in parallel on a work-stealing thread pool.
+     * Each request is made as with makeHttpRequest(); no more than the
+     * pool's per-host cap run against one origin at a time. Creates a
+     * FetchPool for the call; keep a FetchPool around for repeated batches.
+     * @param requests The requests to make
+     * @param threads Number of worker threads (default: 0, one per CPU)
+     * @return One response per request, in input order
+     */
+    std::vector<HttpResponse> fetchAll(const std::vector<HttpRequest>& requests, size_t threads = 0);
+    
+    /**
+     * GET several URLs in parallel (see fetchAll)
+     * @param urls URLs in the format accepted by get()
+     * @param threads Number of worker threads (default: 0, one per CPU)
+     * @return One response per URL, in input order
+     */
+    std::vector<HttpResponse> getMany(const std::vector<std::string>& urls, size_t threads = 0);
+    
+    /**
+     * Set how many requests may be outstanding on one pipelined connection
+     * @param depth Pipeline depth; 1 sends requests one at a time (default: 8)
+     */
+    void setPipelineDepth(size_t depth);
+    
+    /**
+     * Get the current pipeline depth
+     * @return Maximum number of in-flight requests per connection
+     */
+    size_t getPipelineDepth() const;
+    
+    /**
+     * Enable or disable pipelining for a host (enabled by default)
+     * @param hostname The host to configure
+     * @param enabled false to send that host's requests one at a time
+     */
+    void setPipeliningEnabled(const std::string& hostname, bool enabled);
+    
+    /**
+     * Check whether pipelining is enabled for a host
+     * @param hostname The host to check
+     * @return true unless disabled with setPipeliningEnabled()
+     */
+    bool isPipeliningEnabled(const std::string& hostname) const;
+    
     /**
      * Process and display information about an HTTP response
      * @param response The HttpResponse to process
      */
     void processResponse(const HttpResponse& response);
     
+    /**
+     * Replace the headers sent on every request after Host
+     * @param headers Header names and values, in order (RequestTemplate::defaultHeaders() initially)
+     */
+    void setDefaultHeaders(const HeaderList& headers);
+    
+    /**
+     * Get the headers sent on every request
+     * @return The default headers, without Host
+     */
+    const HeaderList& getDefaultHeaders() const;
+    
+    /**
+     * Set how long a request with expectContinue waits for 100 Continue
+     * before sending its body anyway
+     * @param timeoutMs Timeout in milliseconds (default: 1000)
+     */
+    void setExpectContinueTimeout(int timeoutMs);
+    
+    /**
+     * Get the Expect: 100-continue timeout
+     * @return Timeout in milliseconds
+     */
+    int getExpectContinueTimeout() const;
+    
+    /**
+     * Set the time limits of requests that leave them at zero (see RequestTimeouts).
+     * Without limits a request waits on the server for as long as it takes.
+     * @param timeouts Default limits (initially none)
+     */
+    void setTimeouts(const RequestTimeouts& timeouts);
+    
+    /**
+     * Get the default time limits
+     * @return Limits applied where a request sets none
+     */
+    const RequestTimeouts& getTimeouts() const;
+    
+    /**
+     * Put a response cache in front of makeHttpRequest and get.
+     * GET and HEAD responses are stored and served from it while fresh;
+     * stale entries are revalidated with If-None-Match / If-Modified-Since
+     * and a 304 is answered from the cache. A successful request with any
+     * other method drops the cached entries for its URL.
+     * @param cache The cache to use (may be shared between clients), or nullptr to disable (default)
+     */
+    void setResponseCache(std::shared_ptr<ResponseCache> cache);
+    
+    /**
+     * Get the response cache
+     * @return The cache, or nullptr when caching is off
+     */
+    std::shared_ptr<ResponseCache> getResponseCache() const;
+    
+    /**
+     * Hedge slow idempotent requests (GET or HEAD without a body) made with
+     * makeHttpRequest and get. When no response byte has arrived after the
+     * policy's delay, a copy goes out on another connection: an idle pooled
+     * one, else a new one that tries the host's other addresses first. The
+     * first complete response is used and the other connection is closed.
+     * The copy is only sent if the origin is below its connection cap and
+     * the policy's budget allows it.
+     * @param policy Delay and budget; hedging is off unless policy.enabled (default: off)
+     */
+    void setHedgePolicy(const HedgePolicy& policy);
+    
+    /**
+     * Get the hedging policy
+     * @return The policy in use (enabled is false when hedging is off)
+     */
+    HedgePolicy getHedgePolicy() const;
+    
+    /**
+     * Get hedging counters
+     * @return Hedgeable requests, hedges sent, won and denied by the budget (zero when hedging is off)
+     */
+    HedgeStats getHedgeStats() const;
+    
     /**
      * Set the maximum number of redirects to follow
      * @param maxRedirects Maximum redirect count
@@ -131,13 +446,94 @@ public:
      */
     int getMaxRedirects() const;
     
+    /**
+     * Access the keep-alive connection pool (cap, idle timeout, pruning)
+     * @return The pool shared by this client and its copies
+     */
+    ConnectionPool& getConnectionPool();
+    
+    /**
+     * Make this client use another connection pool (copies made afterwards share it)
+     * @param pool The pool to use; a new default pool if nullptr
+     */
+    void setConnectionPool(std::shared_ptr<ConnectionPool> pool);
+    
+    /**
+     * Replace the resolver used by createConnection (e.g. with a stub or a preloaded one)
+     * @param resolver The resolver to use; the process-wide default is used initially
+     */
+    void setResolver(std::shared_ptr<DnsResolver> resolver);
+    
+    /**
+     * Access the resolver used by createConnection
+     * @return The resolver shared by this client and its copies
+     */
+    DnsResolver& getResolver();
+    
+    /**
+     * Set the connect deadlines used by createConnection
+     * @param options Attempt stagger, per-attempt and overall timeouts
+     */
+    void setConnectOptions(const ConnectOptions& options);
+    
+    /**
+     * Get the current connect deadlines
+     * @return The options used by createConnection
+     */
+    const ConnectOptions& getConnectOptions() const;
+    
+    /**
+     * Get connection reuse counters
+     * @return Pool hits, misses and evictions so far
+     */
+    PoolStats getPoolStats() const;
+    
     /**
      * Make a simple GET request (convenience method)
-     * @param url Full URL in format "hostname/path" or "hostname:port/path"
+     * @param url Full URL in format "hostname/path" or "hostname:port/path" (optionally "http://...")
      * @return HttpResponse structure with the result
      */
     HttpResponse get(const std::string& url);
     
+    /**
+     * Split a URL the way get() does
+     * @param url "hostname[:port][/path]", optionally prefixed with "http://"
+     * @param hostname Receives the host name or address
+     * @param path Receives the path (default "/")
+     * @param port Receives the port (default 80)
+     * @return false if the URL is malformed or not plain HTTP
+     */
+    static bool parseUrl(const std::string& url, std::string& hostname, std::string& path, int& port);
+    
+    /**
+     * Resolve a Location header against the request that received it (RFC 3986)
+     * @param base The request that was redirected
+     * @param location Absolute, scheme-relative or relative reference
+     * @param next Receives the hostname, port and path of the target
+     * @return false if the target is not plain HTTP or is malformed
+     */
+    static bool resolveLocation(const HttpRequest& base, const std::string& location, HttpRequest& next);
+    
+    /**
+     * Work out the request that follows a redirect response, the way
+     * makeHttpRequest(const HttpRequest&) does (method and body rewriting,
+     * credentials dropped across origins). The redirect limit is the caller's.
+     * @param current The request that was redirected
+     * @param response Its response
+     * @param next Receives the request to make next
+     * @param hop Receives the entry to add to the redirect chain
+     * @return false if the response is not a redirect that can be followed
+     */
+    static bool followRedirect(const HttpRequest& current, const HttpResponse& response,
+                               HttpRequest& next, RedirectHop& hop);
+    
+    /**
+     * Check if a status code is a redirect that carries a Location to follow
+     * @param statusCode HTTP status code
+     * @return true for 301, 302, 303, 307 and 308
+     */
+    static bool isFollowableRedirect(int statusCode);
+    
     /**
      * Check if a status code indicates success (2xx range)
      * @param statusCode HTTP status code
@@ -165,6 +561,13 @@ public:
      * @return true if status code is in 5xx range
      */
     static bool isServerErrorStatusCode(int statusCode);
+    
+    /**
+     * Check if an HTTP method is idempotent (safe to resend after a dropped connection)
+     * @param method HTTP method name
+     * @return true for GET, HEAD, PUT, DELETE, OPTIONS and TRACE
+     */
+    static bool isIdempotentMethod(const std::string& method);
 };
 
 #endif // SIMPLE_HTTP_CLIENT_H
@@ -0,0 +1,173 @@
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "request/http_response.h"
+
+/**
+ * Counters describing how well the cache is answering requests
+ */
+struct CacheStats {
+    uint64_t hits;           // fresh entry served without contacting the server
+    uint64_t misses;         // nothing usable stored; the request went out unconditionally
+    uint64_t revalidations;  // stale entry with a validator; a conditional request went out
+    uint64_t notModified;    // revalidation answered 304 and served from the cache
+    uint64_t stores;         // responses written to the cache
+    uint64_t evictions;      // entries dropped to stay under the size bound
+
+    CacheStats() : hits(0), misses(0), revalidations(0), notModified(0), stores(0), evictions(0) {}
+};
+
+/**
+ * A response held by the cache, with what is needed to judge and revalidate it
+ */
+struct CachedResponse {
+    typedef std::chrono::steady_clock Clock;
+
+    HttpResponse response;     // body already decoded; timing and redirectChain cleared
+    std::string etag;          // validators for If-None-Match / If-Modified-Since
+    std::string lastModified;
+    Clock::time_point expires; // end of the freshness lifetime
+    bool alwaysRevalidate;     // Cache-Control: no-cache
+    size_t size;               // bytes charged against the cache bound
+
+    CachedResponse() : alwaysRevalidate(false), size(0) {}
+
+    bool isFresh(Clock::time_point now) const { return !alwaysRevalidate && now < expires; }
+    bool hasValidator() const { return !etag.empty() || !lastModified.empty(); }
+};
+
+/**
+ * Size-bounded, sharded LRU cache of HTTP responses (RFC 9111).
+ *
+ * Entries are keyed by method, origin and path and spread over independently
+ * locked shards, so concurrent lookups of different URLs rarely contend. Each
+ * shard evicts least recently used entries to stay within its share of the
+ * byte bound. Lookups hand out shared pointers, so an entry can be served
+ * while it is being replaced.
+ *
+ * Freshness comes from Cache-Control max-age, else Expires against Date,
+ * else 10% of the time since Last-Modified (at most a day). no-store
+ * responses are never kept, no-cache ones are revalidated on every use,
+ * and responses with Vary are not cached. By default this is a private
+ * cache (one user); a shared cache also refuses private responses and
+ * prefers s-maxage.
+ *
+ * The cache is safe to use from several threads.
+ */
+class ResponseCache {
+public:
+    typedef std::chrono::steady_clock Clock;
+    typedef std::shared_ptr<const CachedResponse> Entry;
+
+    /**
+     * Constructor
+     * @param maxBytes Upper bound on the bodies and headers held (default: 64 MiB)
+     * @param shardCount Number of independently locked shards (default: 16)
+     * @param shared true if responses are shared between users (default: false)
+     */
+    explicit ResponseCache(size_t maxBytes = 64 * 1024 * 1024, size_t shardCount = 16, bool shared = false);
+
+    ResponseCache(const ResponseCache&) = delete;
+    ResponseCache& operator=(const ResponseCache&) = delete;
+
+    /**
+     * Build the key for a request
+     * @return "METHOD host:port/path"
+     */
+    static std::string makeKey(std::string_view method, const std::string& hostname, int port,
+                               std::string_view path);
+
+    /**
+     * Find a stored response and count the outcome as a hit, miss or revalidation
+     * @param key Key from makeKey()
+     * @param forceRevalidate Treat a fresh entry as stale (request sent Cache-Control: no-cache)
+     * @param fresh Set to true if the entry may be served as is, false if it must be revalidated
+     * @return The entry (fresh, or stale with a validator to revalidate), or nullptr
+     */
+    Entry lookup(const std::string& key, bool forceRevalidate, bool& fresh);
+
+    /**
+     * Store a response if it may be cached; a no-store response removes the old entry
+     * @param key Key from makeKey()
+     * @param response Complete response (with a buffered body)
+     * @return The stored entry, or nullptr if the response was not cacheable or too large to keep
+     */
+    Entry store(const std::string& key, const HttpResponse& response);
+
+    /**
+     * Update a stale entry from a 304 Not Modified response
+     * @param key Key from makeKey()
+     * @param stale The entry that was revalidated
+     * @param notModified The 304 response; its headers replace the stored ones
+     * @return The refreshed entry
+     */
+    Entry refresh(const std::string& key, const Entry& stale, const HttpResponse& notModified);
+
+    /**
+     * Drop an entry, e.g. after a POST or PUT to the same URL
+     */
+    void erase(const std::string& key);
+
+    void clear();
+
+    /**
+     * Number of entries and bytes currently held
+     */
+    size_t size() const;
+    size_t bytes() const;
+
+    /**
+     * Snapshot of the counters
+     */
+    CacheStats getStats() const;
+
+    size_t getMaxBytes() const { return maxBytes; }
+    bool isShared() const { return shared; }
+
+    /**
+     * Parse an HTTP-date (IMF-fixdate, RFC 850 or asctime format)
+     * @param text The date
+     * @param result Receives seconds since the epoch
+     * @return false if the date is malformed
+     */
+    static bool parseHttpDate(std::string_view text, std::time_t& result);
+
+private:
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<std::pair<std::string, Entry>> lru;  // most recently used at the front
+        std::unordered_map<std::string, std::list<std::pair<std::string, Entry>>::iterator> index;
+        size_t bytes = 0;
+    };
+
+    size_t maxBytes;
+    size_t shardBytes;
+    bool shared;
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> revalidations;
+    std::atomic<uint64_t> notModifiedCount;
+    std::atomic<uint64_t> stores;
+    std::atomic<uint64_t> evictions;
+
+    Shard& shardFor(const std::string& key);
+    std::shared_ptr<CachedResponse> makeEntry(const HttpResponse& response, const std::string& key) const;
+    bool insert(const std::string& key, Entry entry);  // false if the entry is too large to keep
+    void eraseLocked(Shard& shard, const std::string& key);
+};
+
+#endif // RESPONSE_CACHE_H
@@ -0,0 +1,110 @@
+#ifndef RESPONSE_VIEW_H
+#define RESPONSE_VIEW_H
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+#include "request/http_scan.h"
+
+/**
+ * A single header field pointing into the receive buffer
+ */
+struct HeaderView {
+    std::string_view name;   // as sent by the server (case preserved)
+    std::string_view value;  // surrounding whitespace trimmed
+};
+
+/**
+ * Flat, contiguous header storage.
+ * The first kInlineCapacity fields live inside the arena itself, so parsing
+ * a typical response allocates nothing; larger header blocks spill once into
+ * a vector and stay contiguous.
+ */
+class HeaderArena {
+public:
+    static const size_t kInlineCapacity = 32;
+
+    HeaderArena() : count(0) {}
+
+    void clear() {
+        count = 0;
+        overflow.clear();
+    }
+
+    void push_back(const HeaderView& field) {
+        if (count < kInlineCapacity) {
+            inlineFields[count++] = field;
+            return;
+        }
+        if (count == kInlineCapacity) {
+            overflow.reserve(kInlineCapacity * 2);
+            overflow.assign(inlineFields.begin(), inlineFields.end());
+        }
+        overflow.push_back(field);
+        count++;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    const HeaderView* begin() const {
+        return count > kInlineCapacity ? overflow.data() : inlineFields.data();
+    }
+    const HeaderView* end() const { return begin() + count; }
+    const HeaderView& operator[](size_t index) const { return begin()[index]; }
+
+private:
+    std::array<HeaderView, kInlineCapacity> inlineFields;
+    std::vector<HeaderView> overflow;
+    size_t count;
+};
+
+/**
+ * Non-owning view of a parsed HTTP response.
+ * Every string_view points into the buffer that was parsed, so the view is
+ * only valid while that buffer is alive and unmodified. Use
+ * SimpleHttpClient::materialize() to obtain an owning HttpResponse.
+ */
+struct HttpResponseView {
+    std::string_view httpVersion;   // e.g., "HTTP/1.1"
+    int statusCode;                 // e.g., 200, 404, 500
+    std::string_view reasonPhrase;  // e.g., "OK", "Not Found"
+    HeaderArena headers;
+    std::string_view body;          // still transfer-encoded when isChunked is set
+    bool isChunked;
+    bool isSuccess;
+    std::string_view errorMessage;  // points at a string literal
+
+    // Constructor
+    HttpResponseView() : statusCode(0), isChunked(false), isSuccess(false) {}
+
+    /**
+     * Find a header value by name (case-insensitive, first occurrence)
+     * @param name Header name
+     * @return The value, or an empty view if the header is absent
+     */
+    std::string_view header(std::string_view name) const {
+        const HeaderView* field = findHeader(name);
+        return field ? field->value : std::string_view();
+    }
+
+    /**
+     * Check whether a header is present (case-insensitive)
+     */
+    bool hasHeader(std::string_view name) const {
+        return findHeader(name) != nullptr;
+    }
+
+private:
+    const HeaderView* findHeader(std::string_view name) const {
+        for (const HeaderView& field : headers) {
+            if (equalsIgnoreCaseAscii(field.name, name)) {
+                return &field;
+            }
+        }
+        return nullptr;
+    }
+};
+
+#endif // RESPONSE_VIEW_H
@@ -0,0 +1,369 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/**
+ * Coroutine building blocks for CoroHttpClient: Task<T>, cancellation and
+ * the whenAll / whenAny combinators.
+ *
+ * Everything here runs on one thread, the thread driving the IoScheduler;
+ * nothing is synchronized. The library reports errors through return
+ * values, so an exception escaping a coroutine terminates the program.
+ */
+
+template <typename T>
+class Task;
+
+namespace detail {
+
+struct TaskPromiseBase {
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+
+    // Resume whoever awaited the task, without growing the stack
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            return handle.promise().continuation;
+        }
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() noexcept { std::terminate(); }
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object();
+    template <typename U>
+    void return_value(U&& result) { value.emplace(std::forward<U>(result)); }
+    T take() { return std::move(*value); }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object();
+    void return_void() {}
+    void take() {}
+};
+
+} // namespace detail
+
+/**
+ * A lazily started coroutine producing a T.
+ *
+ * Nothing runs until the task is co_awaited (or handed to
+ * IoScheduler::spawn / IoScheduler::run); the awaiting coroutine is resumed
+ * when it finishes. A task is move-only and owns its coroutine frame.
+ * Arguments of a coroutine returning Task are best taken by value: a
+ * reference parameter must outlive the task, not just the call.
+ */
+template <typename T = void>
+class Task {
+public:
+    typedef detail::TaskPromise<T> promise_type;
+    typedef std::coroutine_handle<promise_type> Handle;
+
+    Task() = default;
+    explicit Task(Handle handle) : handle(handle) {}
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            destroy();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() { destroy(); }
+
+    bool valid() const { return static_cast<bool>(handle); }
+    bool done() const { return !handle || handle.done(); }
+
+    bool await_ready() const noexcept { return done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+    T await_resume() { return handle.promise().take(); }
+
+private:
+    Handle handle;
+
+    void destroy() {
+        if (handle) {
+            handle.destroy();
+            handle = nullptr;
+        }
+    }
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+struct CancelState {
+    bool cancelled = false;
+    uint64_t nextId = 0;
+    std::map<uint64_t, std::function<void()>> callbacks;  // registration id -> callback
+};
+
+} // namespace detail
+
+/**
+ * Observes whether an operation should be abandoned.
+ * A default-constructed token is never cancelled.
+ */
+class CancellationToken {
+public:
+    CancellationToken() = default;
+
+    bool isCancelled() const { return state && state->cancelled; }
+    bool canBeCancelled() const { return static_cast<bool>(state); }
+
+private:
+    friend class CancellationSource;
+    friend class CancellationRegistration;
+
+    std::shared_ptr<detail::CancelState> state;
+
+    explicit CancellationToken(std::shared_ptr<detail::CancelState> state) : state(std::move(state)) {}
+};
+
+/**
+ * Requests cancellation of every operation holding one of its tokens.
+ * cancel() runs the registered callbacks right away, so it must be called
+ * on the scheduler's thread (use IoScheduler::post from elsewhere).
+ */
+class CancellationSource {
+public:
+    CancellationSource() : state(std::make_shared<detail::CancelState>()) {}
+
+    CancellationToken getToken() const { return CancellationToken(state); }
+    bool isCancelled() const { return state->cancelled; }
+
+    void cancel() {
+        if (state->cancelled) {
+            return;
+        }
+        state->cancelled = true;
+        // A callback may unregister others; work on a copy
+        std::map<uint64_t, std::function<void()>> callbacks;
+        callbacks.swap(state->callbacks);
+        for (auto& callback : callbacks) {
+            callback.second();
+        }
+    }
+
+private:
+    std::shared_ptr<detail::CancelState> state;
+};
+
+/**
+ * Runs a callback when a token is cancelled, for as long as it is alive.
+ * If the token is already cancelled the callback is not registered;
+ * check isCancelled() first.
+ */
+class CancellationRegistration {
+public:
+    CancellationRegistration() : id(0) {}
+    CancellationRegistration(const CancellationToken& token, std::function<void()> callback) : id(0) {
+        bind(token, std::move(callback));
+    }
+    CancellationRegistration(const CancellationRegistration&) = delete;
+    CancellationRegistration& operator=(const CancellationRegistration&) = delete;
+    ~CancellationRegistration() { reset(); }
+
+    /**
+     * Replace the registered callback
+     */
+    void bind(const CancellationToken& token, std::function<void()> callback) {
+        reset();
+        if (token.state && !token.state->cancelled) {
+            state = token.state;
+            id = ++state->nextId;
+            state->callbacks.emplace(id, std::move(callback));
+        }
+    }
+
+    void reset() {
+        if (!state) {
+            return;
+        }
+        state->callbacks.erase(id);
+        state.reset();
+    }
+
+private:
+    std::shared_ptr<detail::CancelState> state;
+    uint64_t id;
+};
+
+namespace detail {
+
+struct JoinState {
+    size_t remaining = 0;
+    std::coroutine_handle<> parent;
+};
+
+// Eagerly started child of whenAll / whenAny; destroys itself when done
+// and resumes the parent after the last child finishes
+class JoinChild {
+public:
+    struct promise_type {
+        JoinState* state = nullptr;
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+                JoinState* state = handle.promise().state;
+                handle.destroy();
+                return --state->remaining == 0 ? state->parent : std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+
+        JoinChild get_return_object() {
+            return JoinChild(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+
+    void start(JoinState& state) {
+        handle.promise().state = &state;
+        handle.resume();
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle;
+
+    explicit JoinChild(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+};
+
+// Starts every child and suspends the parent until all of them finished
+class JoinAwaiter {
+public:
+    explicit JoinAwaiter(std::vector<JoinChild>& children) : children(children) {}
+
+    bool await_ready() const noexcept { return children.empty(); }
+    bool await_suspend(std::coroutine_handle<> parent) {
+        // One extra count keeps a child that finishes synchronously from
+        // resuming the parent before every child has been started
+        state.remaining = children.size() + 1;
+        state.parent = parent;
+        for (JoinChild& child : children) {
+            child.start(state);
+        }
+        return --state.remaining != 0;
+    }
+    void await_resume() noexcept {}
+
+private:
+    std::vector<JoinChild>& children;
+    JoinState state;
+};
+
+template <typename T>
+JoinChild joinInto(Task<T>& task, std::optional<T>& slot) {
+    slot.emplace(co_await task);
+}
+
+inline JoinChild joinInto(Task<void>& task) {
+    co_await task;
+}
+
+template <typename T>
+JoinChild joinFirst(Task<T>& task, size_t index, std::optional<std::pair<size_t, T>>& winner,
+                    CancellationSource& source) {
+    T result = co_await task;
+    if (!winner) {
+        winner.emplace(index, std::move(result));
+        source.cancel();
+    }
+}
+
+} // namespace detail
+
+/**
+ * Run tasks concurrently and wait for all of them
+ * @param tasks The tasks to run
+ * @return Their results, in input order
+ */
+template <typename T>
+Task<std::vector<T>> whenAll(std::vector<Task<T>> tasks) {
+    std::vector<std::optional<T>> slots(tasks.size());
+    std::vector<detail::JoinChild> children;
+    children.reserve(tasks.size());
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        children.push_back(detail::joinInto(tasks[i], slots[i]));
+    }
+    co_await detail::JoinAwaiter(children);
+
+    std::vector<T> results;
+    results.reserve(slots.size());
+    for (std::optional<T>& slot : slots) {
+        results.push_back(std::move(*slot));
+    }
+    co_return results;
+}
+
+/**
+ * Run tasks concurrently and wait for all of them
+ * @param tasks The tasks to run
+ */
+inline Task<void> whenAll(std::vector<Task<void>> tasks) {
+    std::vector<detail::JoinChild> children;
+    children.reserve(tasks.size());
+    for (Task<void>& task : tasks) {
+        children.push_back(detail::joinInto(task));
+    }
+    co_await detail::JoinAwaiter(children);
+}
+
+/**
+ * Run tasks concurrently and take the first result.
+ * The tasks should observe tokens of source: when the first one finishes
+ * the source is cancelled, and whenAny still waits for the others to wind
+ * down, so no task outlives the call.
+ * @param tasks The tasks to run (at least one)
+ * @param source Cancelled once a winner is known
+ * @return Index of the first task to finish and its result
+ */
+template <typename T>
+Task<std::pair<size_t, T>> whenAny(std::vector<Task<T>> tasks, CancellationSource& source) {
+    std::optional<std::pair<size_t, T>> winner;
+    std::vector<detail::JoinChild> children;
+    children.reserve(tasks.size());
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        children.push_back(detail::joinFirst(tasks[i], i, winner, source));
+    }
+    co_await detail::JoinAwaiter(children);
+    co_return std::move(*winner);
+}
+
+#endif // TASK_H
@@ -0,0 +1,134 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+/**
+ * Hierarchical timer wheel with millisecond ticks.
+ *
+ * Four levels of 256 slots cover about 49 days; a timer is linked into
+ * the slot of the coarsest level its deadline falls in and moved down a
+ * level each time the wheel turns onto that slot, so scheduling,
+ * rescheduling and cancelling cost O(1) whatever the number of timers
+ * (the timers of one slot are moved at most once per level). Timers
+ * further out wait in an overflow list.
+ *
+ * Timers are intrusive: the owner embeds a Timer and schedules it, and no
+ * allocation happens per deadline. A timer fires no earlier than its
+ * deadline and at most one tick after advance() has passed it.
+ *
+ * Not thread-safe; a wheel belongs to the thread that drives it.
+ */
+class TimerWheel {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * A deadline and what to do when it passes. Cancelled when destroyed.
+     */
+    class Timer {
+    public:
+        /**
+         * Constructor
+         * @param callback Run by advance() when the timer fires; may reschedule, cancel or
+         *                 destroy any timer, this one included
+         */
+        explicit Timer(std::function<void()> callback = nullptr)
+            : wheel(nullptr), prev(nullptr), next(nullptr), bucket(0), expiry(0), callback(std::move(callback)) {}
+
+        /**
+         * Destructor - cancels the timer if it is pending
+         */
+        ~Timer();
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+        void setCallback(std::function<void()> callback) { this->callback = std::move(callback); }
+
+        /**
+         * Whether the timer is scheduled and has not fired yet
+         */
+        bool isPending() const { return wheel != nullptr; }
+
+    private:
+        friend class TimerWheel;
+
+        TimerWheel* wheel;
+        Timer* prev;
+        Timer* next;
+        size_t bucket;    // list the timer is linked into
+        uint64_t expiry;  // tick the timer fires on
+        std::function<void()> callback;
+    };
+
+    /**
+     * Constructor
+     * @param origin Tick zero (default: now)
+     */
+    explicit TimerWheel(Clock::time_point origin = Clock::now());
+
+    /**
+     * Destructor - timers still pending are left unscheduled
+     */
+    ~TimerWheel();
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    /**
+     * Schedule a timer, moving it if it is already pending
+     * @param timer The timer; must stay alive while pending (or be cancelled by its destructor)
+     * @param deadline When to fire; a deadline already past fires on the next tick
+     */
+    void schedule(Timer& timer, Clock::time_point deadline);
+
+    /**
+     * Unschedule a timer; nothing happens if it is not pending
+     */
+    void cancel(Timer& timer);
+
+    /**
+     * Fire every timer whose deadline is at or before now
+     * @param now The current time
+     * @return Number of timers fired
+     */
+    size_t advance(Clock::time_point now);
+
+    /**
+     * When advance() next has something to do: the earliest deadline, or an
+     * earlier time at which far-off timers move closer
+     * @return That time, or Clock::time_point::max() with no timer pending
+     */
+    Clock::time_point nextWakeup() const;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+private:
+    static constexpr size_t kLevelBits = 8;
+    static constexpr size_t kSlots = size_t(1) << kLevelBits;
+    static constexpr size_t kLevels = 4;
+    static constexpr size_t kOverflow = kLevels * kSlots;  // timers past the last level
+    static constexpr size_t kFiring = kOverflow + 1;       // timers taken off the wheel by advance()
+    static constexpr size_t kBuckets = kFiring + 1;
+
+    Clock::time_point origin;
+    uint64_t current;  // next tick to process
+    size_t count;
+    Timer* buckets[kBuckets];
+    uint64_t occupied[kOverflow / 64];  // wheel slots with timers linked in
+
+    uint64_t tickOf(Clock::time_point deadline) const;
+    void place(Timer& timer);
+    void link(Timer& timer, size_t bucket);
+    void unlink(Timer& timer);
+    void cascade(size_t bucket);
+    uint64_t nextTick() const;
+    size_t findSlot(size_t level, size_t from) const;
+};
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,103 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <cstddef>
+#include <memory>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include "processing/io_scheduler.h"
+#include "processing/task.h"
+#include "socket/resolver.h"
+
+enum class TransportKind {
+    Auto,     // io_uring when the kernel supports it, epoll otherwise
+    Epoll,    // one syscall per operation, readiness from the scheduler's epoll
+    IoUring   // operations batched into one io_uring_enter per loop round
+};
+
+/**
+ * How CoroHttpClient moves bytes over its sockets.
+ *
+ * The client keeps request formatting, response parsing and connection
+ * pooling; a transport only connects, writes and reads. Results follow the
+ * io_uring convention: a byte count or 0 on success, a negative errno value
+ * on failure (-ECANCELED once the token is cancelled).
+ *
+ * Sockets are created non-blocking by the client and closed through the
+ * transport. A transport belongs to one scheduler's thread, and the
+ * scheduler must outlive it.
+ */
+class Transport {
+public:
+    virtual ~Transport() {}
+
+    /**
+     * Pick a transport for a scheduler
+     * @param scheduler The loop the transport's operations complete on
+     * @param kind Auto, or a specific backend; IoUring falls back to Epoll when unsupported
+     * @return The transport
+     */
+    static std::shared_ptr<Transport> create(IoScheduler& scheduler, TransportKind kind = TransportKind::Auto);
+
+    virtual TransportKind getKind() const = 0;
+
+    /**
+     * Connect a socket
+     * @return 0 once connected, or a negative errno value
+     */
+    virtual Task<int> connect(int sockfd, ResolvedAddress address, CancellationToken token) = 0;
+
+    /**
+     * Write some of a list of segments
+     * @param segments Data to write; must outlive the task
+     * @return Bytes written, or a negative errno value
+     */
+    virtual Task<ssize_t> send(int sockfd, const iovec* segments, size_t count, CancellationToken token) = 0;
+
+    /**
+     * Wait until a socket can be written, for writes made outside the
+     * transport (file bodies go out with sendfile)
+     * @return true once writable, false if cancelled
+     */
+    virtual Task<bool> writable(int sockfd, CancellationToken token) = 0;
+
+    /**
+     * Read what has arrived, waiting for at least one byte
+     * @param buffer Receives the data; must outlive the task
+     * @return Bytes read, 0 at the end of the stream, or a negative errno value
+     */
+    virtual Task<ssize_t> receive(int sockfd, char* buffer, size_t length, CancellationToken token) = 0;
+
+    /**
+     * Whether an idle connection has been closed by the server (or has
+     * unsolicited data) and must not be reused
+     */
+    virtual bool isStale(int sockfd) = 0;
+
+    /**
+     * Close a socket, abandoning anything the transport still holds for it
+     */
+    virtual void close(int sockfd) = 0;
+};
+
+/**
+ * Transport making each operation directly on the non-blocking socket and
+ * suspending on the scheduler's epoll when it would block.
+ */
+class EpollTransport : public Transport {
+public:
+    explicit EpollTransport(IoScheduler& scheduler) : scheduler(scheduler) {}
+
+    TransportKind getKind() const override { return TransportKind::Epoll; }
+    Task<int> connect(int sockfd, ResolvedAddress address, CancellationToken token) override;
+    Task<ssize_t> send(int sockfd, const iovec* segments, size_t count, CancellationToken token) override;
+    Task<bool> writable(int sockfd, CancellationToken token) override;
+    Task<ssize_t> receive(int sockfd, char* buffer, size_t length, CancellationToken token) override;
+    bool isStale(int sockfd) override;
+    void close(int sockfd) override;
+
+private:
+    IoScheduler& scheduler;
+};
+
+#endif // TRANSPORT_H
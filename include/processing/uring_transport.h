@@ -0,0 +1,166 @@
+#ifndef URING_TRANSPORT_H
+#define URING_TRANSPORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <linux/io_uring.h>
+#include "processing/transport.h"
+
+/**
+ * Counters describing how well submissions are batched
+ */
+struct UringStats {
+    size_t operations;   // requests submitted to the ring (connects, sends, receives armed, ...)
+    size_t completions;  // completions reaped; a multishot receive yields many per request
+    size_t enters;       // io_uring_enter calls
+
+    UringStats() : operations(0), completions(0), enters(0) {}
+};
+
+/**
+ * Transport built on io_uring, driven through the raw system calls.
+ *
+ * Operations queued while the scheduler resumes coroutines are submitted
+ * together with one io_uring_enter just before the loop waits, so the
+ * syscall count follows loop rounds rather than requests. Receives are
+ * multishot: armed once per connection, they keep delivering data as it
+ * arrives (also across keep-alive reuse) into buffers registered with the
+ * kernel as a provided-buffer ring, with no syscall per read; a socket
+ * that finds every buffer in use is read directly until it catches up.
+ * Completions are reaped when the ring's descriptor turns readable in the
+ * scheduler's epoll.
+ *
+ * Needs Linux 5.19 (provided-buffer rings); multishot receives need 6.0
+ * and fall back to one-shot receives before that. Check isReady() after
+ * construction, or let Transport::create() choose.
+ *
+ * Coroutines waiting on the transport must finish (or be destroyed) before
+ * it is.
+ */
+class UringTransport : public Transport, private IoScheduler::Poller {
+public:
+    /**
+     * Constructor - sets up the ring and registers it with the scheduler
+     * @param scheduler The loop the transport's operations complete on
+     */
+    explicit UringTransport(IoScheduler& scheduler);
+
+    /**
+     * Destructor - cancels whatever is in flight and tears down the ring
+     */
+    ~UringTransport();
+
+    UringTransport(const UringTransport&) = delete;
+    UringTransport& operator=(const UringTransport&) = delete;
+
+    /**
+     * Whether the kernel supports everything the transport needs
+     */
+    bool isReady() const { return ringFd != -1; }
+
+    /**
+     * Why the ring could not be set up
+     */
+    const std::string& getError() const { return error; }
+
+    UringStats getStats() const { return stats; }
+
+    TransportKind getKind() const override { return TransportKind::IoUring; }
+    Task<int> connect(int sockfd, ResolvedAddress address, CancellationToken token) override;
+    Task<ssize_t> send(int sockfd, const iovec* segments, size_t count, CancellationToken token) override;
+    Task<bool> writable(int sockfd, CancellationToken token) override;
+    Task<ssize_t> receive(int sockfd, char* buffer, size_t length, CancellationToken token) override;
+    bool isStale(int sockfd) override;
+    void close(int sockfd) override;
+
+private:
+    // Receives a ring completion; found through the id in its user_data
+    class Completion {
+    public:
+        virtual ~Completion() {}
+        virtual void complete(int result, uint32_t flags) = 0;
+    };
+
+    // Awaitable single-shot request; resumes with its result
+    class Operation;
+
+    // Per-socket receive state: buffers filled by the armed receive, not yet read
+    struct Chunk {
+        uint16_t bufferId;
+        uint32_t length;
+        uint32_t offset;
+    };
+    class ReceiveAwaiter;
+    class Stream : public Completion {
+    public:
+        Stream(UringTransport& transport, int sockfd) : transport(transport), sockfd(sockfd) {}
+        void complete(int result, uint32_t flags) override { transport.onReceive(*this, result, flags); }
+
+        UringTransport& transport;
+        int sockfd;
+        uint64_t id = 0;  // of the armed receive, 0 when none is
+        std::deque<Chunk> chunks;
+        bool ended = false;
+        bool starved = false;  // the receive ran out of provided buffers
+        int error = 0;
+        bool closed = false;
+        ReceiveAwaiter* waiter = nullptr;
+    };
+
+    IoScheduler& scheduler;
+    std::string error;
+    int ringFd;
+
+    // Rings shared with the kernel
+    void* ring;
+    size_t ringSize;
+    io_uring_sqe* sqes;
+    size_t sqesSize;
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned* sqFlags;
+    unsigned sqMask;
+    unsigned sqEntries;
+    unsigned queuedTail;  // SQEs filled in up to here, published on flush()
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned cqMask;
+    io_uring_cqe* cqes;
+
+    // Provided receive buffers
+    char* buffers;
+    size_t buffersSize;
+    io_uring_buf* bufferRing;  // shared with the kernel
+    size_t bufferRingSize;
+    uint16_t bufferTail;
+    bool multishot;
+
+    uint64_t nextId;
+    std::unordered_map<uint64_t, Completion*> inflight;  // id -> whoever awaits its completion
+    size_t outstanding;  // submitted requests whose last completion has not arrived
+    std::unordered_map<int, std::unique_ptr<Stream>> streams;  // socket -> receive state
+    std::unordered_map<uint64_t, std::unique_ptr<Stream>> closing;  // closed, receive still being cancelled
+    UringStats stats;
+
+    bool setup();
+    void flush() override;
+    void poll() override;
+    Task<bool> pollFor(int sockfd, uint32_t events, CancellationToken token);
+    io_uring_sqe* nextSqe();
+    uint64_t submit(const io_uring_sqe& request, Completion* completion);
+    void cancel(uint64_t id);
+    void abandon(uint64_t id);
+    int enter(unsigned toSubmit, unsigned minComplete, unsigned flags);
+    void reap();
+    Stream& streamFor(int sockfd);
+    void arm(Stream& stream);
+    void onReceive(Stream& stream, int result, uint32_t flags);
+    size_t take(Stream& stream, char* buffer, size_t length);
+    void recycle(uint16_t bufferId);
+};
+
+#endif // URING_TRANSPORT_H
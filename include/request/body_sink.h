@@ -0,0 +1,62 @@
+#ifndef BODY_SINK_H
+#define BODY_SINK_H
+#include <cstddef>
+#include <functional>
+#include <ostream>
+
+/**
+ * Destination for a response body delivered piece by piece as it arrives.
+ * write() returning false aborts the transfer.
+ */
+class BodySink {
+public:
+    virtual ~BodySink() = default;
+
+    /**
+     * Accept the next piece of the (transfer-decoded) body
+     * @param data Pointer to the bytes
+     * @param length Number of bytes
+     * @return true to continue, false to abort the response
+     */
+    virtual bool write(const char* data, size_t length) = 0;
+};
+
+/**
+ * Forwards body bytes to a callback
+ */
+class CallbackBodySink : public BodySink {
+public:
+    typedef std::function<bool(const char* data, size_t length)> Callback;
+
+    explicit CallbackBodySink(Callback callback) : callback(std::move(callback)) {}
+    bool write(const char* data, size_t length) override { return callback(data, length); }
+
+private:
+    Callback callback;
+};
+
+/**
+ * Writes body bytes to a std::ostream (e.g. an std::ofstream)
+ */
+class StreamBodySink : public BodySink {
+public:
+    explicit StreamBodySink(std::ostream& stream) : stream(stream) {}
+    bool write(const char* data, size_t length) override;
+
+private:
+    std::ostream& stream;
+};
+
+/**
+ * Writes body bytes to a file descriptor (file, pipe or socket)
+ */
+class FdBodySink : public BodySink {
+public:
+    explicit FdBodySink(int fd) : fd(fd) {}
+    bool write(const char* data, size_t length) override;
+
+private:
+    int fd;
+};
+
+#endif // BODY_SINK_H
@@ -0,0 +1,103 @@
+#ifndef CHUNKED_DECODER_H
+#define CHUNKED_DECODER_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/uio.h>
+
+/**
+ * Incremental decoder for the HTTP/1.1 chunked transfer coding (RFC 9112 section 7.1).
+ *
+ * Input may be fed in arbitrary pieces; the decoder keeps only a few bytes
+ * of state between calls and never needs the whole body to be buffered.
+ * Chunk sizes are byte counts, payloads are passed through untouched
+ * (binary-safe), chunk extensions are skipped and trailer fields are
+ * collected once the last chunk has been seen.
+ *
+ * Payload can be returned zero-copy as iovec slices of the input, or
+ * compacted in place over the framing bytes of the input buffer.
+ */
+class ChunkedDecoder {
+public:
+    enum class State {
+        Size,         // reading the hex chunk size
+        Extension,    // skipping chunk extensions up to the end of the size line
+        Data,         // reading chunk payload
+        DataCr,       // expecting the CRLF after a chunk payload
+        DataLf,
+        Trailers,     // reading trailer fields after the last chunk
+        Complete,
+        Error
+    };
+
+    typedef std::vector<std::pair<std::string, std::string>> TrailerList;
+
+    ChunkedDecoder();
+
+    /**
+     * Start over for a new body
+     */
+    void reset();
+
+    /**
+     * Decode input without copying the payload
+     * @param data Encoded bytes
+     * @param length Number of bytes available
+     * @param payload Receives one slice of data per payload run found (appended)
+     * @return Number of bytes consumed; less than length only once the body
+     *         is complete (the rest follows the message) or on error
+     */
+    size_t decode(const char* data, size_t length, std::vector<iovec>& payload);
+
+    /**
+     * Decode input in place, moving payload bytes over the chunk framing
+     * @param data Encoded bytes; on return the first payloadLength bytes are payload
+     * @param length Number of bytes available
+     * @param payloadLength Set to the number of payload bytes written to data
+     * @return Number of bytes consumed, as for decode()
+     */
+    size_t decodeInPlace(char* data, size_t length, size_t& payloadLength);
+
+    bool isComplete() const { return state == State::Complete; }
+    bool hasError() const { return state == State::Error; }
+    State getState() const { return state; }
+    const std::string& getError() const { return error; }
+
+    /**
+     * Payload bytes decoded so far
+     */
+    uint64_t getPayloadBytes() const { return payloadBytes; }
+
+    /**
+     * Trailer fields in the order received; complete once isComplete()
+     */
+    const TrailerList& getTrailers() const { return trailers; }
+
+    /**
+     * Decode a fully buffered chunked body in place
+     * @param body Encoded body; replaced by the decoded payload
+     * @param error Set to a description when the body is malformed (optional)
+     * @return false if the body is malformed; a body missing its last chunk
+     *         decodes to the payload received so far
+     */
+    static bool decodeBody(std::string& body, std::string* error = nullptr);
+
+private:
+    State state;
+    uint64_t chunkSize;     // of the chunk being read
+    uint64_t remaining;     // payload bytes left in the current chunk
+    uint64_t payloadBytes;
+    size_t sizeDigits;
+    size_t lineBytes;       // of the current size or trailer line
+    std::string trailerLine;
+    TrailerList trailers;
+    std::string error;
+    std::vector<iovec> scratch;
+
+    bool finishTrailerLine();
+    void fail(const std::string& reason);
+};
+
+#endif // CHUNKED_DECODER_H
@@ -0,0 +1,115 @@
+#ifndef CONTENT_DECODER_H
+#define CONTENT_DECODER_H
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "request/body_sink.h"
+
+/**
+ * Streaming decoder for the gzip and deflate content codings (zlib).
+ *
+ * Compressed bytes are fed in as they arrive and decompressed output is
+ * handed to a callback in pieces of at most 16 KiB, so neither side of the
+ * transformation has to be held in memory. "deflate" accepts both the
+ * zlib-wrapped form required by RFC 9110 and the raw form some servers
+ * send; concatenated gzip members are decoded back to back.
+ */
+class ContentDecoder {
+public:
+    enum class Encoding {
+        Identity,
+        Gzip,
+        Deflate,
+        Unsupported
+    };
+
+    typedef std::function<bool(const char* data, size_t length)> Output;
+
+    /**
+     * Map a Content-Encoding header value to a decoder
+     * @param value Header value, e.g. "gzip"; an empty value means identity
+     * @return The coding, or Unsupported for unknown or stacked codings
+     */
+    static Encoding parseEncoding(std::string_view value);
+
+    /**
+     * Constructor
+     * @param encoding Gzip or Deflate (Identity passes bytes through)
+     */
+    explicit ContentDecoder(Encoding encoding);
+    ~ContentDecoder();
+
+    ContentDecoder(const ContentDecoder&) = delete;
+    ContentDecoder& operator=(const ContentDecoder&) = delete;
+
+    /**
+     * Decompress the next piece of the body
+     * @param data Compressed bytes
+     * @param length Number of bytes
+     * @param output Receives decompressed bytes; returning false aborts
+     * @return false on corrupt input or when output aborted
+     */
+    bool decode(const char* data, size_t length, const Output& output);
+
+    /**
+     * Signal the end of the compressed input
+     * @return false if the compressed stream was truncated
+     */
+    bool finish();
+
+    bool hasError() const { return !error.empty(); }
+    const std::string& getError() const { return error; }
+
+    uint64_t getCompressedBytes() const { return compressedBytes; }
+    uint64_t getDecodedBytes() const { return decodedBytes; }
+
+    /**
+     * Decode a fully buffered body in place
+     * @param body Compressed body; replaced by the decoded bytes
+     * @param encoding Coding named by Content-Encoding
+     * @param error Set to a description on failure (optional)
+     * @return false if the body could not be decoded (body is left unchanged)
+     */
+    static bool decodeBody(std::string& body, Encoding encoding, std::string* error = nullptr);
+
+private:
+    struct Stream;
+
+    Encoding encoding;
+    std::unique_ptr<Stream> stream;
+    bool streamEnded;
+    std::string header;       // first bytes of a deflate body, to tell zlib from raw
+    uint64_t compressedBytes;
+    uint64_t decodedBytes;
+    std::string error;
+
+    bool start(bool rawDeflate);
+    bool inflateInput(const char* data, size_t length, const Output& output);
+};
+
+/**
+ * BodySink that decompresses a body on its way to another sink
+ */
+class DecodingBodySink : public BodySink {
+public:
+    DecodingBodySink(ContentDecoder::Encoding encoding, BodySink& downstream)
+        : decoder(encoding), downstream(downstream) {}
+
+    bool write(const char* data, size_t length) override;
+
+    /**
+     * Check that the compressed stream ended cleanly
+     */
+    bool finish() { return decoder.finish(); }
+
+    const ContentDecoder& getDecoder() const { return decoder; }
+
+private:
+    ContentDecoder decoder;
+    BodySink& downstream;
+};
+
+#endif // CONTENT_DECODER_H
@@ -0,0 +1,120 @@
+#ifndef HEADER_TABLE_H
+#define HEADER_TABLE_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Header fields the client looks up often enough to deserve a fixed slot
+ */
+enum class KnownHeader : uint8_t {
+    ContentLength,
+    ContentType,
+    ContentEncoding,
+    ContentRange,
+    TransferEncoding,
+    Connection,
+    KeepAlive,
+    Location,
+    SetCookie,
+    Date,
+    Server,
+    CacheControl,
+    ETag,
+    LastModified,
+    Expires,
+    Age,
+    Vary,
+    RetryAfter,
+    Trailer,
+    Upgrade,
+    AcceptRanges,
+    WwwAuthenticate,
+    Unknown  // keep last: the number of known headers
+};
+
+/**
+ * Flat container for the header fields of a message.
+ *
+ * Fields are kept in arrival order in a single vector, so duplicates such
+ * as Set-Cookie are preserved and iteration reproduces the message. Names
+ * are recognized once, when a field is added, by a switch on length and
+ * first letter; well-known headers then get an O(1) slot pointing at their
+ * first occurrence. Other names are found by a case-insensitive scan of
+ * the (short) vector. Names keep the case they arrived in.
+ */
+class HeaderTable {
+public:
+    struct Field {
+        std::string name;
+        std::string value;
+        KnownHeader id;
+    };
+
+    typedef std::vector<Field>::const_iterator const_iterator;
+
+    HeaderTable();
+
+    /**
+     * Recognize a header name (ASCII case-insensitive)
+     * @return The known header, or KnownHeader::Unknown
+     */
+    static KnownHeader classify(std::string_view name);
+
+    /**
+     * Canonical lowercase name of a known header, e.g. "content-type"
+     */
+    static std::string_view nameOf(KnownHeader id);
+
+    /**
+     * Append a field, keeping any earlier field with the same name
+     */
+    void add(std::string_view name, std::string_view value);
+
+    /**
+     * Replace every field with this name by a single one
+     */
+    void set(std::string_view name, std::string_view value);
+
+    /**
+     * Remove every field with this name
+     * @return Number of fields removed
+     */
+    size_t erase(std::string_view name);
+
+    /**
+     * Value of the first field with this name
+     * @return Pointer to the value, or nullptr if absent
+     */
+    const std::string* get(KnownHeader id) const;
+    const std::string* get(std::string_view name) const;
+
+    /**
+     * Values of every field with this name, in arrival order
+     */
+    std::vector<std::string_view> getAll(std::string_view name) const;
+
+    bool contains(KnownHeader id) const { return get(id) != nullptr; }
+    bool contains(std::string_view name) const { return get(name) != nullptr; }
+    size_t count(std::string_view name) const;
+
+    size_t size() const { return fields.size(); }
+    bool empty() const { return fields.empty(); }
+    void reserve(size_t count) { fields.reserve(count); }
+    void clear();
+
+    const_iterator begin() const { return fields.begin(); }
+    const_iterator end() const { return fields.end(); }
+
+private:
+    static const size_t kKnownCount = static_cast<size_t>(KnownHeader::Unknown);
+
+    std::vector<Field> fields;
+    uint16_t slots[kKnownCount];  // index + 1 of the first field per known header; 0 = absent
+
+    void reindex();
+};
+
+#endif // HEADER_TABLE_H
@@ -0,0 +1,101 @@
+#ifndef HTTP_RESPONSE_H
+#define HTTP_RESPONSE_H
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "request/header_table.h"
+
+/**
+ * Monotonic timestamps of the phases of one request.
+ * Phases that did not happen (DNS and connect on a reused connection, or
+ * anything after a failure) keep a default time_point and measure as zero.
+ */
+struct RequestTiming {
+    typedef std::chrono::steady_clock Clock;
+
+    Clock::time_point start;            // request made
+    Clock::time_point acquired;         // pooled socket or connection slot obtained
+    Clock::time_point dnsResolved;
+    Clock::time_point connected;        // TCP handshake finished
+    Clock::time_point requestWritten;
+    Clock::time_point firstByte;        // first response byte received
+    Clock::time_point headersComplete;
+    Clock::time_point bodyComplete;
+    bool connectionReused;
+
+    RequestTiming() : connectionReused(false) {}
+
+    std::chrono::nanoseconds poolWait() const { return between(start, acquired); }
+    std::chrono::nanoseconds dnsTime() const { return between(acquired, dnsResolved); }
+    std::chrono::nanoseconds connectTime() const { return between(dnsResolved, connected); }
+    std::chrono::nanoseconds sendTime() const {
+        return between(connectionReused ? acquired : connected, requestWritten);
+    }
+    std::chrono::nanoseconds timeToFirstByte() const { return between(requestWritten, firstByte); }
+    std::chrono::nanoseconds headerTime() const { return between(firstByte, headersComplete); }
+    std::chrono::nanoseconds bodyTime() const { return between(headersComplete, bodyComplete); }
+    std::chrono::nanoseconds total() const { return between(start, bodyComplete); }
+
+    static std::chrono::nanoseconds between(Clock::time_point from, Clock::time_point to) {
+        if (from == Clock::time_point() || to == Clock::time_point() || to < from) {
+            return std::chrono::nanoseconds(0);
+        }
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(to - from);
+    }
+};
+
+/**
+ * One redirect followed on the way to a response
+ */
+struct RedirectHop {
+    std::string method;
+    std::string url;        // the URL that answered with the redirect
+    int statusCode;         // 301, 302, 303, 307 or 308
+    std::string location;   // Location header as sent
+    RequestTiming timing;
+
+    RedirectHop() : statusCode(0) {}
+};
+
+/**
+ * Why a request produced no usable response
+ */
+enum class HttpError {
+    None,            // a response was received (whatever its status code)
+    InvalidRequest,  // malformed URL, unreadable or unsupported body
+    Resolve,         // the host name did not resolve
+    Connect,         // no address accepted a connection
+    Send,            // writing the request failed
+    Receive,         // reading failed or the connection closed early
+    Protocol,        // the response could not be parsed or decoded
+    Timeout,         // a deadline passed (see RequestTimeouts)
+    Cancelled,       // the request's cancellation token fired
+    Shutdown         // the client went away before the request completed
+};
+
+/**
+ * Structure to hold parsed HTTP response data
+ */
+struct HttpResponse {
+    std::string httpVersion;    // e.g., "HTTP/1.1"
+    int statusCode;            // e.g., 200, 404, 500
+    std::string reasonPhrase;  // e.g., "OK", "Not Found"
+    HeaderTable headers;       // in arrival order; duplicates are kept
+    std::string body;
+    bool bodyStreamed;         // body went to a BodySink instead of the body field
+    size_t compressedBodySize; // body bytes as received (after chunk decoding)
+    size_t decodedBodySize;    // body bytes after Content-Encoding was removed
+    bool isSuccess;
+    HttpError errorKind;       // what went wrong when isSuccess is false
+    std::string errorMessage;
+    RequestTiming timing;      // filled in by makeHttpRequest and streamHttpRequest
+    std::vector<RedirectHop> redirectChain;  // redirects followed before this response, oldest first
+    bool fromCache;            // served from the response cache (possibly after a 304)
+    
+    // Constructor
+    HttpResponse() : statusCode(0), bodyStreamed(false), compressedBodySize(0), decodedBodySize(0),
+                     isSuccess(false), errorKind(HttpError::None), fromCache(false) {}
+};
+
+#endif // HTTP_RESPONSE_H
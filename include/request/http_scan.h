@@ -0,0 +1,69 @@
+#ifndef HTTP_SCAN_H
+#define HTTP_SCAN_H
+#include <cstddef>
+#include <string_view>
+
+/**
+ * Vectorized byte scanning for the HTTP parse paths.
+ *
+ * Each function is backed by an AVX2 (32 bytes per step), SSE2 (16 bytes
+ * per step) or scalar kernel. The widest kernel the CPU supports is picked
+ * once at startup; on non-x86 targets the scalar kernel is always used.
+ */
+
+/**
+ * Find the first occurrence of a byte
+ * @param data Bytes to scan
+ * @param length Number of bytes
+ * @param c Byte to look for
+ * @return Offset of the byte, or std::string_view::npos if absent
+ */
+size_t scanForByte(const char* data, size_t length, char c);
+
+/**
+ * Find the first CRLF pair
+ * @return Offset of the '\r', or std::string_view::npos if absent
+ */
+size_t scanForCrlf(const char* data, size_t length);
+
+/**
+ * Find the blank line ending an HTTP header block ("\r\n\r\n")
+ * @return Offset of the first '\r', or std::string_view::npos if absent
+ */
+size_t scanForHeaderEnd(const char* data, size_t length);
+
+/**
+ * Compare two strings ignoring ASCII case
+ */
+bool equalsIgnoreCaseAscii(std::string_view a, std::string_view b);
+
+/**
+ * Find a substring ignoring ASCII case
+ * @param needle Must already be lowercase
+ * @return Offset of the match, or std::string_view::npos if absent
+ */
+size_t findIgnoreCaseAscii(std::string_view haystack, std::string_view needle);
+
+/**
+ * Last entry of a comma-separated header list, e.g. the final coding of a
+ * Transfer-Encoding value ("gzip, chunked" -> "chunked")
+ * @return The entry without surrounding whitespace, or an empty view if the list is empty
+ */
+std::string_view lastListEntry(std::string_view value);
+
+/**
+ * Split a status line ("HTTP/1.1 200 OK") into its parts without copying
+ * @param line The status line, without its CRLF
+ * @param version Receives the protocol version
+ * @param statusCode Receives the numeric status code
+ * @param reason Receives the reason phrase (may be empty)
+ * @return false if the version or a numeric status code is missing
+ */
+bool splitStatusLine(std::string_view line, std::string_view& version, int& statusCode, std::string_view& reason);
+
+/**
+ * Name of the kernel selected at runtime: "avx2", "sse2" or "scalar"
+ */
+const char* scanKernelName();
+
+#endif // HTTP_SCAN_H
@@ -8,8 +8,8 @@
 #include <unistd.h>     // For close
 #include <sstream>      // For stringstream
 #include <map>          // For headers storage
+#include "request/http_response.h"
 
-struct HttpResponse;
 std::string receiveHttpResponse(int sockfd);
 HttpResponse parseHttpResponse(const std::string& rawResponse);
 void printHttpResponse(const HttpResponse& response); 
@@ -0,0 +1,120 @@
+#ifndef REQUEST_BODY_H
+#define REQUEST_BODY_H
+#include <sys/types.h>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include "request/http_response.h"
+
+/**
+ * Body of an outgoing request.
+ *
+ * A body is one of:
+ *   - a buffer held in memory, sent in the same writev as the headers;
+ *   - a range of a file descriptor, sent with sendfile (or splice from a
+ *     pipe), so the data never passes through user space;
+ *   - a generator callback of unknown length, sent with chunked transfer coding.
+ *
+ * Copies share the file descriptor and the generator, so a body is cheap to
+ * pass around; a generator or pipe body can only be sent once.
+ */
+class RequestBody {
+public:
+    enum class Kind { Empty, Buffer, File, Generator };
+
+    /**
+     * Fills buffer with up to capacity bytes of body
+     * @return Bytes written, 0 at the end of the body, -1 to abort the request
+     */
+    typedef std::function<ssize_t(char* buffer, size_t capacity)> Generator;
+
+    static const size_t npos = static_cast<size_t>(-1);
+
+    RequestBody();
+    RequestBody(std::string data);
+    RequestBody(const char* data);
+
+    /**
+     * Send part of an open file descriptor. The caller keeps it open until the request is done.
+     * @param fd Regular file, or a pipe (then length must be given)
+     * @param offset Where the body starts in the file
+     * @param length Bytes to send; npos sends up to the end of the file
+     */
+    static RequestBody fromFile(int fd, off_t offset = 0, size_t length = npos);
+
+    /**
+     * Open a file and send all of it. The descriptor is closed with the last copy of the body.
+     * @param path File to send
+     * @return The body; on failure hasError() is set and the request fails with getError()
+     */
+    static RequestBody fromPath(const std::string& path);
+
+    /**
+     * Send whatever a callback produces, with chunked transfer coding
+     */
+    static RequestBody fromGenerator(Generator generator);
+
+    Kind getKind() const { return kind; }
+    bool empty() const { return kind == Kind::Empty; }
+
+    /**
+     * Whether the length is known up front (everything but a generator)
+     */
+    bool hasLength() const { return kind != Kind::Generator; }
+    size_t getLength() const { return length; }
+
+    /**
+     * Whether the body goes out with the headers in one write (empty or buffer)
+     */
+    bool isInline() const { return kind == Kind::Empty || kind == Kind::Buffer; }
+
+    /**
+     * Whether the body can be sent again, e.g. after a stale pooled connection.
+     * A generator or a pipe is consumed by the first send, so neither is.
+     */
+    bool isReplayable() const { return kind != Kind::Generator && !(file && file->pipe); }
+
+    const std::string& getData() const { return data; }
+    bool hasError() const { return !error.empty(); }
+    const std::string& getError() const { return error; }
+
+    /**
+     * Write the whole body to a blocking socket
+     * @param sockfd The socket file descriptor
+     * @param error Receives the reason on failure (optional)
+     * @param errorKind Receives HttpError::Timeout if the socket's send timeout expired,
+     *        HttpError::InvalidRequest for an unreadable body, HttpError::Send otherwise (optional)
+     * @return true once the body (and, for a generator, the last chunk) is written
+     */
+    bool sendTo(int sockfd, std::string* error = nullptr, HttpError* errorKind = nullptr) const;
+
+    /**
+     * Write as much of a buffer or file body as the socket takes (non-blocking use)
+     * @param sockfd The socket file descriptor
+     * @param offset Body bytes already written
+     * @return Bytes written, or -1 with errno set; a generator body fails with ENOTSUP
+     */
+    ssize_t sendFrom(int sockfd, size_t offset) const;
+
+private:
+    struct FileHandle {
+        int fd;
+        bool owned;
+        bool pipe;
+        ~FileHandle();
+    };
+
+    Kind kind;
+    std::string data;
+    std::shared_ptr<FileHandle> file;
+    off_t offset;
+    size_t length;
+    std::shared_ptr<Generator> generator;
+    std::string error;
+
+    bool sendFile(int sockfd, std::string* error, HttpError* errorKind) const;
+    bool sendChunked(int sockfd, std::string* error, HttpError* errorKind) const;
+};
+
+#endif // REQUEST_BODY_H
@@ -0,0 +1,144 @@
+#ifndef REQUEST_BUILDER_H
+#define REQUEST_BUILDER_H
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "request/http_response.h"
+#include "request/request_body.h"
+
+typedef std::vector<std::pair<std::string, std::string>> HeaderList;
+
+class OutgoingRequest;
+
+/**
+ * Prebuilt header block for one origin.
+ *
+ * Host, User-Agent, Accept and the other headers that are the same on every
+ * request to an origin are formatted once, when the template is made. Each
+ * request then only formats its request line and its own headers; the
+ * cached block and the body are sent from where they already live.
+ */
+class RequestTemplate {
+public:
+    /**
+     * Constructor
+     * @param hostname Origin host (an IPv6 literal is bracketed in the Host header)
+     * @param port Origin port; 80 is left out of the Host header
+     * @param defaults Headers sent on every request after Host, in order
+     */
+    RequestTemplate(const std::string& hostname, int port, const HeaderList& defaults);
+
+    /**
+     * Headers the client sends by default
+     * @return User-Agent, Accept, Accept-Encoding and Connection: keep-alive
+     */
+    static HeaderList defaultHeaders();
+
+    /**
+     * Serialize a request into out, which is cleared first.
+     * A request header with the same name as a cached one replaces it.
+     * A body of known length gets a Content-Length header unless one is
+     * given (so do POST, PUT and PATCH without a body); a generator body
+     * gets Transfer-Encoding: chunked. Only a buffer body is included in
+     * the segments, and not when waiting for 100 Continue; otherwise
+     * out.bodyFollows() is set and the caller sends the body itself.
+     * @param method The HTTP method
+     * @param path The request target
+     * @param headers Per-request headers
+     * @param body Request body; must stay alive and unchanged while out is in use
+     * @param expectContinue Add Expect: 100-continue (ignored without a body)
+     * @param out Receives the request as a list of segments
+     */
+    void build(std::string_view method, std::string_view path, const HeaderList& headers,
+               const RequestBody& body, bool expectContinue, OutgoingRequest& out) const;
+
+    const std::string& getBlock() const { return block; }
+
+private:
+    std::string block;                       // "Host: ...\r\n" followed by the defaults
+    std::vector<std::pair<size_t, size_t>> lines;  // offset and length of each line of block
+    std::vector<std::string> names;          // header name of each line
+};
+
+/**
+ * A serialized request ready for writev.
+ *
+ * Segments point into the request's own request line and header strings,
+ * into the RequestTemplate it was built from and into the caller's body, so
+ * those must outlive it. It cannot be copied or moved, since that would
+ * leave the segments pointing at the old strings; build it in place.
+ */
+class OutgoingRequest {
+public:
+    OutgoingRequest() : totalBytes(0), bodyPending(false) {}
+    OutgoingRequest(const OutgoingRequest&) = delete;
+    OutgoingRequest& operator=(const OutgoingRequest&) = delete;
+
+    const std::vector<iovec>& getSegments() const { return segments; }
+    size_t size() const { return totalBytes; }
+    bool empty() const { return totalBytes == 0; }
+
+    /**
+     * Whether the body still has to be sent after these segments
+     */
+    bool bodyFollows() const { return bodyPending; }
+    void clear();
+
+    /**
+     * Copy the request into one string (for logging and tests)
+     */
+    std::string toString() const;
+
+    /**
+     * Write the whole request to a blocking socket
+     * @param sockfd The socket file descriptor
+     * @param errorKind Receives why the write failed (optional, see writeFailureKind())
+     * @return true once every byte is written
+     */
+    bool sendAll(int sockfd, HttpError* errorKind = nullptr) const;
+
+    /**
+     * Write as much as the socket takes, starting offset bytes in
+     * @return Bytes written, or -1 with errno set (EAGAIN on a full non-blocking socket)
+     */
+    ssize_t sendFrom(int sockfd, size_t offset) const;
+
+    /**
+     * The segments still to write once offset bytes went out, the first one trimmed
+     * @param offset Bytes already written
+     * @param out Receives the segments (replacing its contents)
+     */
+    void segmentsFrom(size_t offset, std::vector<iovec>& out) const;
+
+private:
+    friend class RequestTemplate;
+
+    std::string head;     // request line
+    std::string headers;  // per-request header lines and the blank line
+    std::vector<iovec> segments;
+    size_t totalBytes;
+    bool bodyPending;
+
+    void append(const char* data, size_t length);
+};
+
+/**
+ * Write a list of segments to a blocking socket, resuming after partial writes
+ * @param sockfd The socket file descriptor
+ * @param segments Data to write; consumed as it is written
+ * @return true once every byte is written
+ */
+bool writeSegments(int sockfd, std::vector<iovec> segments);
+
+/**
+ * Classify a failed socket write
+ * @param error errno of the failed call, saved before anything else can change it
+ * @return HttpError::Timeout if the socket's send timeout (SO_SNDTIMEO) expired, HttpError::Send otherwise
+ */
+HttpError writeFailureKind(int error);
+
+#endif // REQUEST_BUILDER_H
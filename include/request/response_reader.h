@@ -0,0 +1,273 @@
+#ifndef RESPONSE_READER_H
+#define RESPONSE_READER_H
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include <sys/uio.h>
+#include "request/body_sink.h"
+#include "request/chunked_decoder.h"
+#include "request/http_response.h"
+
+/**
+ * Incremental HTTP/1.x response reader.
+ *
+ * Bytes are fed in as they arrive from the socket. The reader parses the
+ * header block as soon as it is complete and then uses the message framing
+ * (Content-Length, chunked transfer coding, or read-until-close) to decide
+ * exactly where the response ends, so the socket can be kept open for the
+ * next request. Interim 1xx responses (other than 101) are skipped.
+ *
+ * The raw message (header block and still-encoded body) is accumulated
+ * binary-safe and can be handed to the existing response parsers. With
+ * setDechunkInPlace() a buffered chunked body is instead compacted over its
+ * framing as it is decoded, so the message ends up holding the payload and
+ * the body does not have to be decoded a second time.
+ *
+ * Chunked bodies are decoded as they arrive, so the end of the message is
+ * known without rescanning and payload reaches a body sink before the last
+ * chunk has been received. With a BodySink attached, body bytes (with chunk
+ * framing removed) are passed to the sink straight from the receive buffer
+ * instead of being kept, so memory stays bounded by the receive buffer
+ * whatever the size of the response.
+ */
+class ResponseReader {
+public:
+    enum class State {
+        Headers,       // waiting for the blank line ending the header block
+        Body,          // reading a Content-Length body
+        Chunked,       // decoding a chunked body (see getChunkedDecoder())
+        UntilClose,    // body is delimited by the server closing the connection
+        Complete,
+        Error
+    };
+
+    enum class Framing {
+        None,           // no body (HEAD, 1xx, 204, 304)
+        ContentLength,
+        Chunked,
+        CloseDelimited
+    };
+
+    typedef std::function<void(ResponseReader& reader)> HeadersCallback;
+
+    /**
+     * Constructor
+     * @param headRequest true if the response answers a HEAD request (no body follows)
+     */
+    explicit ResponseReader(bool headRequest = false);
+
+    /**
+     * Start over for a new response on the same connection.
+     * The body sink and headers callback stay attached.
+     * @param headRequest true if the response answers a HEAD request
+     */
+    void reset(bool headRequest = false);
+
+    /**
+     * Consume received bytes
+     * @param data Pointer to the received bytes
+     * @param length Number of bytes available
+     * @return Number of bytes that belong to this response; anything past
+     *         that is the start of the next response on the connection
+     */
+    size_t feed(const char* data, size_t length);
+
+    /**
+     * Signal that the peer closed the connection
+     */
+    void finish();
+
+    /**
+     * Give up on the response because a deadline passed
+     * @param reason Becomes the error; getErrorKind() reports HttpError::Timeout
+     */
+    void timeOut(const std::string& reason);
+
+    /**
+     * Stream the body into a sink instead of buffering it
+     * @param sink Destination for body bytes, or nullptr to buffer (default)
+     */
+    void setBodySink(BodySink* sink) { bodySink = sink; }
+
+    /**
+     * Decode a buffered chunked body in place (default: keep the chunk framing).
+     * Stays set across reset(); ignored while a body sink is attached.
+     */
+    void setDechunkInPlace(bool enable) { dechunkInPlace = enable; }
+
+    /**
+     * Whether the body in getMessage() has had its chunk framing removed
+     * (the Transfer-Encoding header is left as received)
+     */
+    bool isBodyDechunked() const { return bodyDechunked; }
+
+    /**
+     * Register a callback run once the final header block has been parsed,
+     * before any body byte is consumed. It may attach a body sink.
+     */
+    void setHeadersCallback(HeadersCallback callback) { headersCallback = std::move(callback); }
+
+    bool isComplete() const { return state == State::Complete; }
+    bool hasError() const { return state == State::Error; }
+    bool headersComplete() const { return headerLength != 0; }
+
+    /**
+     * Whether the connection may carry another request after this response
+     */
+    bool isKeepAlive() const;
+
+    State getState() const { return state; }
+    Framing getFraming() const { return framing; }
+    int getStatusCode() const { return statusCode; }
+
+    /**
+     * Declared Content-Length, or -1 when the body is framed otherwise
+     */
+    long long getContentLength() const { return contentLength; }
+
+    /**
+     * Body bytes (transfer-decoded) seen so far
+     */
+    uint64_t getBodyBytes() const { return bodyBytes; }
+    const std::string& getError() const { return error; }
+
+    /**
+     * Protocol for a malformed response, Receive for a premature close or a
+     * rejecting sink, Timeout after timeOut(); None without an error
+     */
+    HttpError getErrorKind() const { return errorKind; }
+
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * When the first byte, the end of the final header block, and the end
+     * of the response arrived (default time_point until then)
+     */
+    Clock::time_point getFirstByteTime() const { return firstByteTime; }
+    Clock::time_point getHeadersTime() const { return headersTime; }
+    Clock::time_point getCompleteTime() const { return completeTime; }
+
+    /**
+     * Chunk decoder state, e.g. trailer fields once a chunked response is complete
+     */
+    const ChunkedDecoder& getChunkedDecoder() const { return chunkedDecoder; }
+
+    /**
+     * Length of the header block including the terminating blank line
+     */
+    size_t getHeaderLength() const { return headerLength; }
+
+    /**
+     * Raw bytes of the response consumed so far (only the header block when
+     * a body sink is attached; see isBodyDechunked() for a chunked body)
+     */
+    const std::string& getMessage() const { return message; }
+
+    /**
+     * Move the raw response out of the reader
+     */
+    std::string takeMessage();
+
+private:
+    State state;
+    Framing framing;
+    bool headRequest;
+    bool connectionClose;
+    bool http11;
+    int statusCode;
+    size_t headerLength;
+    size_t cursor;          // parse position within message
+    size_t scanFrom;        // where to resume looking for the end of the headers
+    size_t bytesRemaining;  // of the Content-Length body
+    long long contentLength;
+    uint64_t bodyBytes;
+    bool dechunkInPlace;
+    bool bodyDechunked;
+    std::string message;
+    std::string error;
+    HttpError errorKind;
+    BodySink* bodySink;
+    HeadersCallback headersCallback;
+    ChunkedDecoder chunkedDecoder;
+    std::vector<iovec> payload;
+    Clock::time_point firstByteTime;
+    Clock::time_point headersTime;
+    Clock::time_point completeTime;
+
+    size_t findLineEnd() const;
+    void advance();
+    bool consumeBody(size_t length);
+    bool deliver(const char* data, size_t length);
+    bool parseHeaderBlock();
+    void fail(const std::string& reason, HttpError kind = HttpError::Protocol);
+};
+
+/**
+ * Limits on how long readHttpResponse waits (default: none)
+ */
+struct ReadDeadline {
+    typedef std::chrono::steady_clock Clock;
+
+    Clock::time_point complete;      // the whole response must have arrived by then
+    Clock::time_point firstByte;     // its first byte must have arrived by then
+    std::chrono::milliseconds idle;  // longest wait for more once bytes arrive (0: no limit)
+
+    ReadDeadline() : complete(Clock::time_point::max()), firstByte(Clock::time_point::max()), idle(0) {}
+
+    bool isSet() const {
+        return complete != Clock::time_point::max() || firstByte != Clock::time_point::max() || idle.count() > 0;
+    }
+};
+
+/**
+ * Receive one complete HTTP response from a socket
+ * @param sockfd The socket file descriptor
+ * @param reader Reader to drive; inspect it afterwards for completion and keep-alive
+ * @param pending In: bytes already read from the connection but not yet parsed.
+ *                Out: bytes read past the end of this response
+ * @return true if a complete response was read, false on error or premature close
+ */
+bool readHttpResponse(int sockfd, ResponseReader& reader, std::string& pending);
+
+/**
+ * Receive one complete HTTP response from a socket
+ * @param sockfd The socket file descriptor
+ * @param reader Reader to drive; inspect it afterwards for completion and keep-alive
+ * @return true if a complete response was read, false on error or premature close
+ */
+bool readHttpResponse(int sockfd, ResponseReader& reader);
+
+/**
+ * Receive one complete HTTP response from a socket within a deadline.
+ * The socket is polled between reads; when a limit passes the reader is
+ * timed out (see ResponseReader::timeOut) and false is returned.
+ * @param sockfd The socket file descriptor
+ * @param reader Reader to drive
+ * @param pending As for readHttpResponse(int, ResponseReader&, std::string&)
+ * @param deadline When to give up
+ * @return true if a complete response was read in time
+ */
+bool readHttpResponse(int sockfd, ResponseReader& reader, std::string& pending, const ReadDeadline& deadline);
+
+enum class ContinueResult {
+    Continue,       // 100 Continue received: send the body
+    Timeout,        // nothing yet: send the body anyway
+    FinalResponse,  // the server answered without waiting for the body
+    Closed          // the connection failed or was closed
+};
+
+/**
+ * Wait for the interim response to a request sent with Expect: 100-continue.
+ * Other 1xx responses are skipped; the 100 Continue itself is consumed.
+ * @param sockfd The socket file descriptor
+ * @param timeoutMs How long to wait before sending the body regardless
+ * @param pending Receives bytes read past the interim response (the start
+ *                of the final response); pass it on to readHttpResponse
+ * @return What the server said
+ */
+ContinueResult awaitContinue(int sockfd, int timeoutMs, std::string& pending);
+
+#endif // RESPONSE_READER_H
@@ -0,0 +1,203 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+
+/**
+ One resolved socket address. The port is left at 0; use withPort() before connecting.
+*/
+struct ResolvedAddress {
+    sockaddr_storage address;
+    socklen_t length;
+
+    int family() const { return address.ss_family; }
+    const sockaddr* sockaddrPtr() const { return reinterpret_cast<const sockaddr*>(&address); }
+
+    /**
+     Copy of this address with the given port filled in
+     @params: port - TCP port in host byte order
+    */
+    ResolvedAddress withPort(int port) const;
+
+    /**
+     Numeric form of the address, e.g. "127.0.0.1" or "::1"
+    */
+    std::string toString() const;
+};
+
+/**
+ Outcome of a name lookup
+*/
+struct ResolveResult {
+    std::vector<ResolvedAddress> addresses;
+    int error;                 // 0 on success, otherwise a getaddrinfo EAI_* code
+    std::chrono::seconds ttl;  // 0 means "use the resolver's default"
+
+    ResolveResult() : error(0), ttl(0) {}
+    bool ok() const { return error == 0 && !addresses.empty(); }
+    std::string errorMessage() const;
+};
+
+/**
+ Cache and worker pool configuration for DnsResolver
+*/
+struct ResolverOptions {
+    size_t workerThreads;              // lookup threads
+    std::chrono::seconds positiveTtl;  // used when the lookup reports no TTL
+    std::chrono::seconds negativeTtl;  // how long failures are remembered
+    size_t maxEntries;                 // cache capacity (pinned entries included)
+
+    ResolverOptions()
+        : workerThreads(2), positiveTtl(60), negativeTtl(5), maxEntries(4096) {}
+};
+
+/**
+ Caching, asynchronous host name resolver.
+
+ Successful lookups are cached for their TTL (or the configured default,
+ since getaddrinfo does not report one) and failures are cached for a
+ shorter negative TTL. Lookups run on a small pool of worker threads so the
+ caller never blocks inside getaddrinfo unless it asks to wait, and
+ concurrent lookups of the same name share a single query. Entries can be
+ preloaded, or pinned so that they never expire, for example from a
+ hosts-style file at startup.
+
+ The lookup function is injectable, so the resolver can be exercised
+ offline against local names or a stub.
+*/
+class DnsResolver {
+public:
+    typedef std::function<ResolveResult(const std::string& hostname)> LookupFunction;
+    typedef std::function<void(const ResolveResult& result)> ResolveCallback;
+
+    struct Stats {
+        uint64_t hits = 0;          // answered from the positive cache
+        uint64_t negativeHits = 0;  // answered from the negative cache
+        uint64_t misses = 0;        // a lookup had to be started
+        uint64_t coalesced = 0;     // joined a lookup already in flight
+    };
+
+    /**
+     Constructor
+     @params: options - cache and pool configuration
+              lookup  - function performing the actual query (default: getaddrinfo)
+    */
+    explicit DnsResolver(const ResolverOptions& options = ResolverOptions(), LookupFunction lookup = systemLookup);
+
+    /**
+     Destructor - stops the worker threads
+    */
+    ~DnsResolver();
+
+    DnsResolver(const DnsResolver&) = delete;
+    DnsResolver& operator=(const DnsResolver&) = delete;
+
+    /**
+     Resolve a name and wait for the answer
+    */
+    ResolveResult resolve(const std::string& hostname);
+
+    /**
+     Resolve a name without blocking
+     @return: future shared with every concurrent caller asking for the same name
+    */
+    std::shared_future<ResolveResult> resolveAsync(const std::string& hostname);
+
+    /**
+     Resolve a name without blocking; the callback runs on a resolver thread,
+     or immediately on the calling thread when the answer is cached
+    */
+    void resolveAsync(const std::string& hostname, ResolveCallback callback);
+
+    /**
+     Cache addresses for a name for the given TTL (a pinned name keeps its pin)
+    */
+    void preload(const std::string& hostname, const std::vector<ResolvedAddress>& addresses,
+                 std::chrono::seconds ttl);
+
+    /**
+     Cache addresses for a name permanently (until unpin() or clear())
+    */
+    void pin(const std::string& hostname, const std::vector<ResolvedAddress>& addresses);
+    void unpin(const std::string& hostname);
+
+    /**
+     Pin every entry of a hosts-style file ("address name [aliases...]", '#' comments)
+     @return: number of names loaded, or -1 if the file could not be read
+    */
+    int loadHostsFile(const std::string& path);
+
+    /**
+     Drop every cached entry, pinned ones included
+    */
+    void clear();
+
+    Stats getStats() const;
+
+    /**
+     Look a name up with getaddrinfo (blocking)
+    */
+    static ResolveResult systemLookup(const std::string& hostname);
+
+    /**
+     Parse a numeric IPv4/IPv6 literal without any lookup
+     @return: true if hostname was a numeric address
+    */
+    static bool parseNumericAddress(const std::string& hostname, ResolvedAddress& address);
+
+    /**
+     Process-wide resolver used when none is supplied
+    */
+    static std::shared_ptr<DnsResolver> getDefault();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+    typedef std::multimap<Clock::time_point, std::string> ExpiryIndex;
+
+    struct CacheEntry {
+        ResolveResult result;
+        Clock::time_point expires;
+        bool pinned;
+        ExpiryIndex::iterator expiry;  // position in expiryOrder (unpinned entries only)
+    };
+
+    struct InFlight {
+        std::promise<ResolveResult> promise;
+        std::shared_future<ResolveResult> future;
+        std::vector<ResolveCallback> callbacks;
+    };
+
+    ResolverOptions options;
+    LookupFunction lookup;
+
+    mutable std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::map<std::string, CacheEntry> cache;
+    ExpiryIndex expiryOrder;  // unpinned entries, soonest to expire first
+    std::map<std::string, std::shared_ptr<InFlight>> inFlight;
+    std::deque<std::string> work;
+    std::vector<std::thread> workers;
+    bool stopping;
+    Stats stats;
+
+    bool findCachedLocked(const std::string& hostname, ResolveResult& result);
+    std::shared_ptr<InFlight> startLookupLocked(const std::string& hostname);
+    void storeLocked(const std::string& hostname, const ResolveResult& result, bool pinned,
+                     std::chrono::seconds ttl);
+    void eraseLocked(std::map<std::string, CacheEntry>::iterator entry);
+    void workerLoop();
+};
+
+#endif // RESOLVER_H
@@ -1,13 +1,56 @@
 #ifndef SOCKET_H
 #define SOCKET_H
+#include <chrono>
 #include <string>
+#include <vector>
+#include "socket/resolver.h"
 
 using std::string;
 
+/**
+ Deadlines for establishing a TCP connection
+*/
+struct ConnectOptions {
+    std::chrono::milliseconds attemptDelay;    // head start given to each attempt before the next one starts
+    std::chrono::milliseconds attemptTimeout;  // give up on a single address after this long
+    std::chrono::milliseconds overallTimeout;  // give up on the host after this long
+
+    ConnectOptions()
+        : attemptDelay(250), attemptTimeout(5000), overallTimeout(15000) {}
+};
+
 /**
  Creates a connection between the server and client via a hostname and port
  @params: 
 */
 int createConnection(const string& hostname, int port);
 
+/**
+ Same as above, resolving the hostname through the given (caching) resolver
+ @params: resolver - resolver to look the hostname up with
+*/
+int createConnection(const string& hostname, int port, DnsResolver& resolver);
+
+/**
+ Connects to the first reachable address of a resolved host (default deadlines)
+ @params: addresses - candidates from DnsResolver
+          port      - TCP port to connect to
+ @return: connected socket descriptor, or -1 if every address failed
+*/
+int connectToAddresses(const std::vector<ResolvedAddress>& addresses, int port);
+
+/**
+ Happy Eyeballs (RFC 8305) connection establishment.
+ Addresses are interleaved by family, IPv6 first, and attempted with
+ non-blocking connects staggered by attemptDelay; a failed attempt starts
+ the next one immediately. The first socket to connect wins and the other
+ attempts are closed. The returned socket is in blocking mode.
+ @params: addresses - candidates from DnsResolver
+          port      - TCP port to connect to
+          options   - per-attempt and overall deadlines
+ @return: connected socket descriptor, or -1 with errno set (ETIMEDOUT when a deadline hit)
+*/
+int connectToAddresses(const std::vector<ResolvedAddress>& addresses, int port,
+                       const ConnectOptions& options);
+
 #endif // SOCKET_H
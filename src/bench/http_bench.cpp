@@ -0,0 +1,372 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "processing/processing.h"
+#include "request/chunked_decoder.h"
+#include "request/http_scan.h"
+#include "request/receive_request.h"
+#include "request/response_reader.h"
+#include "request/send_request.h"
+
+// Allocation counting: every global operator new in the process goes through here.
+// The replacements allocate and free through out-of-line helpers so GCC does not
+// pair an inlined malloc with a delete expression (-Wmismatched-new-delete).
+namespace {
+std::atomic<uint64_t> allocationCount(0);
+
+__attribute__((noinline)) void* countedAllocate(size_t size, size_t alignment) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0) {
+        size = 1;
+    }
+    if (alignment <= alignof(std::max_align_t)) {
+        return std::malloc(size);
+    }
+    // aligned_alloc wants the size to be a multiple of the alignment
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+__attribute__((noinline)) void countedRelease(void* p) noexcept {
+    std::free(p);
+}
+
+void* allocateOrThrow(size_t size, size_t alignment) {
+    if (void* p = countedAllocate(size, alignment)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+} // namespace
+
+void* operator new(size_t size) {
+    return allocateOrThrow(size, 0);
+}
+
+void* operator new[](size_t size) {
+    return allocateOrThrow(size, 0);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocate(size, 0);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocate(size, 0);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    return allocateOrThrow(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return allocateOrThrow(size, static_cast<size_t>(alignment));
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return countedAllocate(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return countedAllocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* p) noexcept {
+    countedRelease(p);
+}
+
+void operator delete[](void* p) noexcept {
+    countedRelease(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    countedRelease(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    countedRelease(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    countedRelease(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    countedRelease(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    countedRelease(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept {
+    countedRelease(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+    countedRelease(p);
+}
+
+void operator delete[](void* p, size_t, std::align_val_t) noexcept {
+    countedRelease(p);
+}
+
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept {
+    countedRelease(p);
+}
+
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept {
+    countedRelease(p);
+}
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const char* kCorpusNames[] = {"small", "large", "many_headers", "chunked", "binary", "gzip"};
+
+struct CorpusEntry {
+    std::string name;
+    std::string raw;
+};
+
+struct Benchmark {
+    std::string name;
+    size_t bytesPerOp;
+    std::function<void()> body;
+};
+
+struct Result {
+    uint64_t iterations;
+    double nsPerOp;
+    double allocsPerOp;
+};
+
+struct Options {
+    std::string corpusDir;
+    std::string filter;
+    double minSeconds;
+    int repetitions;
+
+    Options() : corpusDir(std::string(DATA_DIR) + "corpus/"), minSeconds(0.25), repetitions(3) {}
+};
+
+// Keep the compiler from discarding a result it can prove is unused
+template <class T>
+void doNotOptimize(const T& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+bool loadCorpus(const std::string& dir, std::vector<CorpusEntry>& corpus) {
+    for (const char* name : kCorpusNames) {
+        std::ifstream file(dir + name + ".http", std::ios::binary);
+        if (!file) {
+            std::cerr << "http_bench: cannot read " << dir << name << ".http" << std::endl;
+            return false;
+        }
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        corpus.push_back(CorpusEntry{name, contents.str()});
+    }
+    return true;
+}
+
+Result measure(const Benchmark& benchmark, uint64_t iterations) {
+    uint64_t allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+    Clock::time_point start = Clock::now();
+    for (uint64_t i = 0; i < iterations; ++i) {
+        benchmark.body();
+    }
+    Clock::time_point end = Clock::now();
+    uint64_t allocations = allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+
+    Result result;
+    result.iterations = iterations;
+    result.nsPerOp = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+    result.allocsPerOp = static_cast<double>(allocations) / iterations;
+    return result;
+}
+
+Result run(const Benchmark& benchmark, const Options& options) {
+    // Grow the iteration count until one run lasts at least minSeconds
+    uint64_t iterations = 1;
+    Result result = measure(benchmark, iterations);
+    while (result.nsPerOp * iterations < options.minSeconds * 1e9) {
+        double elapsed = std::max(result.nsPerOp * iterations, 1.0);
+        double scale = std::min(std::max(options.minSeconds * 1e9 * 1.2 / elapsed, 2.0), 100.0);
+        iterations = static_cast<uint64_t>(iterations * scale);
+        result = measure(benchmark, iterations);
+    }
+
+    // Report the fastest repetition; slower ones measure scheduler noise
+    for (int i = 1; i < options.repetitions; ++i) {
+        Result again = measure(benchmark, iterations);
+        if (again.nsPerOp < result.nsPerOp) {
+            result = again;
+        }
+    }
+    return result;
+}
+
+std::vector<Benchmark> buildBenchmarks(const std::vector<CorpusEntry>& corpus, SimpleHttpClient& client) {
+    std::vector<Benchmark> benchmarks;
+
+    for (const CorpusEntry& entry : corpus) {
+        const std::string& raw = entry.raw;
+
+        benchmarks.push_back(Benchmark{"client_parse/" + entry.name, raw.length(), [&client, &raw]() {
+            HttpResponse response = client.parseHttpResponse(raw);
+            doNotOptimize(response);
+        }});
+        benchmarks.push_back(Benchmark{"client_parse_view/" + entry.name, raw.length(), [&client, &raw]() {
+            HttpResponseView view = client.parseHttpResponseView(raw);
+            doNotOptimize(view);
+        }});
+        benchmarks.push_back(Benchmark{"free_parse/" + entry.name, raw.length(), [&raw]() {
+            HttpResponse response = parseHttpResponse(raw);
+            doNotOptimize(response);
+        }});
+        benchmarks.push_back(Benchmark{"reader_feed/" + entry.name, raw.length(), [&raw]() {
+            // Framing on the receive path, fed in recv()-sized pieces
+            ResponseReader reader;
+            for (size_t pos = 0; pos < raw.length() && !reader.isComplete(); pos += 16384) {
+                reader.feed(raw.data() + pos, std::min<size_t>(16384, raw.length() - pos));
+            }
+            doNotOptimize(reader);
+        }});
+        benchmarks.push_back(Benchmark{"reader_parse/" + entry.name, raw.length(), [&client, &raw]() {
+            // The client's receive path: frame (de-chunking in place), then parse
+            ResponseReader reader;
+            reader.setDechunkInPlace(true);
+            for (size_t pos = 0; pos < raw.length() && !reader.isComplete(); pos += 16384) {
+                reader.feed(raw.data() + pos, std::min<size_t>(16384, raw.length() - pos));
+            }
+            HttpResponse response = client.parseHttpResponse(reader);
+            doNotOptimize(response);
+        }});
+
+        if (entry.name == "chunked") {
+            static std::string encoded;
+            encoded = raw.substr(scanForHeaderEnd(raw.data(), raw.length()) + 4);
+
+            // decodeChunkedBody decodes a copy of the body in place
+            benchmarks.push_back(Benchmark{"chunked_decode/chunked", encoded.length(), []() {
+                std::string body = encoded;
+                ChunkedDecoder::decodeBody(body);
+                doNotOptimize(body);
+            }});
+            benchmarks.push_back(Benchmark{"chunked_decode_iovec/chunked", encoded.length(), []() {
+                static std::vector<iovec> payload;
+                payload.clear();
+                ChunkedDecoder decoder;
+                decoder.decode(encoded.data(), encoded.length(), payload);
+                doNotOptimize(payload);
+            }});
+        }
+    }
+
+    std::string sample = client.formatHttpRequest("example.com", "/api/v1/items?page=2&limit=50");
+    benchmarks.push_back(Benchmark{"format_request/client", sample.length(), [&client]() {
+        std::string request = client.formatHttpRequest("example.com", "/api/v1/items?page=2&limit=50");
+        doNotOptimize(request);
+    }});
+    benchmarks.push_back(Benchmark{"format_request/template", sample.length(), [&client]() {
+        static HttpRequest request("example.com", "/api/v1/items?page=2&limit=50");
+        static OutgoingRequest outgoing;
+        client.buildRequest(request, outgoing);
+        doNotOptimize(outgoing);
+    }});
+    benchmarks.push_back(Benchmark{"format_request/free", sample.length(), []() {
+        std::string request = formatHttpRequest("example.com", "/api/v1/items?page=2&limit=50");
+        doNotOptimize(request);
+    }});
+
+    return benchmarks;
+}
+
+bool checkCorpus(const std::vector<CorpusEntry>& corpus, SimpleHttpClient& client) {
+    bool ok = true;
+    for (const CorpusEntry& entry : corpus) {
+        HttpResponse response = client.parseHttpResponse(entry.raw);
+        if (!response.isSuccess) {
+            std::cerr << "http_bench: " << entry.name << ": " << response.errorMessage << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+void printUsage() {
+    std::cout << "Usage: http_bench [--filter=SUBSTRING] [--min-time=SECONDS] "
+              << "[--repetitions=N] [--corpus=DIR]" << std::endl;
+}
+
+bool parseArguments(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 9, "--filter=") == 0) {
+            options.filter = arg.substr(9);
+        } else if (arg.compare(0, 11, "--min-time=") == 0) {
+            options.minSeconds = std::atof(arg.c_str() + 11);
+        } else if (arg.compare(0, 14, "--repetitions=") == 0) {
+            options.repetitions = std::max(1, std::atoi(arg.c_str() + 14));
+        } else if (arg.compare(0, 9, "--corpus=") == 0) {
+            options.corpusDir = arg.substr(9);
+            if (!options.corpusDir.empty() && options.corpusDir.back() != '/') {
+                options.corpusDir += '/';
+            }
+        } else {
+            printUsage();
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseArguments(argc, argv, options)) {
+        return 2;
+    }
+
+    std::vector<CorpusEntry> corpus;
+    if (!loadCorpus(options.corpusDir, corpus)) {
+        return 1;
+    }
+
+    SimpleHttpClient client;
+    if (!checkCorpus(corpus, client)) {
+        return 1;
+    }
+
+    std::vector<Benchmark> benchmarks = buildBenchmarks(corpus, client);
+
+    std::printf("scan kernel: %s\n\n", scanKernelName());
+    std::printf("%-34s %12s %12s %12s %12s\n", "Benchmark", "ns/op", "MB/s", "allocs/op", "iterations");
+    std::printf("%s\n", std::string(86, '-').c_str());
+
+    for (const Benchmark& benchmark : benchmarks) {
+        if (!options.filter.empty() && benchmark.name.find(options.filter) == std::string::npos) {
+            continue;
+        }
+        Result result = run(benchmark, options);
+        double megabytesPerSecond = benchmark.bytesPerOp / result.nsPerOp * 1e9 / (1024.0 * 1024.0);
+        std::printf("%-34s %12.1f %12.1f %12.1f %12llu\n", benchmark.name.c_str(), result.nsPerOp,
+                    megabytesPerSecond, result.allocsPerOp,
+                    static_cast<unsigned long long>(result.iterations));
+    }
+    return 0;
+}
@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench/latency_histogram.h"
+#include "processing/async_client.h"
+#include "processing/processing.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options {
+    std::string url;
+    size_t connections;
+    size_t threads;
+    std::chrono::milliseconds duration;
+    uint64_t requests;  // 0 runs for the duration instead
+    double rate;        // total requests/sec; 0 runs closed-loop
+
+    Options() : connections(10), threads(2), duration(10000), requests(0), rate(0.0) {}
+};
+
+struct Tally {
+    LatencyHistogram serviceTime;  // from actual send to completion (microseconds)
+    LatencyHistogram latency;      // from scheduled send to completion (open-loop only)
+    uint64_t completed;
+    uint64_t errors;
+    uint64_t non2xx;
+    uint64_t bodyBytes;
+    std::string firstError;
+
+    Tally() : completed(0), errors(0), non2xx(0), bodyBytes(0) {}
+};
+
+// Hands out permission to send, by count or until the deadline
+class Budget {
+public:
+    Budget(uint64_t requests, Clock::time_point deadline) : requests(requests), deadline(deadline), issued(0) {}
+
+    bool take(Clock::time_point sendTime) {
+        if (requests > 0) {
+            return issued.fetch_add(1) < requests;
+        }
+        return sendTime < deadline;
+    }
+
+private:
+    uint64_t requests;
+    Clock::time_point deadline;
+    std::atomic<uint64_t> issued;
+};
+
+uint64_t microsecondsBetween(Clock::time_point from, Clock::time_point to) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(to - from).count());
+}
+
+void account(Tally& tally, const HttpResponse& response) {
+    tally.completed++;
+    if (!response.isSuccess) {
+        if (tally.errors++ == 0) {
+            tally.firstError = response.errorMessage;
+        }
+        return;
+    }
+    if (!SimpleHttpClient::isSuccessStatusCode(response.statusCode)) {
+        tally.non2xx++;
+    }
+    tally.bodyBytes += response.body.length();
+}
+
+// Each connection sends its next request as soon as the previous one completes
+void runClosedLoop(const HttpRequest& request, size_t connections, Budget& budget, Tally& tally) {
+    AsyncHttpClient client(connections);
+    std::function<void()> issue = [&]() {
+        Clock::time_point sent = Clock::now();
+        if (!budget.take(sent)) {
+            return;
+        }
+        client.submit(request, [&, sent](HttpResponse response) {
+            tally.serviceTime.record(microsecondsBetween(sent, Clock::now()));
+            account(tally, response);
+            issue();
+        });
+    };
+
+    for (size_t i = 0; i < connections; ++i) {
+        issue();
+    }
+    while (client.pendingCount() > 0) {
+        client.runOnce(100);
+    }
+}
+
+// Requests are sent on a fixed schedule whether or not earlier ones have
+// completed; latency is measured from the scheduled time, so a stall is
+// charged to every request that should have gone out during it
+void runOpenLoop(const HttpRequest& request, size_t connections, double rate, Budget& budget, Tally& tally) {
+    AsyncHttpClient client(connections);
+    std::chrono::nanoseconds interval(static_cast<long long>(1e9 / rate));
+    Clock::time_point start = Clock::now();
+    uint64_t scheduled = 0;
+    bool sending = true;
+
+    while (sending || client.pendingCount() > 0) {
+        Clock::time_point now = Clock::now();
+        while (sending) {
+            Clock::time_point intended = start + interval * scheduled;
+            if (intended > now) {
+                break;
+            }
+            if (!budget.take(intended)) {
+                sending = false;
+                break;
+            }
+            scheduled++;
+            client.submit(request, [&tally, intended, now](HttpResponse response) {
+                Clock::time_point done = Clock::now();
+                tally.latency.record(microsecondsBetween(intended, done));
+                tally.serviceTime.record(microsecondsBetween(now, done));
+                account(tally, response);
+            });
+        }
+
+        int timeoutMs = 100;
+        if (sending) {
+            auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(start + interval * scheduled - Clock::now());
+            timeoutMs = static_cast<int>(std::min<long long>(std::max<long long>(wait.count(), 0), 100));
+        }
+        client.runOnce(timeoutMs);
+    }
+}
+
+void printUsage() {
+    std::cout << "Usage: http_load [--connections=N] [--threads=N] [--duration=SECONDS | --requests=N]\n"
+              << "                 [--rate=REQUESTS_PER_SECOND] URL\n\n"
+              << "  URL is parsed like SimpleHttpClient::get, e.g. http://127.0.0.1:8080/index.html\n"
+              << "  --rate switches from closed-loop to open-loop (constant arrival rate)" << std::endl;
+}
+
+bool parseArguments(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0) {
+            options.url = arg;
+            continue;
+        }
+        size_t equals = arg.find('=');
+        std::string name = arg.substr(0, equals);
+        double value = equals == std::string::npos ? 0.0 : std::atof(arg.c_str() + equals + 1);
+
+        if (name == "--connections" && value >= 1) {
+            options.connections = static_cast<size_t>(value);
+        } else if (name == "--threads" && value >= 1) {
+            options.threads = static_cast<size_t>(value);
+        } else if (name == "--duration" && value > 0) {
+            options.duration = std::chrono::milliseconds(static_cast<long long>(value * 1000));
+        } else if (name == "--requests" && value >= 1) {
+            options.requests = static_cast<uint64_t>(value);
+        } else if (name == "--rate" && value > 0) {
+            options.rate = value;
+        } else {
+            printUsage();
+            return false;
+        }
+    }
+    if (options.url.empty()) {
+        printUsage();
+        return false;
+    }
+    options.threads = std::min(options.threads, options.connections);
+    return true;
+}
+
+void printDistribution(const LatencyHistogram& uncorrected, const LatencyHistogram& corrected) {
+    const double percentiles[] = {50.0, 75.0, 90.0, 99.0, 99.9, 99.99, 100.0};
+    std::printf("  Latency distribution (ms)   uncorrected    corrected\n");
+    for (double percentile : percentiles) {
+        std::printf("    %8.3f%%              %11.3f  %11.3f\n", percentile,
+                    uncorrected.valueAtPercentile(percentile) / 1000.0,
+                    corrected.valueAtPercentile(percentile) / 1000.0);
+    }
+    std::printf("    mean                   %11.3f  %11.3f\n", uncorrected.getMean() / 1000.0,
+                corrected.getMean() / 1000.0);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseArguments(argc, argv, options)) {
+        return 2;
+    }
+
+    HttpRequest request;
+    if (!SimpleHttpClient::parseUrl(options.url, request.hostname, request.path, request.port)) {
+        std::cerr << "http_load: invalid URL " << options.url << std::endl;
+        return 2;
+    }
+
+    bool openLoop = options.rate > 0;
+    std::printf("http_load: http://%s:%d%s, %zu threads and %zu connections, ", request.hostname.c_str(),
+                request.port, request.path.c_str(), options.threads, options.connections);
+    if (options.requests > 0) {
+        std::printf("%llu requests, ", static_cast<unsigned long long>(options.requests));
+    } else {
+        std::printf("%.1f s, ", options.duration.count() / 1000.0);
+    }
+    if (openLoop) {
+        std::printf("open-loop at %.1f req/s\n\n", options.rate);
+    } else {
+        std::printf("closed-loop\n\n");
+    }
+
+    Clock::time_point start = Clock::now();
+    Budget budget(options.requests, start + options.duration);
+    std::vector<Tally> tallies(options.threads);
+    std::vector<std::thread> workers;
+
+    for (size_t i = 0; i < options.threads; ++i) {
+        size_t connections = options.connections / options.threads + (i < options.connections % options.threads ? 1 : 0);
+        workers.emplace_back([&, i, connections]() {
+            if (openLoop) {
+                double threadRate = options.rate * connections / options.connections;
+                runOpenLoop(request, connections, threadRate, budget, tallies[i]);
+            } else {
+                runClosedLoop(request, connections, budget, tallies[i]);
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    Tally total;
+    for (const Tally& tally : tallies) {
+        total.serviceTime.add(tally.serviceTime);
+        total.latency.add(tally.latency);
+        total.completed += tally.completed;
+        total.errors += tally.errors;
+        total.non2xx += tally.non2xx;
+        total.bodyBytes += tally.bodyBytes;
+        if (total.firstError.empty()) {
+            total.firstError = tally.firstError;
+        }
+    }
+
+    std::printf("  Requests:   %llu completed, %llu errors, %llu non-2xx\n",
+                static_cast<unsigned long long>(total.completed), static_cast<unsigned long long>(total.errors),
+                static_cast<unsigned long long>(total.non2xx));
+    std::printf("  Elapsed:    %.3f s\n", elapsed);
+    std::printf("  Throughput: %.1f req/s, %.2f MiB/s of body\n\n", total.completed / elapsed,
+                total.bodyBytes / elapsed / (1024.0 * 1024.0));
+
+    if (openLoop) {
+        // Measured from each request's scheduled send time
+        printDistribution(total.serviceTime, total.latency);
+        std::printf("\n  corrected: measured from the scheduled send time (open-loop)\n");
+    } else {
+        // A closed loop never sends the requests a stall delays; back-fill them
+        // as if each connection had been issuing one request per mean latency
+        uint64_t expectedInterval = static_cast<uint64_t>(total.serviceTime.getMean());
+        printDistribution(total.serviceTime, total.serviceTime.corrected(expectedInterval));
+        std::printf("\n  corrected: back-filled at the mean latency of %.3f ms (closed-loop)\n",
+                    expectedInterval / 1000.0);
+    }
+
+    if (!total.firstError.empty()) {
+        std::printf("  first error: %s\n", total.firstError.c_str());
+    }
+    return total.errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+#include "bench/latency_histogram.h"
+#include <algorithm>
+#include <cmath>
+
+LatencyHistogram::LatencyHistogram(uint64_t highestTrackable, int significantDigits)
+    : highestTrackable(std::max<uint64_t>(highestTrackable, 2)), totalCount(0), minValue(UINT64_MAX), maxValue(0) {
+    significantDigits = std::min(std::max(significantDigits, 1), 5);
+    this->significantDigits = significantDigits;
+
+    // Enough linear sub-buckets per power of two to keep the requested precision
+    uint64_t singleUnitResolution = 2 * static_cast<uint64_t>(std::pow(10, significantDigits));
+    int subBucketCountMagnitude = static_cast<int>(std::ceil(std::log2(static_cast<double>(singleUnitResolution))));
+    subBucketHalfCountMagnitude = std::max(subBucketCountMagnitude, 1) - 1;
+    uint64_t subBucketCount = 1ULL << subBucketCountMagnitude;
+    subBucketHalfCount = subBucketCount / 2;
+    subBucketMask = subBucketCount - 1;
+    leadingZeroCountBase = 64 - subBucketHalfCountMagnitude - 1;
+
+    size_t bucketCount = 1;
+    uint64_t smallestUntrackable = subBucketCount;
+    while (smallestUntrackable <= this->highestTrackable) {
+        if (smallestUntrackable > UINT64_MAX / 2) {
+            ++bucketCount;
+            break;
+        }
+        smallestUntrackable <<= 1;
+        ++bucketCount;
+    }
+    counts.assign((bucketCount + 1) * subBucketHalfCount, 0);
+}
+
+void LatencyHistogram::record(uint64_t value, uint64_t count) {
+    value = std::min(std::max<uint64_t>(value, 1), highestTrackable);
+    counts[indexOf(value)] += count;
+    totalCount += count;
+    minValue = std::min(minValue, value);
+    maxValue = std::max(maxValue, value);
+}
+
+void LatencyHistogram::recordCorrected(uint64_t value, uint64_t expectedInterval, uint64_t count) {
+    record(value, count);
+    if (expectedInterval == 0 || value <= expectedInterval) {
+        return;
+    }
+    for (uint64_t missing = value - expectedInterval; missing >= expectedInterval; missing -= expectedInterval) {
+        record(missing, count);
+    }
+}
+
+LatencyHistogram LatencyHistogram::corrected(uint64_t expectedInterval) const {
+    LatencyHistogram result(highestTrackable, significantDigits);
+    for (size_t i = 0; i < counts.size(); ++i) {
+        if (counts[i] != 0) {
+            result.recordCorrected(valueAtIndex(i), expectedInterval, counts[i]);
+        }
+    }
+    return result;
+}
+
+void LatencyHistogram::add(const LatencyHistogram& other) {
+    size_t shared = std::min(counts.size(), other.counts.size());
+    for (size_t i = 0; i < shared; ++i) {
+        counts[i] += other.counts[i];
+    }
+    totalCount += other.totalCount;
+    if (other.totalCount != 0) {
+        minValue = std::min(minValue, other.minValue);
+        maxValue = std::max(maxValue, other.maxValue);
+    }
+}
+
+void LatencyHistogram::reset() {
+    std::fill(counts.begin(), counts.end(), 0);
+    totalCount = 0;
+    minValue = UINT64_MAX;
+    maxValue = 0;
+}
+
+uint64_t LatencyHistogram::valueAtPercentile(double percentile) const {
+    if (totalCount == 0) {
+        return 0;
+    }
+    percentile = std::min(std::max(percentile, 0.0), 100.0);
+    uint64_t target = static_cast<uint64_t>(std::ceil(percentile / 100.0 * totalCount));
+    target = std::max<uint64_t>(target, 1);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= target) {
+            return std::min(highestEquivalentValue(valueAtIndex(i)), maxValue);
+        }
+    }
+    return maxValue;
+}
+
+double LatencyHistogram::getMean() const {
+    if (totalCount == 0) {
+        return 0.0;
+    }
+    double sum = 0.0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        if (counts[i] != 0) {
+            uint64_t low = valueAtIndex(i);
+            sum += counts[i] * (low + (highestEquivalentValue(low) - low) / 2.0);
+        }
+    }
+    return sum / totalCount;
+}
+
+// Private helper methods
+size_t LatencyHistogram::indexOf(uint64_t value) const {
+    int bucketIndex = leadingZeroCountBase - __builtin_clzll(value | subBucketMask);
+    uint64_t subBucketIndex = value >> bucketIndex;
+    return (static_cast<size_t>(bucketIndex + 1) << subBucketHalfCountMagnitude) +
+           static_cast<size_t>(subBucketIndex - subBucketHalfCount);
+}
+
+uint64_t LatencyHistogram::valueAtIndex(size_t index) const {
+    int bucketIndex = static_cast<int>(index >> subBucketHalfCountMagnitude) - 1;
+    uint64_t subBucketIndex = (index & (subBucketHalfCount - 1)) + subBucketHalfCount;
+    if (bucketIndex < 0) {
+        subBucketIndex -= subBucketHalfCount;
+        bucketIndex = 0;
+    }
+    return subBucketIndex << bucketIndex;
+}
+
+uint64_t LatencyHistogram::highestEquivalentValue(uint64_t value) const {
+    int bucketIndex = leadingZeroCountBase - __builtin_clzll(value | subBucketMask);
+    uint64_t lowest = (value >> bucketIndex) << bucketIndex;
+    return lowest + (1ULL << bucketIndex) - 1;
+}
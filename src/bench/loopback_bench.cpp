@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench/stand_in_server.h"
+#include "processing/coro_client.h"
+#include "processing/processing.h"
+#include "processing/uring_transport.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options {
+    size_t concurrency;
+    uint64_t requests;
+    uint64_t warmup;
+    bool coro;                // CoroHttpClient on one scheduler instead of blocking threads
+    TransportKind transport;  // coroutine client only
+    StandInOptions server;
+
+    Options() : concurrency(8), requests(20000), warmup(500), coro(false), transport(TransportKind::Auto) {}
+};
+
+struct WorkerResult {
+    std::vector<uint64_t> latenciesNs;
+    uint64_t errors;
+    uint64_t bodyBytes;
+
+    WorkerResult() : errors(0), bodyBytes(0) {}
+};
+
+void printUsage() {
+    std::cout << "Usage: loopback_bench [--concurrency=N] [--requests=N] [--warmup=N]\n"
+              << "                      [--size=BYTES] [--chunked] [--chunk-size=BYTES]\n"
+              << "                      [--close] [--delay-us=MICROSECONDS]\n"
+              << "                      [--coro | --transport=auto|epoll|uring]\n\n"
+              << "  --coro runs CoroHttpClient with --concurrency requests in flight on one thread;\n"
+              << "  --transport picks its backend (implies --coro)" << std::endl;
+}
+
+bool parseArguments(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t equals = arg.find('=');
+        std::string name = arg.substr(0, equals);
+        long long value = equals == std::string::npos ? 0 : std::atoll(arg.c_str() + equals + 1);
+
+        if (name == "--concurrency" && value > 0) {
+            options.concurrency = static_cast<size_t>(value);
+        } else if (name == "--requests" && value > 0) {
+            options.requests = static_cast<uint64_t>(value);
+        } else if (name == "--warmup" && value >= 0) {
+            options.warmup = static_cast<uint64_t>(value);
+        } else if (name == "--size" && value >= 0) {
+            options.server.responseSize = static_cast<size_t>(value);
+        } else if (name == "--chunked") {
+            options.server.chunked = true;
+        } else if (name == "--chunk-size" && value > 0) {
+            options.server.chunkSize = static_cast<size_t>(value);
+        } else if (name == "--close") {
+            options.server.keepAlive = false;
+        } else if (name == "--delay-us" && value >= 0) {
+            options.server.delay = std::chrono::microseconds(value);
+        } else if (name == "--coro") {
+            options.coro = true;
+        } else if (name == "--transport" && equals != std::string::npos) {
+            std::string kind = arg.substr(equals + 1);
+            if (kind == "auto") {
+                options.transport = TransportKind::Auto;
+            } else if (kind == "epoll") {
+                options.transport = TransportKind::Epoll;
+            } else if (kind == "uring") {
+                options.transport = TransportKind::IoUring;
+            } else {
+                printUsage();
+                return false;
+            }
+            options.coro = true;
+        } else {
+            printUsage();
+            return false;
+        }
+    }
+    return true;
+}
+
+// Run `total` requests spread over `concurrency` threads sharing one connection pool
+std::vector<WorkerResult> drive(const SimpleHttpClient& prototype, int port, size_t concurrency, uint64_t total) {
+    std::atomic<uint64_t> next(0);
+    std::vector<WorkerResult> results(concurrency);
+    std::vector<std::thread> workers;
+
+    for (size_t i = 0; i < concurrency; ++i) {
+        workers.emplace_back([&, i]() {
+            SimpleHttpClient client(prototype);  // copies share the pool
+            WorkerResult& result = results[i];
+            result.latenciesNs.reserve(total / concurrency + 1);
+
+            while (next.fetch_add(1) < total) {
+                Clock::time_point start = Clock::now();
+                HttpResponse response = client.makeHttpRequest("127.0.0.1", "/", port);
+                Clock::time_point end = Clock::now();
+
+                result.latenciesNs.push_back(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+                if (!response.isSuccess || response.statusCode != 200) {
+                    result.errors++;
+                }
+                result.bodyBytes += response.body.length();
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    return results;
+}
+
+Task<void> coroWorker(CoroHttpClient& client, int port, uint64_t& next, uint64_t total, WorkerResult& result) {
+    while (next < total) {
+        ++next;
+        Clock::time_point start = Clock::now();
+        // Named rather than a temporary in the co_await expression (g++ 12)
+        Task<HttpResponse> request = client.makeHttpRequest(HttpRequest("127.0.0.1", "/", port));
+        HttpResponse response = co_await std::move(request);
+        Clock::time_point end = Clock::now();
+
+        result.latenciesNs.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        if (!response.isSuccess || response.statusCode != 200) {
+            result.errors++;
+        }
+        result.bodyBytes += response.body.length();
+    }
+}
+
+// Run `total` requests with `concurrency` of them in flight on the scheduler's thread
+std::vector<WorkerResult> driveCoro(IoScheduler& scheduler, CoroHttpClient& client, int port, size_t concurrency,
+                                    uint64_t total) {
+    uint64_t next = 0;
+    std::vector<WorkerResult> results(concurrency);
+    for (size_t i = 0; i < concurrency; ++i) {
+        results[i].latenciesNs.reserve(total / concurrency + 1);
+        scheduler.spawn(coroWorker(client, port, next, total, results[i]));
+    }
+    scheduler.run();
+    return results;
+}
+
+const char* transportName(TransportKind kind) {
+    switch (kind) {
+        case TransportKind::Epoll:
+            return "epoll";
+        case TransportKind::IoUring:
+            return "io_uring";
+        case TransportKind::Auto:
+            break;
+    }
+    return "auto";
+}
+
+double percentileMs(const std::vector<uint64_t>& sorted, double percentile) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * sorted.size()));
+    rank = std::min(std::max<size_t>(rank, 1), sorted.size());
+    return sorted[rank - 1] / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseArguments(argc, argv, options)) {
+        return 2;
+    }
+
+    StandInServer server(options.server);
+    if (!server.start()) {
+        std::cerr << "loopback_bench: cannot start the stand-in server" << std::endl;
+        return 1;
+    }
+
+    SimpleHttpClient client;
+    client.getConnectionPool().setMaxConnectionsPerHost(options.concurrency);
+    IoScheduler scheduler;
+    std::unique_ptr<CoroHttpClient> coroClient;
+    UringTransport* uring = nullptr;
+    if (options.coro) {
+        coroClient = std::make_unique<CoroHttpClient>(scheduler, nullptr, 5,
+                                                      Transport::create(scheduler, options.transport));
+        uring = dynamic_cast<UringTransport*>(coroClient->getTransport().get());
+    }
+
+    std::printf("loopback_bench: %zu connections, %llu requests, %zu-byte bodies, %s, %s, delay %lldus\n",
+                options.concurrency, static_cast<unsigned long long>(options.requests),
+                options.server.responseSize, options.server.chunked ? "chunked" : "content-length",
+                options.server.keepAlive ? "keep-alive" : "close",
+                static_cast<long long>(options.server.delay.count()));
+    if (coroClient) {
+        std::printf("client:        CoroHttpClient on one thread, %s transport\n\n",
+                    transportName(coroClient->getTransport()->getKind()));
+    } else {
+        std::printf("client:        SimpleHttpClient on %zu threads\n\n", options.concurrency);
+    }
+
+    if (options.warmup > 0) {
+        if (coroClient) {
+            driveCoro(scheduler, *coroClient, server.getPort(), options.concurrency, options.warmup);
+        } else {
+            drive(client, server.getPort(), options.concurrency, options.warmup);
+        }
+    }
+    PoolStats before = client.getPoolStats();
+    UringStats uringBefore = uring != nullptr ? uring->getStats() : UringStats();
+    uint64_t acceptedBefore = server.getConnectionsAccepted();
+
+    Clock::time_point start = Clock::now();
+    std::vector<WorkerResult> results =
+        coroClient ? driveCoro(scheduler, *coroClient, server.getPort(), options.concurrency, options.requests)
+                   : drive(client, server.getPort(), options.concurrency, options.requests);
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<uint64_t> latencies;
+    uint64_t errors = 0;
+    uint64_t bodyBytes = 0;
+    for (const WorkerResult& result : results) {
+        latencies.insert(latencies.end(), result.latenciesNs.begin(), result.latenciesNs.end());
+        errors += result.errors;
+        bodyBytes += result.bodyBytes;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    PoolStats after = client.getPoolStats();
+
+    std::printf("requests:      %llu (%llu errors)\n", static_cast<unsigned long long>(latencies.size()),
+                static_cast<unsigned long long>(errors));
+    std::printf("elapsed:       %.3f s\n", elapsed);
+    std::printf("throughput:    %.1f req/s (%.1f MiB/s of body)\n", latencies.size() / elapsed,
+                bodyBytes / elapsed / (1024.0 * 1024.0));
+    std::printf("latency p50:   %.3f ms\n", percentileMs(latencies, 50.0));
+    std::printf("latency p99:   %.3f ms\n", percentileMs(latencies, 99.0));
+    std::printf("latency p99.9: %.3f ms\n", percentileMs(latencies, 99.9));
+    std::printf("latency max:   %.3f ms\n", latencies.empty() ? 0.0 : latencies.back() / 1e6);
+    if (coroClient) {
+        std::printf("connections:   %llu opened by the server\n",
+                    static_cast<unsigned long long>(server.getConnectionsAccepted() - acceptedBefore));
+    } else {
+        std::printf("connections:   %llu opened by the server; pool hits %llu, misses %llu\n",
+                    static_cast<unsigned long long>(server.getConnectionsAccepted() - acceptedBefore),
+                    static_cast<unsigned long long>(after.hits - before.hits),
+                    static_cast<unsigned long long>(after.misses - before.misses));
+    }
+    if (uring != nullptr) {
+        UringStats uringAfter = uring->getStats();
+        size_t enters = uringAfter.enters - uringBefore.enters;
+        std::printf("io_uring:      %zu operations, %zu completions, %zu io_uring_enter calls (%.3f per request)\n",
+                    uringAfter.operations - uringBefore.operations,
+                    uringAfter.completions - uringBefore.completions, enters,
+                    latencies.empty() ? 0.0 : static_cast<double>(enters) / latencies.size());
+    }
+
+    coroClient.reset();
+
+    server.stop();
+    return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,281 @@
+#include "bench/stand_in_server.h"
+#include "request/http_scan.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+const size_t kFillerBytes = 64 * 1024;
+
+const std::string& filler() {
+    static const std::string bytes = []() {
+        std::string text;
+        const char* line = "The quick brown fox jumps over the lazy dog 0123456789\n";
+        while (text.length() < kFillerBytes) {
+            text += line;
+        }
+        text.resize(kFillerBytes);
+        return text;
+    }();
+    return bytes;
+}
+
+void appendFiller(std::string& out, size_t length) {
+    while (length > 0) {
+        size_t take = std::min(length, kFillerBytes);
+        out.append(filler(), 0, take);
+        length -= take;
+    }
+}
+
+bool writeAll(int fd, const std::string& data) {
+    size_t total = 0;
+    while (total < data.length()) {
+        ssize_t sent = send(fd, data.data() + total, data.length() - total, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        total += static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+const char* reasonPhrase(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 404: return "Not Found";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default:  return "Status";
+    }
+}
+
+// Value of a header in a request head, or an empty view
+std::string_view headerValue(std::string_view head, std::string_view name) {
+    size_t pos = scanForCrlf(head.data(), head.length());
+    while (pos != std::string_view::npos && pos + 2 < head.length()) {
+        pos += 2;
+        size_t end = scanForCrlf(head.data() + pos, head.length() - pos);
+        std::string_view line = head.substr(pos, end == std::string_view::npos ? std::string_view::npos : end);
+        size_t colon = line.find(':');
+        if (colon != std::string_view::npos && equalsIgnoreCaseAscii(line.substr(0, colon), name)) {
+            size_t start = line.find_first_not_of(" \t", colon + 1);
+            return start == std::string_view::npos ? std::string_view() : line.substr(start);
+        }
+        pos = end == std::string_view::npos ? end : pos + end;
+    }
+    return std::string_view();
+}
+
+} // namespace
+
+StandInServer::StandInServer(const StandInOptions& options)
+    : options(options), listenFd(-1), port(0), stopping(false), requestsServed(0), connectionsAccepted(0) {}
+
+StandInServer::~StandInServer() {
+    stop();
+}
+
+bool StandInServer::start(int port) {
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd == -1) {
+        return false;
+    }
+    int yes = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof yes);
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof address);
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    socklen_t length = sizeof address;
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof address) == -1 ||
+        listen(listenFd, SOMAXCONN) == -1 ||
+        getsockname(listenFd, reinterpret_cast<sockaddr*>(&address), &length) == -1) {
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+
+    this->port = ntohs(address.sin_port);
+    stopping = false;
+    acceptThread = std::thread(&StandInServer::acceptLoop, this);
+    return true;
+}
+
+void StandInServer::stop() {
+    if (listenFd == -1) {
+        return;
+    }
+    stopping = true;
+    shutdown(listenFd, SHUT_RDWR);  // wakes the blocked accept()
+    acceptThread.join();
+    close(listenFd);
+    listenFd = -1;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for (int fd : openConnections) {
+        shutdown(fd, SHUT_RDWR);
+    }
+    connectionsDone.wait(lock, [this]() { return openConnections.empty(); });
+}
+
+// Private helper methods
+void StandInServer::acceptLoop() {
+    while (!stopping) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd == -1) {
+            if (stopping) {
+                return;
+            }
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno == EMFILE || errno == ENFILE) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            return;
+        }
+
+        int yes = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof yes);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            openConnections.insert(fd);
+        }
+        connectionsAccepted++;
+        std::thread(&StandInServer::serveConnection, this, fd).detach();
+    }
+}
+
+void StandInServer::serveConnection(int fd) {
+    std::string buffer;
+    char chunk[16384];
+    bool keepOpen = true;
+
+    while (keepOpen) {
+        // Answer every complete request already buffered (pipelining)
+        size_t headerEnd = scanForHeaderEnd(buffer.data(), buffer.length());
+        if (headerEnd != std::string::npos) {
+            std::string_view head(buffer.data(), headerEnd + 4);
+            size_t bodyLength = std::strtoull(std::string(headerValue(head, "content-length")).c_str(), nullptr, 10);
+            size_t total = headerEnd + 4 + bodyLength;
+            if (buffer.length() >= total) {
+                std::string requestHead(head);
+                buffer.erase(0, total);
+                if (!answer(fd, requestHead, keepOpen)) {
+                    break;
+                }
+                continue;
+            }
+        }
+
+        ssize_t received = recv(fd, chunk, sizeof chunk, 0);
+        if (received == 0) {
+            break;
+        }
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        buffer.append(chunk, static_cast<size_t>(received));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    openConnections.erase(fd);
+    close(fd);
+    connectionsDone.notify_all();
+}
+
+bool StandInServer::answer(int fd, const std::string& requestHead, bool& keepOpen) {
+    StandInOptions shape = options;
+    int status = 200;
+
+    // Request line: METHOD SP target SP version
+    size_t methodEnd = requestHead.find(' ');
+    size_t targetEnd = requestHead.find(' ', methodEnd + 1);
+    std::string method = requestHead.substr(0, methodEnd);
+    std::string target = requestHead.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+    bool http11 = requestHead.compare(targetEnd + 1, 8, "HTTP/1.1") == 0;
+
+    size_t query = target.find('?');
+    while (query != std::string::npos) {
+        size_t next = target.find('&', query + 1);
+        std::string pair = target.substr(query + 1, next == std::string::npos ? std::string::npos : next - query - 1);
+        size_t equals = pair.find('=');
+        std::string key = pair.substr(0, equals);
+        long long value = equals == std::string::npos ? 1 : std::atoll(pair.c_str() + equals + 1);
+
+        if (key == "size") {
+            shape.responseSize = static_cast<size_t>(value);
+        } else if (key == "chunked") {
+            shape.chunked = value != 0;
+        } else if (key == "chunk_size" && value > 0) {
+            shape.chunkSize = static_cast<size_t>(value);
+        } else if (key == "delay_us") {
+            shape.delay = std::chrono::microseconds(value);
+        } else if (key == "close") {
+            shape.keepAlive = value == 0;
+        } else if (key == "status") {
+            status = static_cast<int>(value);
+        }
+        query = next;
+    }
+
+    std::string_view connection = headerValue(requestHead, "connection");
+    if (!http11 || findIgnoreCaseAscii(connection, "close") != std::string_view::npos) {
+        shape.keepAlive = false;
+    }
+    keepOpen = shape.keepAlive;
+
+    if (shape.delay.count() > 0) {
+        std::this_thread::sleep_for(shape.delay);
+    }
+
+    std::string response = "HTTP/1.1 " + std::to_string(status) + " " + reasonPhrase(status) + "\r\n";
+    response += "Content-Type: text/plain\r\n";
+    if (!shape.keepAlive) {
+        response += "Connection: close\r\n";
+    }
+
+    bool hasBody = method != "HEAD" && status != 204 && status != 304;
+    if (shape.chunked) {
+        response += "Transfer-Encoding: chunked\r\n\r\n";
+        if (hasBody) {
+            size_t remaining = shape.responseSize;
+            while (remaining > 0) {
+                size_t take = std::min(remaining, shape.chunkSize);
+                char sizeLine[32];
+                snprintf(sizeLine, sizeof sizeLine, "%zx\r\n", take);
+                response += sizeLine;
+                appendFiller(response, take);
+                response += "\r\n";
+                remaining -= take;
+            }
+            response += "0\r\n\r\n";
+        }
+    } else {
+        response += "Content-Length: " + std::to_string(shape.responseSize) + "\r\n\r\n";
+        if (hasBody) {
+            appendFiller(response, shape.responseSize);
+        }
+    }
+
+    requestsServed++;
+    return writeAll(fd, response);
+}
@@ -0,0 +1,617 @@
+#include "processing/async_client.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+const int kMaxEvents = 256;
+
+std::string originKey(const std::string& hostname, int port) {
+    return hostname + ":" + std::to_string(port);
+}
+
+// When a limit starting at from runs out, capped by an earlier deadline (no limit: the cap)
+TimerWheel::Clock::time_point limitFrom(TimerWheel::Clock::time_point from, std::chrono::milliseconds limit,
+                                        TimerWheel::Clock::time_point cap) {
+    return limit.count() > 0 ? std::min(cap, from + limit) : cap;
+}
+
+} // namespace
+
+AsyncHttpClient::AsyncHttpClient(size_t maxConnections, std::shared_ptr<DnsResolver> resolver)
+    : maxConnections(maxConnections == 0 ? 1 : maxConnections),
+      epollFd(epoll_create1(EPOLL_CLOEXEC)),
+      wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      resolver(resolver ? resolver : DnsResolver::getDefault()),
+      inbox(std::make_shared<ResolveInbox>()),
+      outstanding(0),
+      nextResolveId(0),
+      running(false),
+      completedCount(0) {
+    inbox->wakeFd = wakeFd;
+    watch(wakeFd, EPOLLIN, true);
+}
+
+AsyncHttpClient::~AsyncHttpClient() {
+    stop();
+
+    {
+        std::lock_guard<std::mutex> lock(inbox->mutex);
+        inbox->closed = true;
+    }
+    for (auto& waiting : resolving) {
+        HttpResponse response;
+        response.errorKind = HttpError::Shutdown;
+        response.errorMessage = "Client shut down before the request was sent";
+        waiting.second->callback(response);
+    }
+    resolving.clear();
+
+    std::deque<PendingRequest> abandoned;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        abandoned.swap(queue);
+    }
+    for (PendingRequest& pending : abandoned) {
+        HttpResponse response;
+        response.errorKind = HttpError::Shutdown;
+        response.errorMessage = "Client shut down before the request was sent";
+        pending.callback(response);
+    }
+
+    std::vector<int> open;
+    for (const auto& entry : connections) {
+        open.push_back(entry.first);
+    }
+    for (int sockfd : open) {
+        if (connections[sockfd]->phase == Phase::Idle) {
+            closeConnection(sockfd);
+        } else {
+            failRequest(sockfd, "Client shut down before the response arrived", HttpError::Shutdown);
+        }
+    }
+
+    close(wakeFd);
+    close(epollFd);
+}
+
+void AsyncHttpClient::submit(const HttpRequest& request, ResponseCallback callback) {
+    RequestTimeouts limits = request.timeouts.withDefaults(timeouts);
+    TimerWheel::Clock::time_point deadline =
+        limitFrom(TimerWheel::Clock::now(), limits.total, TimerWheel::Clock::time_point::max());
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        queue.push_back(PendingRequest{request, std::move(callback), limits, deadline});
+    }
+    outstanding++;
+
+    uint64_t one = 1;
+    ssize_t ignored = write(wakeFd, &one, sizeof one);
+    (void)ignored;
+}
+
+std::future<HttpResponse> AsyncHttpClient::submit(const HttpRequest& request) {
+    auto promise = std::make_shared<std::promise<HttpResponse>>();
+    std::future<HttpResponse> future = promise->get_future();
+    submit(request, [promise](HttpResponse response) {
+        promise->set_value(std::move(response));
+    });
+    return future;
+}
+
+size_t AsyncHttpClient::runOnce(int timeoutMs) {
+    completedCount = 0;
+    deliverResolved();
+    startQueuedRequests();
+
+    if (!timers.empty()) {
+        auto untilTimer =
+            std::chrono::ceil<std::chrono::milliseconds>(timers.nextWakeup() - TimerWheel::Clock::now());
+        int timerMs = static_cast<int>(std::clamp<long long>(untilTimer.count(), 0, std::numeric_limits<int>::max()));
+        timeoutMs = timeoutMs < 0 ? timerMs : std::min(timeoutMs, timerMs);
+    }
+
+    epoll_event events[kMaxEvents];
+    int ready = epoll_wait(epollFd, events, kMaxEvents, timeoutMs);
+
+    for (int i = 0; i < ready; ++i) {
+        int sockfd = events[i].data.fd;
+        if (sockfd == wakeFd) {
+            uint64_t count;
+            ssize_t ignored = read(wakeFd, &count, sizeof count);
+            (void)ignored;
+            continue;
+        }
+        // An earlier event in this batch may already have closed the socket
+        if (connections.count(sockfd) != 0) {
+            handleEvent(sockfd, events[i].events);
+        }
+    }
+
+    // After the events, so a response that arrived in time is not timed out
+    timers.advance(TimerWheel::Clock::now());
+
+    deliverResolved();
+    startQueuedRequests();
+    return completedCount;
+}
+
+void AsyncHttpClient::run() {
+    while (pendingCount() > 0) {
+        runOnce(-1);
+    }
+}
+
+void AsyncHttpClient::start() {
+    if (running.exchange(true)) {
+        return;
+    }
+    loopThread = std::thread([this]() {
+        while (running) {
+            runOnce(100);
+        }
+    });
+}
+
+void AsyncHttpClient::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    uint64_t one = 1;
+    ssize_t ignored = write(wakeFd, &one, sizeof one);
+    (void)ignored;
+    if (loopThread.joinable()) {
+        loopThread.join();
+    }
+}
+
+size_t AsyncHttpClient::pendingCount() const {
+    return outstanding;
+}
+
+void AsyncHttpClient::setTimeouts(const RequestTimeouts& timeouts) {
+    this->timeouts = timeouts;
+}
+
+// Private helper methods
+void AsyncHttpClient::startQueuedRequests() {
+    while (true) {
+        PendingRequest pending;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if (queue.empty()) {
+                return;
+            }
+
+            const HttpRequest& next = queue.front().request;
+            auto idle = idleConnections.find(originKey(next.hostname, next.port));
+            bool hasIdle = idle != idleConnections.end() && !idle->second.empty();
+            bool atCap = connections.size() + resolving.size() >= maxConnections;
+            if (!hasIdle && atCap && !evictIdleConnection()) {
+                return;  // at the connection cap; wait for something to finish
+            }
+
+            pending = std::move(queue.front());
+            queue.pop_front();
+        }
+        startRequest(std::move(pending));
+    }
+}
+
+void AsyncHttpClient::startRequest(PendingRequest pending) {
+    const RequestBody& body = pending.request.body;
+    if (body.hasError() || !body.hasLength()) {
+        // A generator may block, which would stall every other connection on the loop
+        HttpResponse response;
+        response.errorKind = HttpError::InvalidRequest;
+        response.errorMessage = body.hasError() ? body.getError()
+                                                : "AsyncHttpClient cannot send a generator body";
+        outstanding--;
+        completedCount++;
+        pending.callback(std::move(response));
+        return;
+    }
+    TimerWheel::Clock::time_point now = TimerWheel::Clock::now();
+    if (now >= pending.deadline) {
+        // Waited out its time in the queue
+        HttpResponse response;
+        response.errorKind = HttpError::Timeout;
+        response.errorMessage = "Timed out before the request to " + pending.request.hostname + " was sent";
+        outstanding--;
+        completedCount++;
+        pending.callback(std::move(response));
+        return;
+    }
+
+    std::string origin = originKey(pending.request.hostname, pending.request.port);
+    bool headRequest = pending.request.method == "HEAD";
+
+    auto idle = idleConnections.find(origin);
+    if (idle != idleConnections.end() && !idle->second.empty()) {
+        int sockfd = idle->second.back();
+        idle->second.pop_back();
+
+        Connection& connection = *connections[sockfd];
+        connection.phase = Phase::Sending;
+        connection.reused = true;
+        connection.request = std::move(pending.request);
+        connection.callback = std::move(pending.callback);
+        formatter.buildRequest(connection.request, connection.outgoing);
+        connection.sent = 0;
+        connection.reader.reset(headRequest);
+        connection.limits = pending.limits;
+        connection.deadline = pending.deadline;
+        watch(sockfd, EPOLLOUT, false);
+        armTimer(connection);
+        return;
+    }
+
+    std::unique_ptr<Connection> connection(new Connection());
+    connection->origin = origin;
+    connection->request = std::move(pending.request);
+    connection->callback = std::move(pending.callback);
+    formatter.buildRequest(connection->request, connection->outgoing);
+    connection->reader.setDechunkInPlace(true);
+    connection->reader.reset(headRequest);
+    connection->limits = pending.limits;
+    connection->deadline = pending.deadline;
+    connection->connectDeadline = limitFrom(now, pending.limits.connect, pending.deadline);
+    Connection* raw = connection.get();
+    connection->timer.setCallback([this, raw]() { timeOut(*raw); });
+    armTimer(*connection);
+
+    // Resolution happens off the loop thread; deliverResolved() picks it up
+    uint64_t id = nextResolveId++;
+    std::string hostname = connection->request.hostname;
+    connection->resolveId = id;
+    resolving[id] = std::move(connection);
+
+    std::shared_ptr<ResolveInbox> target = inbox;
+    resolver->resolveAsync(hostname, [target, id](const ResolveResult& result) {
+        std::lock_guard<std::mutex> lock(target->mutex);
+        if (target->closed) {
+            return;
+        }
+        target->results.emplace_back(id, result);
+        uint64_t one = 1;
+        ssize_t ignored = write(target->wakeFd, &one, sizeof one);
+        (void)ignored;
+    });
+}
+
+void AsyncHttpClient::deliverResolved() {
+    std::deque<std::pair<uint64_t, ResolveResult>> results;
+    {
+        std::lock_guard<std::mutex> lock(inbox->mutex);
+        results.swap(inbox->results);
+    }
+
+    for (auto& resolved : results) {
+        auto it = resolving.find(resolved.first);
+        if (it == resolving.end()) {
+            continue;
+        }
+        std::unique_ptr<Connection> connection = std::move(it->second);
+        resolving.erase(it);
+
+        for (const ResolvedAddress& address : resolved.second.addresses) {
+            connection->addresses.push_back(address.withPort(connection->request.port));
+        }
+        connectNext(std::move(connection));
+    }
+}
+
+void AsyncHttpClient::connectNext(std::unique_ptr<Connection> connection) {
+    while (connection->nextAddress < connection->addresses.size()) {
+        const ResolvedAddress& address = connection->addresses[connection->nextAddress++];
+
+        int sockfd = socket(address.family(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (sockfd == -1) {
+            continue;
+        }
+
+        if (connect(sockfd, address.sockaddrPtr(), address.length) == 0) {
+            connection->phase = Phase::Sending;
+        } else if (errno == EINPROGRESS) {
+            connection->phase = Phase::Connecting;
+        } else {
+            close(sockfd);
+            continue;
+        }
+
+        connection->sockfd = sockfd;
+        Connection& connected = *connection;
+        connections[sockfd] = std::move(connection);
+        watch(sockfd, EPOLLOUT, true);
+        armTimer(connected);
+        return;
+    }
+
+    // Every address failed (or the name did not resolve)
+    HttpResponse response;
+    response.errorKind = connection->addresses.empty() ? HttpError::Resolve : HttpError::Connect;
+    response.errorMessage = "Failed to establish connection to " + connection->request.hostname;
+    ResponseCallback callback = std::move(connection->callback);
+    outstanding--;
+    completedCount++;
+    callback(response);
+}
+
+void AsyncHttpClient::handleEvent(int sockfd, uint32_t events) {
+    Connection& connection = *connections[sockfd];
+
+    switch (connection.phase) {
+        case Phase::Idle:
+            // The server closed (or wrote to) a pooled socket; drop it
+            closeConnection(sockfd);
+            break;
+        case Phase::Connecting:
+            handleConnecting(sockfd);
+            break;
+        case Phase::Sending:
+            if (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) {
+                handleWritable(sockfd);
+            }
+            break;
+        case Phase::Receiving:
+            if (events & (EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+                handleReadable(sockfd);
+            }
+            break;
+    }
+}
+
+void AsyncHttpClient::handleConnecting(int sockfd) {
+    int error = 0;
+    socklen_t length = sizeof error;
+    if (getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &error, &length) == -1) {
+        error = errno;
+    }
+
+    if (error != 0) {
+        // Move on to the next resolved address
+        std::unique_ptr<Connection> connection = std::move(connections[sockfd]);
+        connections.erase(sockfd);
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, sockfd, nullptr);
+        close(sockfd);
+        connectNext(std::move(connection));
+        return;
+    }
+
+    connections[sockfd]->phase = Phase::Sending;
+    armTimer(*connections[sockfd]);
+    handleWritable(sockfd);
+}
+
+void AsyncHttpClient::handleWritable(int sockfd) {
+    Connection& connection = *connections[sockfd];
+
+    // Headers (and a buffer body) first, then a body that follows them, e.g. a file
+    size_t headerBytes = connection.outgoing.size();
+    size_t total = headerBytes + (connection.outgoing.bodyFollows() ? connection.request.body.getLength() : 0);
+    size_t before = connection.sent;
+    while (connection.sent < total) {
+        ssize_t n = connection.sent < headerBytes
+                        ? connection.outgoing.sendFrom(sockfd, connection.sent)
+                        : connection.request.body.sendFrom(sockfd, connection.sent - headerBytes);
+        if (n > 0) {
+            connection.sent += static_cast<size_t>(n);
+            continue;
+        }
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (connection.sent != before) {
+                armTimer(connection);
+            }
+            return;
+        }
+        if (!retryOnFreshConnection(sockfd)) {
+            failRequest(sockfd, "Failed to send HTTP request", HttpError::Send);
+        }
+        return;
+    }
+
+    connection.phase = Phase::Receiving;
+    watch(sockfd, EPOLLIN | EPOLLRDHUP, false);
+    armTimer(connection);
+}
+
+void AsyncHttpClient::handleReadable(int sockfd) {
+    Connection& connection = *connections[sockfd];
+    char buffer[16384];
+    bool progressed = false;
+
+    while (!connection.reader.isComplete() && !connection.reader.hasError()) {
+        ssize_t n = recv(sockfd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            size_t used = connection.reader.feed(buffer, static_cast<size_t>(n));
+            if (used < static_cast<size_t>(n)) {
+                // Unsolicited bytes after the response: never reuse this stream
+                HttpResponse response = formatter.parseHttpResponse(connection.reader);
+                completeRequest(sockfd, response, false);
+                return;
+            }
+            progressed = true;
+            continue;
+        }
+        if (n == 0) {
+            connection.reader.finish();
+            break;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (progressed) {
+                armTimer(connection);
+            }
+            return;
+        }
+        if (!retryOnFreshConnection(sockfd)) {
+            failRequest(sockfd, std::string("Error receiving response: ") + strerror(errno), HttpError::Receive);
+        }
+        return;
+    }
+
+    if (connection.reader.hasError()) {
+        if (!retryOnFreshConnection(sockfd)) {
+            failRequest(sockfd, connection.reader.getError(), connection.reader.getErrorKind());
+        }
+        return;
+    }
+
+    bool reusable = connection.reader.isKeepAlive();
+    HttpResponse response = formatter.parseHttpResponse(connection.reader);
+    completeRequest(sockfd, response, reusable && response.isSuccess);
+}
+
+void AsyncHttpClient::completeRequest(int sockfd, HttpResponse response, bool reusable) {
+    Connection& connection = *connections[sockfd];
+    ResponseCallback callback = std::move(connection.callback);
+    connection.callback = nullptr;
+    timers.cancel(connection.timer);
+
+    if (reusable) {
+        connection.phase = Phase::Idle;
+        connection.reused = false;
+        connection.outgoing.clear();
+        connection.reader.reset();
+        watch(sockfd, EPOLLIN | EPOLLRDHUP, false);
+        idleConnections[connection.origin].push_back(sockfd);
+    } else {
+        closeConnection(sockfd);
+    }
+
+    outstanding--;
+    completedCount++;
+    callback(std::move(response));
+}
+
+void AsyncHttpClient::failRequest(int sockfd, const std::string& errorMessage, HttpError errorKind) {
+    HttpResponse response;
+    response.errorKind = errorKind;
+    response.errorMessage = errorMessage;
+    completeRequest(sockfd, response, false);
+}
+
+void AsyncHttpClient::armTimer(Connection& connection) {
+    TimerWheel::Clock::time_point now = TimerWheel::Clock::now();
+    TimerWheel::Clock::time_point due = connection.deadline;
+    switch (connection.phase) {
+        case Phase::Connecting:
+            due = std::min(due, connection.connectDeadline);
+            break;
+        case Phase::Sending:
+            due = limitFrom(now, connection.limits.idle, due);
+            break;
+        case Phase::Receiving:
+            if (connection.reader.getFirstByteTime() == ResponseReader::Clock::time_point() &&
+                connection.limits.firstByte.count() > 0) {
+                due = limitFrom(now, connection.limits.firstByte, due);
+            } else {
+                due = limitFrom(now, connection.limits.idle, due);
+            }
+            break;
+        case Phase::Idle:
+            due = TimerWheel::Clock::time_point::max();
+            break;
+    }
+
+    if (due == TimerWheel::Clock::time_point::max()) {
+        timers.cancel(connection.timer);
+    } else {
+        timers.schedule(connection.timer, due);
+    }
+}
+
+void AsyncHttpClient::timeOut(Connection& connection) {
+    const std::string& hostname = connection.request.hostname;
+    if (connection.sockfd == -1) {
+        // Still waiting for the host lookup
+        auto it = resolving.find(connection.resolveId);
+        if (it == resolving.end()) {
+            return;
+        }
+        std::unique_ptr<Connection> expired = std::move(it->second);
+        resolving.erase(it);
+
+        HttpResponse response;
+        response.errorKind = HttpError::Timeout;
+        response.errorMessage = "Timed out connecting to " + hostname;
+        outstanding--;
+        completedCount++;
+        expired->callback(std::move(response));
+        return;
+    }
+
+    std::string errorMessage;
+    if (connection.phase == Phase::Connecting) {
+        errorMessage = "Timed out connecting to " + hostname;
+    } else if (connection.phase == Phase::Sending) {
+        errorMessage = "Timed out sending the request to " + hostname;
+    } else if (connection.reader.getFirstByteTime() == ResponseReader::Clock::time_point()) {
+        errorMessage = "Timed out waiting for the response from " + hostname;
+    } else {
+        errorMessage = "Timed out receiving the response from " + hostname;
+    }
+    failRequest(connection.sockfd, errorMessage, HttpError::Timeout);
+}
+
+bool AsyncHttpClient::retryOnFreshConnection(int sockfd) {
+    // A pooled socket may have been closed by the server just as we reused
+    // it. If nothing came back, an idempotent request can safely go again.
+    Connection& connection = *connections[sockfd];
+    if (!connection.reused || !connection.reader.getMessage().empty() ||
+        !SimpleHttpClient::isIdempotentMethod(connection.request.method)) {
+        return false;
+    }
+
+    PendingRequest pending{std::move(connection.request), std::move(connection.callback),
+                           connection.limits, connection.deadline};
+    closeConnection(sockfd);
+    startRequest(std::move(pending));
+    return true;
+}
+
+void AsyncHttpClient::watch(int sockfd, uint32_t events, bool add) {
+    epoll_event event;
+    memset(&event, 0, sizeof event);
+    event.events = events;
+    event.data.fd = sockfd;
+    epoll_ctl(epollFd, add ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, sockfd, &event);
+}
+
+void AsyncHttpClient::closeConnection(int sockfd) {
+    auto it = connections.find(sockfd);
+    if (it == connections.end()) {
+        return;
+    }
+
+    auto idle = idleConnections.find(it->second->origin);
+    if (idle != idleConnections.end()) {
+        std::vector<int>& sockets = idle->second;
+        sockets.erase(std::remove(sockets.begin(), sockets.end(), sockfd), sockets.end());
+    }
+
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, sockfd, nullptr);
+    close(sockfd);
+    connections.erase(it);
+}
+
+bool AsyncHttpClient::evictIdleConnection() {
+    for (auto& idle : idleConnections) {
+        if (!idle.second.empty()) {
+            closeConnection(idle.second.front());
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,172 @@
+#include "processing/connection_pool.h"
+#include <cerrno>
+#include <sys/socket.h>
+#include <unistd.h>
+
+ConnectionPool::ConnectionPool(size_t maxConnectionsPerHost, std::chrono::milliseconds idleTimeout)
+    : maxConnectionsPerHost(maxConnectionsPerHost == 0 ? 1 : maxConnectionsPerHost),
+      idleTimeout(idleTimeout) {}
+
+ConnectionPool::~ConnectionPool() {
+    closeIdle();
+}
+
+int ConnectionPool::acquire(const std::string& hostname, int port) {
+    int sockfd;
+    acquire(hostname, port, Clock::time_point::max(), sockfd);
+    return sockfd;
+}
+
+bool ConnectionPool::acquire(const std::string& hostname, int port, Clock::time_point deadline, int& sockfd) {
+    std::unique_lock<std::mutex> lock(mutex);
+    HostEntry& entry = hosts[std::make_pair(hostname, port)];
+
+    while (!takeLocked(entry, sockfd)) {
+        if (deadline == Clock::time_point::max()) {
+            slotAvailable.wait(lock);
+        } else if (slotAvailable.wait_until(lock, deadline) == std::cv_status::timeout) {
+            return takeLocked(entry, sockfd);
+        }
+    }
+    return true;
+}
+
+bool ConnectionPool::tryAcquire(const std::string& hostname, int port, int& sockfd) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return takeLocked(hosts[std::make_pair(hostname, port)], sockfd);
+}
+
+void ConnectionPool::release(const std::string& hostname, int port, int sockfd, bool reusable) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        HostEntry& entry = hosts[std::make_pair(hostname, port)];
+
+        if (sockfd != -1 && reusable && entry.openCount <= maxConnectionsPerHost) {
+            entry.idle.push_back(IdleConnection{sockfd, Clock::now()});
+        } else {
+            if (sockfd != -1) {
+                if (reusable) {
+                    // Healthy socket, but the cap was lowered while it was out
+                    stats.evictions++;
+                }
+                close(sockfd);
+            }
+            if (entry.openCount > 0) {
+                entry.openCount--;
+            }
+        }
+    }
+    slotAvailable.notify_one();
+}
+
+void ConnectionPool::pruneExpired() {
+    std::lock_guard<std::mutex> lock(mutex);
+    Clock::time_point now = Clock::now();
+
+    for (auto& host : hosts) {
+        HostEntry& entry = host.second;
+        for (size_t i = entry.idle.size(); i-- > 0;) {
+            if (isExpired(entry.idle[i], now)) {
+                evictLocked(entry, i);
+            }
+        }
+    }
+    slotAvailable.notify_all();
+}
+
+void ConnectionPool::closeIdle() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& host : hosts) {
+        HostEntry& entry = host.second;
+        for (const IdleConnection& connection : entry.idle) {
+            close(connection.sockfd);
+        }
+        entry.openCount -= entry.idle.size();
+        entry.idle.clear();
+    }
+    slotAvailable.notify_all();
+}
+
+size_t ConnectionPool::idleCount(const std::string& hostname, int port) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = hosts.find(std::make_pair(hostname, port));
+    return it == hosts.end() ? 0 : it->second.idle.size();
+}
+
+PoolStats ConnectionPool::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void ConnectionPool::setMaxConnectionsPerHost(size_t maxConnectionsPerHost) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->maxConnectionsPerHost = maxConnectionsPerHost == 0 ? 1 : maxConnectionsPerHost;
+    }
+    slotAvailable.notify_all();
+}
+
+size_t ConnectionPool::getMaxConnectionsPerHost() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return maxConnectionsPerHost;
+}
+
+void ConnectionPool::setIdleTimeout(std::chrono::milliseconds idleTimeout) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->idleTimeout = idleTimeout;
+}
+
+std::chrono::milliseconds ConnectionPool::getIdleTimeout() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return idleTimeout;
+}
+
+// Private helper methods
+bool ConnectionPool::takeLocked(HostEntry& entry, int& sockfd) {
+    Clock::time_point now = Clock::now();
+
+    // Prefer the most recently used socket; it is the least likely to
+    // have been timed out by the server.
+    while (!entry.idle.empty()) {
+        size_t last = entry.idle.size() - 1;
+        if (isExpired(entry.idle[last], now) || isStale(entry.idle[last].sockfd)) {
+            evictLocked(entry, last);
+            continue;
+        }
+
+        sockfd = entry.idle[last].sockfd;
+        entry.idle.pop_back();
+        stats.hits++;
+        return true;
+    }
+
+    if (entry.openCount < maxConnectionsPerHost) {
+        entry.openCount++;
+        stats.misses++;
+        sockfd = -1;
+        return true;
+    }
+    return false;
+}
+
+bool ConnectionPool::isExpired(const IdleConnection& connection, Clock::time_point now) const {
+    return now - connection.idleSince >= idleTimeout;
+}
+
+bool ConnectionPool::isStale(int sockfd) {
+    // An idle keep-alive socket must have nothing to read. EOF means the
+    // server closed it; unexpected bytes mean the stream is out of sync.
+    char byte;
+    ssize_t n = recv(sockfd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (n < 0) {
+        return errno != EAGAIN && errno != EWOULDBLOCK;
+    }
+    return true;
+}
+
+void ConnectionPool::evictLocked(HostEntry& entry, size_t index) {
+    close(entry.idle[index].sockfd);
+    entry.idle.erase(entry.idle.begin() + index);
+    entry.openCount--;
+    stats.evictions++;
+}
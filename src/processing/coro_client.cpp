@@ -0,0 +1,497 @@
+#include "processing/coro_client.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <sys/socket.h>
+
+namespace {
+
+const size_t kReceiveBufferSize = 16384;
+
+std::string originKey(const std::string& hostname, int port) {
+    return hostname + ":" + std::to_string(port);
+}
+
+HttpResponse failure(const std::string& errorMessage, HttpError errorKind, const RequestTiming& timing) {
+    HttpResponse response;
+    response.isSuccess = false;
+    response.errorKind = errorKind;
+    response.errorMessage = errorMessage;
+    response.timing = timing;
+    return response;
+}
+
+const char* const kCancelled = "Request cancelled";
+
+// When a limit starting now runs out, capped by an earlier deadline (no limit: the cap)
+TimerWheel::Clock::time_point deadlineAfter(std::chrono::milliseconds limit, TimerWheel::Clock::time_point cap) {
+    return limit.count() > 0 ? std::min(cap, TimerWheel::Clock::now() + limit) : cap;
+}
+
+// Cancels a request's operations when the limit of its current phase (or
+// its total deadline) runs out. The caller's token cancels them as well.
+class Watchdog {
+public:
+    Watchdog(TimerWheel& timers, const CancellationToken& caller, TimerWheel::Clock::time_point deadline)
+        : timers(timers), deadline(deadline), expired(false) {
+        if (caller.isCancelled()) {
+            source.cancel();
+        } else {
+            link.bind(caller, [this]() { source.cancel(); });
+        }
+        timer.setCallback([this]() {
+            expired = true;
+            source.cancel();
+        });
+        arm(TimerWheel::Clock::time_point::max());
+    }
+
+    Watchdog(const Watchdog&) = delete;
+    Watchdog& operator=(const Watchdog&) = delete;
+
+    CancellationToken getToken() const { return source.getToken(); }
+    bool hasExpired() const { return expired; }
+    bool isCancelled() const { return source.isCancelled(); }
+
+    // Fire at the phase deadline, or at the total deadline if that is sooner
+    void arm(TimerWheel::Clock::time_point phaseDeadline) {
+        TimerWheel::Clock::time_point due = std::min(deadline, phaseDeadline);
+        if (due == TimerWheel::Clock::time_point::max()) {
+            timers.cancel(timer);
+        } else {
+            timers.schedule(timer, due);
+        }
+    }
+
+    void armAfter(std::chrono::milliseconds limit) { arm(deadlineAfter(limit, TimerWheel::Clock::time_point::max())); }
+
+private:
+    TimerWheel& timers;
+    TimerWheel::Clock::time_point deadline;
+    bool expired;
+    CancellationSource source;
+    CancellationRegistration link;
+    TimerWheel::Timer timer;
+};
+
+// A failure caused by the watchdog's token: the caller's cancel or a timeout
+HttpResponse interrupted(const Watchdog& watchdog, const std::string& timedOut, const RequestTiming& timing) {
+    if (watchdog.hasExpired()) {
+        return failure(timedOut, HttpError::Timeout, timing);
+    }
+    return failure(kCancelled, HttpError::Cancelled, timing);
+}
+
+// Suspends until the resolver calls back, unless it answers synchronously
+// (numeric addresses, cached names). Cancelling resumes the coroutine with
+// an empty result and leaves the lookup to finish on its own.
+class ResolveAwaiter {
+public:
+    typedef std::function<void(std::coroutine_handle<>)> Wake;
+
+    ResolveAwaiter(DnsResolver& resolver, std::string hostname, CancellationToken token, Wake wake)
+        : resolver(resolver), hostname(std::move(hostname)), token(std::move(token)),
+          lookup(std::make_shared<Lookup>()) {
+        lookup->wake = std::move(wake);
+    }
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> handle) {
+        lookup->handle = handle;
+        std::shared_ptr<Lookup> state = lookup;
+        resolver.resolveAsync(hostname, [state](const ResolveResult& result) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->result = result;
+            state->done = true;
+            if (state->suspended) {
+                state->wake(state->handle);
+            }
+        });
+        std::lock_guard<std::mutex> lock(lookup->mutex);
+        lookup->suspended = !lookup->done;
+        if (lookup->suspended) {
+            // Whichever of the answer and the cancel comes first wakes the coroutine
+            registration.bind(token, [state]() {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (state->suspended && !state->done) {
+                    state->suspended = false;
+                    state->wake(state->handle);
+                }
+            });
+        }
+        return lookup->suspended;
+    }
+    ResolveResult await_resume() {
+        registration.reset();
+        std::lock_guard<std::mutex> lock(lookup->mutex);
+        return std::move(lookup->result);
+    }
+
+private:
+    // Shared with the resolver's callback, which may outlive the awaiting coroutine
+    struct Lookup {
+        std::mutex mutex;
+        ResolveResult result;
+        bool done = false;
+        bool suspended = false;
+        std::coroutine_handle<> handle;
+        Wake wake;
+    };
+
+    DnsResolver& resolver;
+    std::string hostname;
+    CancellationToken token;
+    std::shared_ptr<Lookup> lookup;
+    CancellationRegistration registration;
+};
+
+} // namespace
+
+CoroHttpClient::CoroHttpClient(IoScheduler& scheduler, std::shared_ptr<DnsResolver> resolver, int maxRedirects,
+                               std::shared_ptr<Transport> transport)
+    : scheduler(scheduler),
+      transport(transport ? transport : Transport::create(scheduler)),
+      resolver(resolver ? resolver : DnsResolver::getDefault()),
+      inbox(std::make_shared<ResolveInbox>()),
+      maxRedirects(maxRedirects),
+      receiveBuffer(kReceiveBufferSize) {
+    inbox->scheduler = &scheduler;
+}
+
+CoroHttpClient::~CoroHttpClient() {
+    {
+        std::lock_guard<std::mutex> lock(inbox->mutex);
+        inbox->scheduler = nullptr;
+    }
+    closeIdle();
+}
+
+Task<int> CoroHttpClient::connect(std::string hostname, int port, CancellationToken token) {
+    RequestTiming unused;
+    HttpError error;
+    co_return co_await openConnection(std::move(hostname), port, std::move(token), unused, error);
+}
+
+Task<bool> CoroHttpClient::send(int sockfd, const OutgoingRequest& request, const RequestBody& body,
+                                CancellationToken token) {
+    std::function<void()> progress;
+    co_return co_await sendWatched(sockfd, request, body, std::move(token), progress);
+}
+
+Task<bool> CoroHttpClient::receive(int sockfd, ResponseReader& reader, std::string& pending,
+                                   CancellationToken token) {
+    std::function<void()> progress;
+    co_return co_await receiveWatched(sockfd, reader, pending, std::move(token), progress);
+}
+
+Task<HttpResponse> CoroHttpClient::makeHttpRequest(HttpRequest request, CancellationToken token) {
+    HttpRequest current = std::move(request);
+    std::vector<RedirectHop> chain;
+    // One total deadline covers every hop
+    TimerWheel::Clock::time_point deadline =
+        deadlineAfter(current.timeouts.withDefaults(timeouts).total, TimerWheel::Clock::time_point::max());
+
+    while (true) {
+        HttpResponse response = co_await performRequest(current, token, deadline);
+
+        HttpRequest next;
+        RedirectHop hop;
+        if (static_cast<int>(chain.size()) >= maxRedirects ||
+            !SimpleHttpClient::followRedirect(current, response, next, hop)) {
+            response.redirectChain = std::move(chain);
+            co_return response;
+        }
+        chain.push_back(std::move(hop));
+        current = std::move(next);
+    }
+}
+
+Task<HttpResponse> CoroHttpClient::get(std::string url, CancellationToken token) {
+    HttpRequest request;
+    if (!SimpleHttpClient::parseUrl(url, request.hostname, request.path, request.port)) {
+        co_return failure("Invalid URL: " + url, HttpError::InvalidRequest, RequestTiming());
+    }
+    co_return co_await makeHttpRequest(std::move(request), std::move(token));
+}
+
+void CoroHttpClient::buildRequest(const HttpRequest& request, OutgoingRequest& out) {
+    formatter.buildRequest(request, out);
+}
+
+void CoroHttpClient::closeIdle() {
+    for (auto& idle : idleConnections) {
+        for (int sockfd : idle.second) {
+            closeSocket(sockfd);
+        }
+    }
+    idleConnections.clear();
+}
+
+size_t CoroHttpClient::idleCount(const std::string& hostname, int port) const {
+    auto idle = idleConnections.find(originKey(hostname, port));
+    return idle == idleConnections.end() ? 0 : idle->second.size();
+}
+
+void CoroHttpClient::setMaxRedirects(int maxRedirects) {
+    this->maxRedirects = maxRedirects;
+}
+
+int CoroHttpClient::getMaxRedirects() const {
+    return maxRedirects;
+}
+
+void CoroHttpClient::setTimeouts(const RequestTimeouts& timeouts) {
+    this->timeouts = timeouts;
+}
+
+const RequestTimeouts& CoroHttpClient::getTimeouts() const {
+    return timeouts;
+}
+
+std::shared_ptr<Transport> CoroHttpClient::getTransport() const {
+    return transport;
+}
+
+// Private helper methods
+Task<int> CoroHttpClient::openConnection(std::string hostname, int port, CancellationToken token,
+                                         RequestTiming& timing, HttpError& error) {
+    error = HttpError::Connect;
+    if (token.isCancelled()) {
+        co_return -1;
+    }
+    std::shared_ptr<ResolveInbox> target = inbox;
+    ResolveAwaiter::Wake wake = [target](std::coroutine_handle<> handle) {
+        std::lock_guard<std::mutex> lock(target->mutex);
+        if (target->scheduler != nullptr) {
+            target->scheduler->post(handle);
+        }
+    };
+    // Named rather than a temporary in the co_await expression: g++ 12 can
+    // destroy such temporaries twice when the frame is torn down
+    ResolveAwaiter lookup(*resolver, hostname, token, std::move(wake));
+    ResolveResult resolved = co_await lookup;
+    timing.dnsResolved = RequestTiming::Clock::now();
+    if (token.isCancelled()) {
+        co_return -1;
+    }
+    if (!resolved.ok()) {
+        error = HttpError::Resolve;
+        co_return -1;
+    }
+
+    for (const ResolvedAddress& candidate : resolved.addresses) {
+        ResolvedAddress address = candidate.withPort(port);
+        int sockfd = socket(address.family(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (sockfd == -1) {
+            continue;
+        }
+        int result = co_await transport->connect(sockfd, address, token);
+        if (result == 0) {
+            timing.connected = RequestTiming::Clock::now();
+            co_return sockfd;
+        }
+        closeSocket(sockfd);
+        if (result == -ECANCELED) {
+            co_return -1;
+        }
+    }
+    co_return -1;
+}
+
+Task<HttpResponse> CoroHttpClient::performRequest(const HttpRequest& request, CancellationToken token,
+                                                  TimerWheel::Clock::time_point deadline) {
+    RequestTiming timing;
+    timing.start = RequestTiming::Clock::now();
+
+    const RequestBody& body = request.body;
+    if (body.hasError() || !body.hasLength()) {
+        // A generator may block, which would stall every other coroutine on the loop
+        co_return failure(body.hasError() ? body.getError() : "CoroHttpClient cannot send a generator body",
+                          HttpError::InvalidRequest, timing);
+    }
+
+    OutgoingRequest outgoing;
+    formatter.buildRequest(request, outgoing);
+    std::string origin = originKey(request.hostname, request.port);
+
+    // Every operation below runs on the watchdog's token
+    RequestTimeouts limits = request.timeouts.withDefaults(timeouts);
+    Watchdog watchdog(scheduler.getTimers(), token, deadline);
+    CancellationToken scoped = watchdog.getToken();
+    std::function<void()> progress = [&watchdog, &limits]() { watchdog.armAfter(limits.idle); };
+
+    // A pooled socket can be closed by the server just as we reuse it;
+    // that race is worth one retry on a fresh connection
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (TimerWheel::Clock::now() >= deadline) {
+            co_return failure("Timed out before the request to " + request.hostname + " was sent",
+                              HttpError::Timeout, timing);
+        }
+        int sockfd = takeIdle(origin);
+        bool reused = sockfd != -1;
+
+        RequestTiming::Clock::time_point start = timing.start;
+        timing = RequestTiming();
+        timing.start = start;
+        timing.acquired = RequestTiming::Clock::now();
+        timing.connectionReused = reused;
+
+        if (!reused) {
+            watchdog.armAfter(limits.connect);
+            HttpError error;
+            sockfd = co_await openConnection(request.hostname, request.port, scoped, timing, error);
+            if (sockfd == -1) {
+                if (watchdog.isCancelled()) {
+                    co_return interrupted(watchdog, "Timed out connecting to " + request.hostname, timing);
+                }
+                co_return failure("Failed to establish connection to " + request.hostname, error, timing);
+            }
+        }
+
+        watchdog.armAfter(limits.idle);
+        if (!co_await sendWatched(sockfd, outgoing, body, scoped, progress)) {
+            closeSocket(sockfd);
+            if (watchdog.isCancelled()) {
+                co_return interrupted(watchdog, "Timed out sending the request to " + request.hostname, timing);
+            }
+            if (reused && body.isReplayable()) {
+                continue;
+            }
+            co_return failure("Failed to send HTTP request", HttpError::Send, timing);
+        }
+        timing.requestWritten = RequestTiming::Clock::now();
+
+        // The first-byte limit until the response starts, then the idle limit after each read
+        watchdog.armAfter(limits.firstByte.count() > 0 ? limits.firstByte : limits.idle);
+        ResponseReader reader(request.method == "HEAD");
+        reader.setDechunkInPlace(true);
+        std::string pending;
+        bool complete = co_await receiveWatched(sockfd, reader, pending, scoped, progress);
+        watchdog.arm(TimerWheel::Clock::time_point::max());
+        timing.firstByte = reader.getFirstByteTime();
+        timing.headersComplete = reader.getHeadersTime();
+        timing.bodyComplete = reader.getCompleteTime();
+
+        if (!complete) {
+            closeSocket(sockfd);
+            if (watchdog.isCancelled()) {
+                co_return interrupted(watchdog,
+                                      (reader.getMessage().empty() ? "Timed out waiting for the response from "
+                                                                   : "Timed out receiving the response from ") +
+                                          request.hostname,
+                                      timing);
+            }
+            if (reader.getMessage().empty() && reused && SimpleHttpClient::isIdempotentMethod(request.method) &&
+                body.isReplayable()) {
+                continue;
+            }
+            co_return failure(reader.hasError() ? reader.getError() : "Error receiving response",
+                              reader.hasError() ? reader.getErrorKind() : HttpError::Receive, timing);
+        }
+
+        bool keepAlive = reader.isKeepAlive();
+        HttpResponse response = formatter.parseHttpResponse(reader);
+        response.timing = timing;
+        // Unsolicited bytes after the response mean the stream is out of sync
+        release(origin, sockfd, keepAlive && response.isSuccess && pending.empty());
+        co_return response;
+    }
+
+    co_return failure("Connection to " + request.hostname + " closed before a response was received",
+                      HttpError::Receive, timing);
+}
+
+Task<bool> CoroHttpClient::sendWatched(int sockfd, const OutgoingRequest& request, const RequestBody& body,
+                                       CancellationToken token, const std::function<void()>& progress) {
+    // Headers (and a buffer body) first, then a body that follows them, e.g. a file
+    size_t headerBytes = request.size();
+    size_t total = headerBytes + (request.bodyFollows() ? body.getLength() : 0);
+    size_t sent = 0;
+    std::vector<iovec> segments;
+    while (sent < headerBytes) {
+        request.segmentsFrom(sent, segments);
+        ssize_t n = co_await transport->send(sockfd, segments.data(), segments.size(), token);
+        if (n <= 0) {
+            co_return false;
+        }
+        sent += static_cast<size_t>(n);
+        if (progress) {
+            progress();
+        }
+    }
+    while (sent < total) {
+        ssize_t n = body.sendFrom(sockfd, sent - headerBytes);
+        if (n > 0) {
+            sent += static_cast<size_t>(n);
+            if (progress) {
+                progress();
+            }
+            continue;
+        }
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!co_await transport->writable(sockfd, token)) {
+                co_return false;
+            }
+            continue;
+        }
+        co_return false;
+    }
+    co_return true;
+}
+
+Task<bool> CoroHttpClient::receiveWatched(int sockfd, ResponseReader& reader, std::string& pending,
+                                          CancellationToken token, const std::function<void()>& progress) {
+    if (!pending.empty()) {
+        size_t used = reader.feed(pending.data(), pending.length());
+        pending.erase(0, used);
+    }
+
+    while (!reader.isComplete() && !reader.hasError()) {
+        ssize_t n = co_await transport->receive(sockfd, receiveBuffer.data(), receiveBuffer.size(), token);
+        if (n > 0) {
+            size_t used = reader.feed(receiveBuffer.data(), static_cast<size_t>(n));
+            if (used < static_cast<size_t>(n)) {
+                pending.append(receiveBuffer.data() + used, n - used);
+            }
+            if (progress) {
+                progress();
+            }
+            continue;
+        }
+        if (n == 0) {
+            reader.finish();
+            break;
+        }
+        co_return false;
+    }
+    co_return reader.isComplete();
+}
+
+int CoroHttpClient::takeIdle(const std::string& origin) {
+    auto idle = idleConnections.find(origin);
+    while (idle != idleConnections.end() && !idle->second.empty()) {
+        int sockfd = idle->second.back();
+        idle->second.pop_back();
+        if (!transport->isStale(sockfd)) {
+            return sockfd;
+        }
+        closeSocket(sockfd);
+    }
+    return -1;
+}
+
+void CoroHttpClient::release(const std::string& origin, int sockfd, bool reusable) {
+    if (reusable) {
+        idleConnections[origin].push_back(sockfd);
+    } else {
+        closeSocket(sockfd);
+    }
+}
+
+void CoroHttpClient::closeSocket(int sockfd) {
+    transport->close(sockfd);
+}
@@ -0,0 +1,219 @@
+#include "processing/fetch_pool.h"
+#include <algorithm>
+
+struct FetchPool::Batch {
+    const std::vector<HttpRequest>* requests;
+    std::vector<HttpResponse>* responses;  // filled in place when there is no callback
+    const CompletionCallback* onComplete;
+    std::atomic<size_t> remaining;
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    bool done;
+
+    Batch(const std::vector<HttpRequest>& requests, std::vector<HttpResponse>* responses,
+          const CompletionCallback* onComplete)
+        : requests(&requests), responses(responses), onComplete(onComplete),
+          remaining(requests.size()), done(requests.empty()) {}
+};
+
+FetchPool::FetchPool(const SimpleHttpClient& client, size_t threads, size_t maxPerHost)
+    : queued(0), stopping(false), nextWorker(0), completedCount(0), stealCount(0), deferredCount(0) {
+    SimpleHttpClient base = client;
+    ConnectionPool& basePool = base.getConnectionPool();
+    this->maxPerHost = maxPerHost > 0 ? maxPerHost : std::max<size_t>(basePool.getMaxConnectionsPerHost(), 1);
+
+    if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        std::unique_ptr<Worker> worker(new Worker(base));
+        // Sockets and header templates stay with the worker that made them
+        worker->client.setConnectionPool(std::make_shared<ConnectionPool>(basePool.getMaxConnectionsPerHost(),
+                                                                          basePool.getIdleTimeout()));
+        worker->client.setDefaultHeaders(base.getDefaultHeaders());
+        workers.push_back(std::move(worker));
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i]->thread = std::thread(&FetchPool::workerLoop, this, i);
+    }
+}
+
+FetchPool::~FetchPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (const auto& worker : workers) {
+        worker->thread.join();
+    }
+}
+
+std::vector<HttpResponse> FetchPool::fetchAll(const std::vector<HttpRequest>& requests) {
+    std::vector<HttpResponse> responses(requests.size());
+    Batch batch(requests, &responses, nullptr);
+    run(batch);
+    return responses;
+}
+
+void FetchPool::fetchAll(const std::vector<HttpRequest>& requests, const CompletionCallback& onComplete) {
+    Batch batch(requests, nullptr, &onComplete);
+    run(batch);
+}
+
+std::vector<HttpResponse> FetchPool::getMany(const std::vector<std::string>& urls) {
+    std::vector<HttpResponse> responses(urls.size());
+    std::vector<HttpRequest> requests;
+    std::vector<size_t> positions;
+    requests.reserve(urls.size());
+    for (size_t i = 0; i < urls.size(); ++i) {
+        HttpRequest request;
+        if (!SimpleHttpClient::parseUrl(urls[i], request.hostname, request.path, request.port)) {
+            responses[i].errorKind = HttpError::InvalidRequest;
+            responses[i].errorMessage = "Invalid URL: " + urls[i];
+            continue;
+        }
+        requests.push_back(std::move(request));
+        positions.push_back(i);
+    }
+
+    fetchAll(requests, [&](size_t index, HttpResponse& response) {
+        responses[positions[index]] = std::move(response);
+    });
+    return responses;
+}
+
+FetchStats FetchPool::getStats() const {
+    FetchStats stats;
+    stats.completed = completedCount.load();
+    stats.steals = stealCount.load();
+    stats.deferred = deferredCount.load();
+    return stats;
+}
+
+// Private helper methods
+void FetchPool::run(Batch& batch) {
+    size_t count = batch.requests->size();
+    if (count == 0) {
+        return;
+    }
+
+    // Deal the batch round-robin, one lock per worker queue
+    size_t first = nextWorker.fetch_add(1) % workers.size();
+    std::vector<std::vector<Task>> shares(workers.size());
+    for (size_t i = 0; i < count; ++i) {
+        shares[(first + i) % workers.size()].push_back(Task{&batch, i});
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+        if (!shares[i].empty()) {
+            std::lock_guard<std::mutex> lock(workers[i]->mutex);
+            workers[i]->queue.insert(workers[i]->queue.end(), shares[i].begin(), shares[i].end());
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        queued += count;
+    }
+    workAvailable.notify_all();
+
+    std::unique_lock<std::mutex> lock(batch.mutex);
+    batch.finished.wait(lock, [&batch] { return batch.done; });
+}
+
+void FetchPool::workerLoop(size_t id) {
+    Worker& worker = *workers[id];
+    while (true) {
+        Task task;
+        if (!takeTask(id, task)) {
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            workAvailable.wait(lock, [this] { return stopping || queued.load() > 0; });
+            if (stopping && queued.load() == 0) {
+                return;
+            }
+            continue;
+        }
+
+        // Take the origin now: the batch may be gone once its last request has run
+        const HttpRequest& request = (*task.batch->requests)[task.index];
+        Origin origin(request.hostname, request.port);
+        if (!enterHost(origin, task)) {
+            continue;  // parked until a request to the same origin finishes
+        }
+        do {
+            runTask(worker, task);
+        } while (leaveHost(origin, task));
+    }
+}
+
+bool FetchPool::takeTask(size_t id, Task& task) {
+    {
+        Worker& own = *workers[id];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.queue.empty()) {
+            task = own.queue.front();
+            own.queue.pop_front();
+            queued--;
+            return true;
+        }
+    }
+
+    // Steal the work its owner would get to last
+    for (size_t step = 1; step < workers.size(); ++step) {
+        Worker& victim = *workers[(id + step) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.queue.empty()) {
+            task = victim.queue.back();
+            victim.queue.pop_back();
+            queued--;
+            stealCount++;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FetchPool::enterHost(const Origin& origin, const Task& task) {
+    std::lock_guard<std::mutex> lock(hostMutex);
+    HostSlots& slots = hosts[origin];
+    if (slots.active < maxPerHost) {
+        slots.active++;
+        return true;
+    }
+    slots.parked.push_back(task);
+    deferredCount++;
+    return false;
+}
+
+bool FetchPool::leaveHost(const Origin& origin, Task& next) {
+    std::lock_guard<std::mutex> lock(hostMutex);
+    auto it = hosts.find(origin);
+    if (!it->second.parked.empty()) {
+        // Hand the slot straight to the next waiting request
+        next = it->second.parked.front();
+        it->second.parked.pop_front();
+        return true;
+    }
+    if (--it->second.active == 0) {
+        hosts.erase(it);
+    }
+    return false;
+}
+
+void FetchPool::runTask(Worker& worker, const Task& task) {
+    Batch& batch = *task.batch;
+    HttpResponse response = worker.client.makeHttpRequest((*batch.requests)[task.index]);
+    if (batch.onComplete != nullptr) {
+        (*batch.onComplete)(task.index, response);
+    } else {
+        (*batch.responses)[task.index] = std::move(response);
+    }
+    completedCount++;
+
+    if (--batch.remaining == 0) {
+        // The waiting caller destroys the batch as soon as it sees done
+        std::lock_guard<std::mutex> lock(batch.mutex);
+        batch.done = true;
+        batch.finished.notify_all();
+    }
+}
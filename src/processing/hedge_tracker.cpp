@@ -0,0 +1,71 @@
+#include "processing/hedge_tracker.h"
+#include <algorithm>
+#include <cmath>
+
+HedgeTracker::HedgeTracker(const HedgePolicy& policy) : policy(policy), tokens(0) {
+    this->policy.percentile = std::clamp(policy.percentile, 0.0, 1.0);
+    this->policy.budget = std::max(policy.budget, 0.0);
+}
+
+std::chrono::milliseconds HedgeTracker::startRequest(const std::string& origin) {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.requests++;
+    tokens = std::min(tokens + policy.budget, kMaxBurst);
+
+    if (policy.delay.count() > 0) {
+        return policy.delay;
+    }
+    auto it = origins.find(origin);
+    return it == origins.end() ? std::chrono::milliseconds::max() : it->second.delay;
+}
+
+bool HedgeTracker::tryHedge() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (tokens < 1.0) {
+        stats.denied++;
+        return false;
+    }
+    tokens -= 1.0;
+    return true;
+}
+
+void HedgeTracker::recordLatency(const std::string& origin, Clock::duration latency) {
+    if (policy.delay.count() > 0) {
+        return;  // a fixed delay needs no samples
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    OriginLatency& entry = origins[origin];
+    if (entry.samples.size() < kWindow) {
+        entry.samples.push_back(latency);
+    } else {
+        entry.samples[entry.next] = latency;
+        entry.next = (entry.next + 1) % kWindow;
+    }
+    if (++entry.sinceRefresh >= kRefresh && entry.samples.size() >= policy.minSamples) {
+        refresh(entry);
+    }
+}
+
+void HedgeTracker::recordSent() {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.sent++;
+}
+
+void HedgeTracker::recordWon() {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.won++;
+}
+
+HedgeStats HedgeTracker::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+// Private helper methods
+void HedgeTracker::refresh(OriginLatency& origin) {
+    std::vector<Clock::duration> sorted = origin.samples;
+    size_t rank = static_cast<size_t>(std::floor(policy.percentile * (sorted.size() - 1)));
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    origin.delay = std::max(std::chrono::ceil<std::chrono::milliseconds>(sorted[rank]), std::chrono::milliseconds(1));
+    origin.sinceRefresh = 0;
+}
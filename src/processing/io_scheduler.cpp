@@ -0,0 +1,256 @@
+#include "processing/io_scheduler.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace {
+
+const int kMaxEvents = 256;
+
+} // namespace
+
+void IoScheduler::IoAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    this->handle = handle;
+    scheduler.watch(*this);
+    registration.bind(token, [this]() {
+        scheduler.unwatch(*this);
+        cancelled = true;
+        scheduler.ready.push_back(this->handle);
+    });
+}
+
+void IoScheduler::SleepAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    this->handle = handle;
+    timer.setCallback([this]() {
+        registration.reset();
+        scheduler.ready.push_back(this->handle);
+    });
+    scheduler.timers.schedule(timer, deadline);
+    registration.bind(token, [this]() {
+        scheduler.timers.cancel(timer);
+        cancelled = true;
+        scheduler.ready.push_back(this->handle);
+    });
+}
+
+IoScheduler::IoScheduler()
+    : epollFd(epoll_create1(EPOLL_CLOEXEC)),
+      wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      nextSpawnId(0) {
+    epoll_event event;
+    memset(&event, 0, sizeof event);
+    event.events = EPOLLIN;
+    event.data.fd = wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+}
+
+IoScheduler::~IoScheduler() {
+    // Destroying a driver destroys the whole chain of tasks it awaits
+    std::unordered_map<uint64_t, std::coroutine_handle<>> unfinished;
+    unfinished.swap(spawned);
+    for (auto& driver : unfinished) {
+        driver.second.destroy();
+    }
+
+    close(wakeFd);
+    close(epollFd);
+}
+
+void IoScheduler::forget(int sockfd) {
+    auto it = watches.find(sockfd);
+    if (it == watches.end()) {
+        return;
+    }
+    if (it->second.added) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, sockfd, nullptr);
+    }
+    watches.erase(it);
+}
+
+void IoScheduler::addPoller(int fd, Poller& poller) {
+    epoll_event event;
+    memset(&event, 0, sizeof event);
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+    pollers[fd] = &poller;
+}
+
+void IoScheduler::removePoller(int fd) {
+    if (pollers.erase(fd) != 0) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    }
+}
+
+void IoScheduler::spawn(Task<void> task) {
+    uint64_t id = nextSpawnId++;
+    Detached driver = detach(std::move(task), id);
+    spawned[id] = driver.handle;
+    // Started from the loop, so spawning never runs a task inside its caller
+    ready.push_back(driver.handle);
+}
+
+void IoScheduler::post(std::function<void()> work) {
+    {
+        std::lock_guard<std::mutex> lock(postMutex);
+        posted.push_back(std::move(work));
+    }
+    uint64_t one = 1;
+    ssize_t ignored = write(wakeFd, &one, sizeof one);
+    (void)ignored;
+}
+
+void IoScheduler::post(std::coroutine_handle<> handle) {
+    post([this, handle]() { ready.push_back(handle); });
+}
+
+size_t IoScheduler::runOnce(int timeoutMs) {
+    runPosted();
+    for (auto& poller : pollers) {
+        poller.second->flush();
+    }
+
+    if (!ready.empty()) {
+        timeoutMs = 0;
+    } else if (!timers.empty()) {
+        auto untilTimer = std::chrono::ceil<std::chrono::milliseconds>(timers.nextWakeup() - Clock::now());
+        int timerMs = static_cast<int>(std::clamp<long long>(untilTimer.count(), 0, std::numeric_limits<int>::max()));
+        timeoutMs = timeoutMs < 0 ? timerMs : std::min(timeoutMs, timerMs);
+    }
+
+    epoll_event events[kMaxEvents];
+    int count = epoll_wait(epollFd, events, kMaxEvents, timeoutMs);
+
+    for (int i = 0; i < count; ++i) {
+        int sockfd = events[i].data.fd;
+        if (sockfd == wakeFd) {
+            uint64_t value;
+            ssize_t ignored = read(wakeFd, &value, sizeof value);
+            (void)ignored;
+            continue;
+        }
+        auto poller = pollers.find(sockfd);
+        if (poller != pollers.end()) {
+            poller->second->poll();
+            continue;
+        }
+        auto it = watches.find(sockfd);
+        if (it == watches.end()) {
+            continue;
+        }
+
+        Watch& entry = it->second;
+        uint32_t flags = events[i].events;
+        bool woken = false;
+        if (entry.reader != nullptr && (flags & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP))) {
+            entry.reader->registration.reset();
+            ready.push_back(entry.reader->handle);
+            entry.reader = nullptr;
+            woken = true;
+        }
+        if (entry.writer != nullptr && (flags & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+            entry.writer->registration.reset();
+            ready.push_back(entry.writer->handle);
+            entry.writer = nullptr;
+            woken = true;
+        }
+        if (!woken) {
+            // Interest is dropped lazily: only once it fires with nobody waiting
+            update(sockfd, entry);
+        }
+    }
+
+    timers.advance(Clock::now());
+
+    runPosted();
+
+    // Coroutines made ready while these run wait for the next round
+    std::deque<std::coroutine_handle<>> batch;
+    batch.swap(ready);
+    for (std::coroutine_handle<> handle : batch) {
+        handle.resume();
+    }
+    return batch.size();
+}
+
+void IoScheduler::run() {
+    while (!spawned.empty()) {
+        runOnce(-1);
+    }
+}
+
+// Private helper methods
+void IoScheduler::watch(IoAwaiter& waiter) {
+    Watch& entry = watches[waiter.sockfd];
+    if (waiter.write) {
+        entry.writer = &waiter;
+    } else {
+        entry.reader = &waiter;
+    }
+    // Level-triggered interest left over from an earlier wait may already cover this one
+    if (!entry.added || (interestOf(entry) & ~entry.registered) != 0) {
+        update(waiter.sockfd, entry);
+    }
+}
+
+void IoScheduler::unwatch(IoAwaiter& waiter) {
+    auto it = watches.find(waiter.sockfd);
+    if (it == watches.end()) {
+        return;
+    }
+    IoAwaiter*& slot = waiter.write ? it->second.writer : it->second.reader;
+    if (slot == &waiter) {
+        slot = nullptr;
+    }
+}
+
+uint32_t IoScheduler::interestOf(const Watch& entry) {
+    uint32_t events = 0;
+    if (entry.reader != nullptr) {
+        events |= uint32_t(EPOLLIN | EPOLLRDHUP);
+    }
+    if (entry.writer != nullptr) {
+        events |= uint32_t(EPOLLOUT);
+    }
+    return events;
+}
+
+void IoScheduler::update(int sockfd, Watch& entry) {
+    uint32_t wanted = interestOf(entry);
+    if (entry.added && wanted == entry.registered) {
+        return;
+    }
+
+    epoll_event event;
+    memset(&event, 0, sizeof event);
+    event.events = wanted;
+    event.data.fd = sockfd;
+    if (!entry.added) {
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, sockfd, &event);
+        entry.added = true;
+    } else if (epoll_ctl(epollFd, EPOLL_CTL_MOD, sockfd, &event) == -1 && errno == ENOENT) {
+        // The socket was closed and its number reused without forget()
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, sockfd, &event);
+    }
+    entry.registered = wanted;
+}
+
+void IoScheduler::runPosted() {
+    std::vector<std::function<void()>> work;
+    {
+        std::lock_guard<std::mutex> lock(postMutex);
+        work.swap(posted);
+    }
+    for (std::function<void()>& item : work) {
+        item();
+    }
+}
+
+IoScheduler::Detached IoScheduler::detach(Task<void> task, uint64_t id) {
+    co_await task;
+    spawned.erase(id);
+}
@@ -1,128 +1,307 @@
 #include "processing/processing.h"
+#include "processing/fetch_pool.h"
+#include "request/content_decoder.h"
+#include "request/http_scan.h"
+#include "request/response_reader.h"
+#include "socket/socket.h"
 #include <iostream>
+#include <cerrno>
 #include <cstring>
+#include <limits>
+#include <poll.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <netdb.h>
 #include <unistd.h>
-#include <sstream>
 #include <algorithm>
 
-// Constructor
-SimpleHttpClient::SimpleHttpClient(int maxRedirects) : maxRedirects(maxRedirects) {}
+namespace {
 
-// Public methods
-int SimpleHttpClient::createConnection(const std::string& hostname, int port) {
-    struct addrinfo hints, *servinfo, *p;
-    int rv;
-    
-    memset(&hints, 0, sizeof hints);
-    hints.ai_family = AF_UNSPEC;
-    hints.ai_socktype = SOCK_STREAM;
-    
-    std::string portStr = std::to_string(port);
-    
-    if ((rv = getaddrinfo(hostname.c_str(), portStr.c_str(), &hints, &servinfo)) != 0) {
-        std::cerr << "getaddrinfo: " << gai_strerror(rv) << std::endl;
-        return -1;
+// Guess whether an untyped body is text: no NULs or stray control bytes up front
+bool looksLikeText(const std::string& body) {
+    size_t sample = std::min<size_t>(body.length(), 512);
+    for (size_t i = 0; i < sample; ++i) {
+        unsigned char c = static_cast<unsigned char>(body[i]);
+        if (c < 0x20 && c != '\n' && c != '\r' && c != '\t' && c != '\f') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// RFC 3986 section 5.2.4: drop "." segments and let ".." remove its parent
+std::string removeDotSegments(const std::string& path) {
+    std::vector<std::string> segments;
+    size_t start = 1;
+    while (start <= path.length()) {
+        size_t end = path.find('/', start);
+        if (end == std::string::npos) {
+            end = path.length();
+        }
+        std::string segment = path.substr(start, end - start);
+        bool last = end == path.length();
+        if (segment == "..") {
+            if (!segments.empty()) {
+                segments.pop_back();
+            }
+            if (last) {
+                segments.emplace_back();
+            }
+        } else if (segment == ".") {
+            if (last) {
+                segments.emplace_back();
+            }
+        } else {
+            segments.push_back(segment);
+        }
+        start = end + 1;
     }
     
+    std::string result;
+    for (const std::string& segment : segments) {
+        result += "/" + segment;
+    }
+    return result.empty() ? "/" : result;
+}
+
+std::string formatUrl(const HttpRequest& request) {
+    std::string host = request.hostname.find(':') == std::string::npos ? request.hostname
+                                                                       : "[" + request.hostname + "]";
+    std::string port = request.port == 80 ? "" : ":" + std::to_string(request.port);
+    return "http://" + host + port + request.path;
+}
+
+bool isCredentialHeader(const std::string& name) {
+    return equalsIgnoreCaseAscii(name, "Authorization") || equalsIgnoreCaseAscii(name, "Cookie") ||
+           equalsIgnoreCaseAscii(name, "Proxy-Authorization");
+}
+
+const std::string* findHeader(const HeaderList& headers, std::string_view name) {
+    for (const auto& header : headers) {
+        if (equalsIgnoreCaseAscii(header.first, name)) {
+            return &header.second;
+        }
+    }
+    return nullptr;
+}
+
+bool isBodyHeader(const std::string& name) {
+    return equalsIgnoreCaseAscii(name, "Content-Length") || equalsIgnoreCaseAscii(name, "Content-Type") ||
+           equalsIgnoreCaseAscii(name, "Content-Encoding") || equalsIgnoreCaseAscii(name, "Transfer-Encoding") ||
+           equalsIgnoreCaseAscii(name, "Expect");
+}
+
+// When a limit starting now runs out, or the earlier deadline cap (no limit: cap)
+RequestTiming::Clock::time_point deadlineAfter(std::chrono::milliseconds limit, RequestTiming::Clock::time_point cap) {
+    if (limit.count() <= 0) {
+        return cap;
+    }
+    return std::min(cap, RequestTiming::Clock::now() + limit);
+}
+
+// Longest a single blocking write may stall: the idle limit, or what is left
+// before the deadline if that is sooner (0: unbounded)
+std::chrono::milliseconds sendTimeoutFor(std::chrono::milliseconds idle, RequestTiming::Clock::time_point deadline) {
+    if (deadline == RequestTiming::Clock::time_point::max()) {
+        return idle;
+    }
+    std::chrono::milliseconds remaining = std::max(
+        std::chrono::ceil<std::chrono::milliseconds>(deadline - RequestTiming::Clock::now()), std::chrono::milliseconds(1));
+    return idle.count() > 0 ? std::min(idle, remaining) : remaining;
+}
+
+void setSendTimeout(int sockfd, std::chrono::milliseconds timeout) {
+    timeval value;
+    value.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+    value.tv_usec = static_cast<suseconds_t>(timeout.count() % 1000 * 1000);
+    setsockopt(sockfd, SOL_SOCKET, SO_SNDTIMEO, &value, sizeof value);
+}
+
+// The response reads of one request: the total deadline throughout, the
+// first-byte (or idle) limit until the response starts, the idle limit after
+ReadDeadline readDeadlineFor(const RequestTimeouts& limits, RequestTiming::Clock::time_point deadline) {
+    ReadDeadline read;
+    read.complete = deadline;
+    read.firstByte = deadlineAfter(limits.firstByte.count() > 0 ? limits.firstByte : limits.idle, deadline);
+    read.idle = limits.idle;
+    return read;
+}
+
+// Wait for a socket to become readable (or fail)
+// @return false if until passed first
+bool waitReadable(int sockfd, RequestTiming::Clock::time_point until) {
+    while (true) {
+        auto remaining = std::chrono::ceil<std::chrono::milliseconds>(until - RequestTiming::Clock::now());
+        if (remaining.count() <= 0) {
+            return false;
+        }
+        pollfd entry;
+        entry.fd = sockfd;
+        entry.events = POLLIN;
+        entry.revents = 0;
+        long long timeout = std::min<long long>(remaining.count(), std::numeric_limits<int>::max());
+        int ready = poll(&entry, 1, static_cast<int>(timeout));
+        if (ready > 0) {
+            return true;
+        }
+        if (ready == -1 && errno != EINTR) {
+            return true;  // let the read report the failure
+        }
+    }
+}
+
+// Put the address a socket is connected to after the host's other addresses
+void moveToBack(std::vector<ResolvedAddress>& addresses, int sockfd, int port) {
+    sockaddr_storage peer;
+    socklen_t length = sizeof peer;
+    if (getpeername(sockfd, reinterpret_cast<sockaddr*>(&peer), &length) == -1) {
+        return;
+    }
+    std::stable_partition(addresses.begin(), addresses.end(), [&](const ResolvedAddress& address) {
+        ResolvedAddress candidate = address.withPort(port);
+        return candidate.length != length || memcmp(&candidate.address, &peer, length) != 0;
+    });
+}
+
+// One copy of a hedged request being read
+struct HedgeLeg {
     int sockfd;
-    for(p = servinfo; p != NULL; p = p->ai_next) {
-        if ((sockfd = socket(p->ai_family, p->ai_socktype, p->ai_protocol)) == -1) {
+    ResponseReader* reader;
+    std::string* pending;
+    RequestTiming::Clock::time_point firstByteDeadline;
+    RequestTiming::Clock::time_point lastProgress;
+    bool live;
+};
+
+RequestTiming::Clock::time_point legDeadline(const HedgeLeg& leg, const ReadDeadline& limits) {
+    if (leg.reader->getFirstByteTime() == ResponseReader::Clock::time_point()) {
+        return std::min(limits.complete, leg.firstByteDeadline);
+    }
+    if (limits.idle.count() > 0) {
+        return std::min(limits.complete, leg.lastProgress + limits.idle);
+    }
+    return limits.complete;
+}
+
+// Consume whatever the socket holds without blocking; the leg dies on close or error
+void drainLeg(HedgeLeg& leg, char* buffer, size_t size) {
+    while (!leg.reader->isComplete()) {
+        ssize_t n = recv(leg.sockfd, buffer, size, MSG_DONTWAIT);
+        if (n > 0) {
+            size_t used = leg.reader->feed(buffer, static_cast<size_t>(n));
+            if (used < static_cast<size_t>(n)) {
+                leg.pending->append(buffer + used, static_cast<size_t>(n) - used);
+            }
+            leg.lastProgress = RequestTiming::Clock::now();
+            if (leg.reader->hasError()) {
+                leg.live = false;
+                return;
+            }
             continue;
         }
-        
-        if (connect(sockfd, p->ai_addr, p->ai_addrlen) == -1) {
-            close(sockfd);
+        if (n == 0) {
+            leg.reader->finish();
+            leg.live = leg.reader->isComplete();
+            return;
+        }
+        if (errno == EINTR) {
             continue;
         }
-        
-        break;
-    }
-    
-    if (p == NULL) {
-        freeaddrinfo(servinfo);
-        return -1;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            leg.live = false;
+        }
+        return;
     }
-    
-    freeaddrinfo(servinfo);
-    return sockfd;
+}
+
+} // namespace
+
+// Constructor
+SimpleHttpClient::SimpleHttpClient(int maxRedirects)
+    : maxRedirects(maxRedirects),
+      connectionPool(std::make_shared<ConnectionPool>()),
+      resolver(DnsResolver::getDefault()),
+      pipelineDepth(8),
+      streamingThreshold(0),
+      defaultHeaders(RequestTemplate::defaultHeaders()),
+      continueTimeoutMs(1000),
+      requestTemplates(std::make_shared<TemplateCache>()) {}
+
+// Public methods
+int SimpleHttpClient::createConnection(const std::string& hostname, int port) {
+    RequestTiming unused;
+    HttpError error;
+    return openConnection(hostname, port, unused, RequestTiming::Clock::time_point::max(), error);
 }
 
 std::string SimpleHttpClient::formatHttpRequest(const std::string& hostname, 
                                                const std::string& path, 
                                                const std::string& method) {
-    std::stringstream request;
-    request << method << " " << path << " HTTP/1.1\r\n";
-    request << "Host: " << hostname << "\r\n";
-    request << "User-Agent: SimpleHTTPClient/1.0\r\n";
-    request << "Accept: */*\r\n";
-    request << "Connection: close\r\n";
-    request << "\r\n";
-    
-    return request.str();
+    OutgoingRequest request;
+    requestTemplateFor(hostname, 80).build(method, path, HeaderList(), RequestBody(), false, request);
+    return request.toString();
+}
+
+void SimpleHttpClient::buildRequest(const HttpRequest& request, OutgoingRequest& out) {
+    requestTemplateFor(request.hostname, request.port).build(request.method, request.path, request.headers,
+                                                             request.body, request.expectContinue, out);
 }
 
 bool SimpleHttpClient::sendHttpRequest(int sockfd, const std::string& request) {
-    int total = 0;
-    int bytesleft = request.length();
-    int n;
-    
-    while(total < request.length()) {
-        n = send(sockfd, request.c_str() + total, bytesleft, 0);
-        if (n == -1) { 
-            return false; 
-        }
-        total += n;
-        bytesleft -= n;
-    }
-    
-    return true;
+    return writeSegments(sockfd, {iovec{const_cast<char*>(request.data()), request.length()}});
+}
+
+bool SimpleHttpClient::sendHttpRequest(int sockfd, const OutgoingRequest& request, HttpError* errorKind) {
+    return request.sendAll(sockfd, errorKind);
 }
 
 std::string SimpleHttpClient::receiveHttpResponse(int sockfd) {
-    std::string response;
-    char buffer[4096];
-    int bytesReceived;
-    
-    while ((bytesReceived = recv(sockfd, buffer, sizeof(buffer) - 1, 0)) > 0) {
-        buffer[bytesReceived] = '\0';
-        response += buffer;
-    }
-    
-    return response;
+    bool keepAlive;
+    return receiveHttpResponse(sockfd, "GET", keepAlive);
 }
 
 HttpResponse SimpleHttpClient::parseHttpResponse(const std::string& rawResponse) {
+    return parseRawResponse(rawResponse, false);
+}
+
+HttpResponse SimpleHttpClient::parseHttpResponse(ResponseReader& reader) {
+    bool bodyDechunked = reader.isBodyDechunked();
+    return parseRawResponse(reader.takeMessage(), bodyDechunked);
+}
+
+HttpResponse SimpleHttpClient::parseRawResponse(const std::string& rawResponse, bool bodyDechunked) {
     HttpResponse response;
     response.isSuccess = false;
+    response.errorKind = HttpError::Protocol;
     
     if (rawResponse.empty()) {
         response.errorMessage = "Empty response received";
         return response;
     }
     
-    size_t headerEndPos = rawResponse.find("\r\n\r\n");
+    size_t headerEndPos = scanForHeaderEnd(rawResponse.data(), rawResponse.length());
     if (headerEndPos == std::string::npos) {
         response.errorMessage = "Invalid HTTP response format - no header separator found";
         return response;
     }
     
-    std::string headerSection = rawResponse.substr(0, headerEndPos);
+    std::string_view headerSection(rawResponse.data(), headerEndPos);
     response.body = rawResponse.substr(headerEndPos + 4);
     
-    // Handle chunked encoding if present
-    if (isChunkedEncoding(headerSection)) {
-        response.body = decodeChunkedBody(response.body);
-    }
-    
-    std::istringstream headerStream(headerSection);
-    std::string line;
+    size_t lineStart = 0;
     bool isFirstLine = true;
     
-    while (std::getline(headerStream, line)) {
+    while (lineStart < headerSection.length()) {
+        size_t lineLength = scanForByte(headerSection.data() + lineStart,
+                                        headerSection.length() - lineStart, '\n');
+        if (lineLength == std::string::npos) {
+            lineLength = headerSection.length() - lineStart;
+        }
+        std::string_view line = headerSection.substr(lineStart, lineLength);
+        lineStart += lineLength + 1;
+        
         if (!line.empty() && line.back() == '\r') {
-            line.pop_back();
+            line.remove_suffix(1);
         }
         
         if (isFirstLine) {
@@ -135,7 +314,102 @@ HttpResponse SimpleHttpClient::parseHttpResponse(const std::string& rawResponse)
         }
     }
     
+    // Handle chunked encoding if present and not already removed by the reader
+    if (!bodyDechunked && isChunkedEncoding(response) && !decodeChunkedBody(response.body, response)) {
+        return response;
+    }
+    if (!decodeContentEncoding(response)) {
+        return response;
+    }
+    
     response.isSuccess = true;
+    response.errorKind = HttpError::None;
+    return response;
+}
+
+HttpResponseView SimpleHttpClient::parseHttpResponseView(std::string_view rawResponse) {
+    HttpResponseView view;
+    
+    if (rawResponse.empty()) {
+        view.errorMessage = "Empty response received";
+        return view;
+    }
+    
+    size_t headerEndPos = scanForHeaderEnd(rawResponse.data(), rawResponse.length());
+    if (headerEndPos == std::string_view::npos) {
+        view.errorMessage = "Invalid HTTP response format - no header separator found";
+        return view;
+    }
+    
+    std::string_view headerSection = rawResponse.substr(0, headerEndPos);
+    view.body = rawResponse.substr(headerEndPos + 4);
+    
+    // Status line: HTTP/1.1 200 OK
+    size_t lineEnd = scanForCrlf(headerSection.data(), headerSection.length());
+    std::string_view statusLine = headerSection.substr(0, lineEnd);
+    if (!splitStatusLine(statusLine, view.httpVersion, view.statusCode, view.reasonPhrase)) {
+        view.errorMessage = "Invalid status line format";
+        return view;
+    }
+    
+    // Header lines
+    size_t pos = lineEnd == std::string_view::npos ? headerSection.length() : lineEnd + 2;
+    while (pos < headerSection.length()) {
+        size_t end = scanForCrlf(headerSection.data() + pos, headerSection.length() - pos);
+        end = end == std::string_view::npos ? headerSection.length() : pos + end;
+        std::string_view line = headerSection.substr(pos, end - pos);
+        pos = end + 2;
+        
+        size_t colonPos = scanForByte(line.data(), line.length(), ':');
+        if (colonPos == std::string_view::npos) {
+            continue;
+        }
+        
+        std::string_view value = line.substr(colonPos + 1);
+        size_t start = value.find_first_not_of(" \t");
+        size_t last = value.find_last_not_of(" \t");
+        value = start == std::string_view::npos ? std::string_view() : value.substr(start, last - start + 1);
+        
+        view.headers.push_back(HeaderView{line.substr(0, colonPos), value});
+        
+        // Only a final chunked coding, across every Transfer-Encoding header, frames the body
+        if (equalsIgnoreCaseAscii(line.substr(0, colonPos), "transfer-encoding")) {
+            std::string_view coding = lastListEntry(value);
+            if (!coding.empty()) {
+                view.isChunked = equalsIgnoreCaseAscii(coding, "chunked");
+            }
+        }
+    }
+    
+    view.isSuccess = true;
+    return view;
+}
+
+HttpResponse SimpleHttpClient::materialize(const HttpResponseView& view) {
+    HttpResponse response;
+    response.isSuccess = view.isSuccess;
+    response.errorMessage = std::string(view.errorMessage);
+    if (!view.isSuccess) {
+        response.errorKind = HttpError::Protocol;
+        return response;
+    }
+    
+    response.httpVersion = std::string(view.httpVersion);
+    response.statusCode = view.statusCode;
+    response.reasonPhrase = std::string(view.reasonPhrase);
+    
+    response.headers.reserve(view.headers.size());
+    for (const HeaderView& field : view.headers) {
+        response.headers.add(field.name, field.value);
+    }
+    
+    response.body = std::string(view.body);
+    if ((view.isChunked && !decodeChunkedBody(response.body, response)) ||
+        !decodeContentEncoding(response)) {
+        response.isSuccess = false;
+        response.errorKind = HttpError::Protocol;
+    }
+    
     return response;
 }
 
@@ -143,30 +417,185 @@ HttpResponse SimpleHttpClient::makeHttpRequest(const std::string& hostname,
                                               const std::string& path, 
                                               int port, 
                                               const std::string& method) {
-    HttpResponse response;
-    response.isSuccess = false;
+    return makeHttpRequest(HttpRequest(hostname, path, port, method));
+}
+
+HttpResponse SimpleHttpClient::makeHttpRequest(const HttpRequest& request) {
+    HttpRequest current = request;
+    std::vector<RedirectHop> chain;
+    // One total deadline covers every hop
+    RequestTiming::Clock::time_point deadline =
+        deadlineAfter(request.timeouts.withDefaults(timeouts).total, RequestTiming::Clock::time_point::max());
     
-    // Create connection
-    int sockfd = createConnection(hostname, port);
-    if (sockfd == -1) {
-        response.errorMessage = "Failed to establish connection to " + hostname;
-        return response;
+    while (true) {
+        HttpResponse response = performCachedRequest(current, deadline);
+        
+        HttpRequest next;
+        RedirectHop hop;
+        if (static_cast<int>(chain.size()) >= maxRedirects || !followRedirect(current, response, next, hop)) {
+            response.redirectChain = std::move(chain);
+            return response;
+        }
+        chain.push_back(std::move(hop));
+        
+        // performRequest already returned a keep-alive connection to the pool,
+        // so a same-origin hop picks it up again
+        current = std::move(next);
     }
+}
+
+HttpResponse SimpleHttpClient::streamHttpRequest(const HttpRequest& request, BodySink& sink,
+                                                const HeadersCallback& onHeaders) {
+    ResponseReader reader(request.method == "HEAD");
+    std::unique_ptr<DecodingBodySink> decoder;
+    bool streamed = false;
     
-    // Format and send request
-    std::string request = formatHttpRequest(hostname, path, method);
-    if (!sendHttpRequest(sockfd, request)) {
-        response.errorMessage = "Failed to send HTTP request";
-        close(sockfd);
-        return response;
+    reader.setHeadersCallback([&](ResponseReader& headers) {
+        HttpResponse head = parseHttpResponse(headers.getMessage().substr(0, headers.getHeaderLength()));
+        
+        // Small bodies of known size are cheaper to keep in memory
+        long long length = headers.getContentLength();
+        bool buffer = streamingThreshold > 0 && length >= 0 &&
+                      static_cast<size_t>(length) <= streamingThreshold;
+        streamed = !buffer;
+        decoder.reset();
+        
+        const std::string* encoding = head.headers.get(KnownHeader::ContentEncoding);
+        ContentDecoder::Encoding coding = encoding == nullptr
+                                              ? ContentDecoder::Encoding::Identity
+                                              : ContentDecoder::parseEncoding(*encoding);
+        if (buffer) {
+            headers.setBodySink(nullptr);
+        } else if (coding == ContentDecoder::Encoding::Gzip || coding == ContentDecoder::Encoding::Deflate) {
+            // Inflate on the way to the caller's sink
+            decoder.reset(new DecodingBodySink(coding, sink));
+            headers.setBodySink(decoder.get());
+        } else {
+            headers.setBodySink(&sink);
+        }
+        
+        if (onHeaders) {
+            onHeaders(head);
+        }
+    });
+    
+    HttpResponse response = performRequest(
+        request, reader,
+        deadlineAfter(request.timeouts.withDefaults(timeouts).total, RequestTiming::Clock::time_point::max()), false);
+    response.bodyStreamed = streamed && response.isSuccess;
+    if (response.bodyStreamed) {
+        response.compressedBodySize = reader.getBodyBytes();
+        response.decodedBodySize = response.compressedBodySize;
+        if (decoder) {
+            response.decodedBodySize = decoder->getDecoder().getDecodedBytes();
+            if (!decoder->finish()) {
+                response.isSuccess = false;
+                response.errorKind = HttpError::Protocol;
+                response.errorMessage = "Content decoding failed: " + decoder->getDecoder().getError();
+            }
+        }
     }
+    return response;
+}
+
+std::vector<HttpResponse> SimpleHttpClient::makePipelinedRequests(const std::vector<HttpRequest>& requests) {
+    std::vector<HttpResponse> responses(requests.size());
     
-    // Receive and parse response
-    std::string rawResponse = receiveHttpResponse(sockfd);
-    close(sockfd);
+    // Group requests by origin, keeping their relative order
+    std::map<std::pair<std::string, int>, std::vector<size_t>> origins;
+    for (size_t i = 0; i < requests.size(); ++i) {
+        origins[std::make_pair(requests[i].hostname, requests[i].port)].push_back(i);
+    }
     
-    response = parseHttpResponse(rawResponse);
-    return response;
+    for (const auto& origin : origins) {
+        const std::vector<size_t>& queue = origin.second;
+        size_t depth = isPipeliningEnabled(origin.first.first) ? std::max<size_t>(pipelineDepth, 1) : 1;
+        std::vector<int> attempts(queue.size(), 0);
+        size_t next = 0;
+        
+        while (next < queue.size()) {
+            const HttpRequest& first = requests[queue[next]];
+            if (!first.body.isInline() || first.expectContinue) {
+                // The body goes out on its own after the headers; send it like makeHttpRequest
+                ResponseReader reader;
+                responses[queue[next]] = performRequest(
+                    first, reader,
+                    deadlineAfter(first.timeouts.withDefaults(timeouts).total, RequestTiming::Clock::time_point::max()),
+                    false);
+                next++;
+                continue;
+            }
+            
+            // Never pipeline behind or in front of a non-idempotent request
+            std::vector<size_t> batch;
+            for (size_t i = next; i < queue.size() && batch.size() < depth; ++i) {
+                const HttpRequest& candidate = requests[queue[i]];
+                if (!candidate.body.isInline() || candidate.expectContinue) {
+                    break;
+                }
+                if (!isIdempotentMethod(candidate.method)) {
+                    if (batch.empty()) {
+                        batch.push_back(queue[i]);
+                    }
+                    break;
+                }
+                batch.push_back(queue[i]);
+            }
+            
+            size_t answered = sendPipelineBatch(requests, batch, responses);
+            next += answered;
+            
+            if (answered < batch.size()) {
+                // The connection ended before answering batch[answered].
+                // Idempotent requests get a couple of fresh attempts.
+                size_t failed = next;
+                const HttpRequest& request = requests[queue[failed]];
+                HttpResponse& response = responses[queue[failed]];
+                // A request that ran out of time is not tried again
+                if (!isIdempotentMethod(request.method) || ++attempts[failed] > 2 ||
+                    response.errorKind == HttpError::Timeout) {
+                    if (response.errorMessage.empty()) {
+                        response.errorKind = HttpError::Receive;
+                        response.errorMessage =
+                            "Connection to " + request.hostname + " closed before a response was received";
+                    }
+                    next++;
+                }
+            }
+        }
+    }
+    
+    return responses;
+}
+
+std::vector<HttpResponse> SimpleHttpClient::fetchAll(const std::vector<HttpRequest>& requests, size_t threads) {
+    FetchPool pool(*this, threads);
+    return pool.fetchAll(requests);
+}
+
+std::vector<HttpResponse> SimpleHttpClient::getMany(const std::vector<std::string>& urls, size_t threads) {
+    FetchPool pool(*this, threads);
+    return pool.getMany(urls);
+}
+
+void SimpleHttpClient::setPipelineDepth(size_t depth) {
+    pipelineDepth = depth == 0 ? 1 : depth;
+}
+
+size_t SimpleHttpClient::getPipelineDepth() const {
+    return pipelineDepth;
+}
+
+void SimpleHttpClient::setPipeliningEnabled(const std::string& hostname, bool enabled) {
+    if (enabled) {
+        pipeliningDisabledHosts.erase(hostname);
+    } else {
+        pipeliningDisabledHosts.insert(hostname);
+    }
+}
+
+bool SimpleHttpClient::isPipeliningEnabled(const std::string& hostname) const {
+    return pipeliningDisabledHosts.count(hostname) == 0;
 }
 
 void SimpleHttpClient::processResponse(const HttpResponse& response) {
@@ -176,6 +605,7 @@ void SimpleHttpClient::processResponse(const HttpResponse& response) {
     }
     
     std::cout << "\n=== HTTP Response Processing ===" << std::endl;
+    displayRedirectChain(response);
     std::cout << "Status: " << response.statusCode << " " << response.reasonPhrase << std::endl;
     
     // Handle different status code ranges
@@ -193,6 +623,15 @@ void SimpleHttpClient::processResponse(const HttpResponse& response) {
     
     displayImportantHeaders(response);
     displayBodyInfo(response);
+    displayTiming(response);
+}
+
+void SimpleHttpClient::setStreamingThreshold(size_t bytes) {
+    streamingThreshold = bytes;
+}
+
+size_t SimpleHttpClient::getStreamingThreshold() const {
+    return streamingThreshold;
 }
 
 void SimpleHttpClient::setMaxRedirects(int maxRedirects) {
@@ -203,32 +642,235 @@ int SimpleHttpClient::getMaxRedirects() const {
     return maxRedirects;
 }
 
+void SimpleHttpClient::setDefaultHeaders(const HeaderList& headers) {
+    defaultHeaders = headers;
+    // Copies still building requests keep the old templates alive
+    requestTemplates = std::make_shared<TemplateCache>();
+}
+
+const HeaderList& SimpleHttpClient::getDefaultHeaders() const {
+    return defaultHeaders;
+}
+
+void SimpleHttpClient::setTimeouts(const RequestTimeouts& timeouts) {
+    this->timeouts = timeouts;
+}
+
+const RequestTimeouts& SimpleHttpClient::getTimeouts() const {
+    return timeouts;
+}
+
+void SimpleHttpClient::setResponseCache(std::shared_ptr<ResponseCache> cache) {
+    responseCache = cache;
+}
+
+std::shared_ptr<ResponseCache> SimpleHttpClient::getResponseCache() const {
+    return responseCache;
+}
+
+void SimpleHttpClient::setHedgePolicy(const HedgePolicy& policy) {
+    hedging = policy.enabled ? std::make_shared<HedgeTracker>(policy) : nullptr;
+}
+
+HedgePolicy SimpleHttpClient::getHedgePolicy() const {
+    return hedging ? hedging->getPolicy() : HedgePolicy();
+}
+
+HedgeStats SimpleHttpClient::getHedgeStats() const {
+    return hedging ? hedging->getStats() : HedgeStats();
+}
+
+void SimpleHttpClient::setExpectContinueTimeout(int timeoutMs) {
+    continueTimeoutMs = std::max(timeoutMs, 0);
+}
+
+int SimpleHttpClient::getExpectContinueTimeout() const {
+    return continueTimeoutMs;
+}
+
+ConnectionPool& SimpleHttpClient::getConnectionPool() {
+    return *connectionPool;
+}
+
+void SimpleHttpClient::setConnectionPool(std::shared_ptr<ConnectionPool> pool) {
+    connectionPool = pool ? pool : std::make_shared<ConnectionPool>();
+}
+
+void SimpleHttpClient::setResolver(std::shared_ptr<DnsResolver> resolver) {
+    this->resolver = resolver ? resolver : DnsResolver::getDefault();
+}
+
+DnsResolver& SimpleHttpClient::getResolver() {
+    return *resolver;
+}
+
+void SimpleHttpClient::setConnectOptions(const ConnectOptions& options) {
+    connectOptions = options;
+}
+
+const ConnectOptions& SimpleHttpClient::getConnectOptions() const {
+    return connectOptions;
+}
+
+PoolStats SimpleHttpClient::getPoolStats() const {
+    return connectionPool->getStats();
+}
+
 HttpResponse SimpleHttpClient::get(const std::string& url) {
-    // Parse URL to extract hostname, port, and path
     std::string hostname, path;
-    int port = 80;
+    int port;
+    if (!parseUrl(url, hostname, path, port)) {
+        HttpResponse response;
+        response.errorKind = HttpError::InvalidRequest;
+        response.errorMessage = "Invalid URL: " + url;
+        return response;
+    }
     
-    // Simple URL parsing (assumes format: hostname[:port]/path or hostname/path)
-    size_t slashPos = url.find('/');
+    return makeHttpRequest(hostname, path, port, "GET");
+}
+
+bool SimpleHttpClient::parseUrl(const std::string& url, std::string& hostname, std::string& path, int& port) {
+    // Accepts hostname[:port][/path], optionally prefixed with http://
+    std::string rest = url;
+    if (rest.compare(0, 7, "http://") == 0) {
+        rest = rest.substr(7);
+    } else if (rest.find("://") != std::string::npos) {
+        return false;  // only plain HTTP is supported
+    }
+    
+    size_t slashPos = rest.find('/');
     if (slashPos == std::string::npos) {
-        hostname = url;
+        hostname = rest;
         path = "/";
     } else {
-        hostname = url.substr(0, slashPos);
-        path = url.substr(slashPos);
+        hostname = rest.substr(0, slashPos);
+        path = rest.substr(slashPos);
     }
     
-    // Check for port in hostname
-    size_t colonPos = hostname.find(':');
-    if (colonPos != std::string::npos) {
-        port = std::stoi(hostname.substr(colonPos + 1));
+    // Check for port in hostname ("[::1]:8080" keeps its brackets off the port search)
+    port = 80;
+    size_t colonPos = hostname.rfind(':');
+    if (colonPos != std::string::npos && hostname.find(']', colonPos) == std::string::npos &&
+        (hostname[0] == '[' || hostname.find(':') == colonPos)) {
+        std::string portText = hostname.substr(colonPos + 1);
+        if (portText.empty() || portText.length() > 5 ||
+            portText.find_first_not_of("0123456789") != std::string::npos) {
+            return false;
+        }
+        port = std::stoi(portText);
         hostname = hostname.substr(0, colonPos);
     }
     
-    return makeHttpRequest(hostname, path, port, "GET");
+    return !hostname.empty() && port > 0 && port <= 65535;
+}
+
+bool SimpleHttpClient::resolveLocation(const HttpRequest& base, const std::string& location, HttpRequest& next) {
+    size_t first = location.find_first_not_of(" \t");
+    size_t last = location.find_last_not_of(" \t");
+    if (first == std::string::npos) {
+        return false;
+    }
+    std::string reference = location.substr(first, last - first + 1);
+    reference = reference.substr(0, reference.find('#'));
+    
+    if (reference.compare(0, 2, "//") == 0) {
+        reference = "http:" + reference;
+    }
+    
+    // A scheme is a ':' before any '/', '?' or '#'
+    size_t colon = reference.find(':');
+    if (colon != std::string::npos && colon < reference.find_first_of("/?")) {
+        std::string scheme = reference.substr(0, colon);
+        if (!equalsIgnoreCaseAscii(scheme, "http") || reference.compare(colon, 3, "://") != 0) {
+            return false;
+        }
+        std::string hostname, path;
+        int port;
+        if (!parseUrl("http" + reference.substr(colon), hostname, path, port)) {
+            return false;
+        }
+        if (hostname.size() > 2 && hostname.front() == '[' && hostname.back() == ']') {
+            hostname = hostname.substr(1, hostname.length() - 2);
+        }
+        size_t query = path.find('?');
+        next.hostname = hostname;
+        next.port = port;
+        next.path = removeDotSegments(path.substr(0, query)) + (query == std::string::npos ? "" : path.substr(query));
+        return true;
+    }
+    
+    next.hostname = base.hostname;
+    next.port = base.port;
+    std::string basePath = base.path.substr(0, base.path.find('?'));
+    if (reference.empty()) {
+        next.path = base.path;
+        return true;
+    }
+    if (reference[0] == '?') {
+        next.path = basePath + reference;
+        return true;
+    }
+    
+    size_t query = reference.find('?');
+    std::string target = reference.substr(0, query);
+    std::string suffix = query == std::string::npos ? "" : reference.substr(query);
+    if (target[0] != '/') {
+        // Relative path: merge with the directory of the base path
+        target = basePath.substr(0, basePath.rfind('/') + 1) + target;
+        if (target[0] != '/') {
+            target = "/" + target;
+        }
+    }
+    next.path = removeDotSegments(target) + suffix;
+    return true;
 }
 
 // Static utility methods
+bool SimpleHttpClient::followRedirect(const HttpRequest& current, const HttpResponse& response,
+                                      HttpRequest& next, RedirectHop& hop) {
+    const std::string* location = response.headers.get(KnownHeader::Location);
+    next = current;
+    if (!response.isSuccess || !isFollowableRedirect(response.statusCode) || location == nullptr ||
+        !resolveLocation(current, *location, next)) {
+        return false;
+    }
+    
+    int status = response.statusCode;
+    if ((status == 303 && current.method != "HEAD") ||
+        ((status == 301 || status == 302) && current.method == "POST")) {
+        next.method = "GET";
+        next.body = RequestBody();
+        next.expectContinue = false;
+        next.headers.erase(std::remove_if(next.headers.begin(), next.headers.end(),
+                                          [](const HeaderList::value_type& header) {
+                                              return isBodyHeader(header.first);
+                                          }),
+                           next.headers.end());
+    } else if (!current.body.isReplayable()) {
+        return false;
+    }
+    
+    if (next.hostname != current.hostname || next.port != current.port) {
+        next.headers.erase(std::remove_if(next.headers.begin(), next.headers.end(),
+                                          [](const HeaderList::value_type& header) {
+                                              return isCredentialHeader(header.first);
+                                          }),
+                           next.headers.end());
+    }
+    
+    hop.method = current.method;
+    hop.url = formatUrl(current);
+    hop.statusCode = status;
+    hop.location = *location;
+    hop.timing = response.timing;
+    return true;
+}
+
+bool SimpleHttpClient::isFollowableRedirect(int statusCode) {
+    return statusCode == 301 || statusCode == 302 || statusCode == 303 || statusCode == 307 ||
+           statusCode == 308;
+}
+
 bool SimpleHttpClient::isSuccessStatusCode(int statusCode) {
     return statusCode >= 200 && statusCode < 300;
 }
@@ -245,103 +887,611 @@ bool SimpleHttpClient::isServerErrorStatusCode(int statusCode) {
     return statusCode >= 500;
 }
 
+bool SimpleHttpClient::isIdempotentMethod(const std::string& method) {
+    return method == "GET" || method == "HEAD" || method == "PUT" ||
+           method == "DELETE" || method == "OPTIONS" || method == "TRACE";
+}
+
 // Private helper methods
-bool SimpleHttpClient::parseStatusLine(const std::string& line, HttpResponse& response) {
-    std::istringstream statusStream(line);
-    if (!(statusStream >> response.httpVersion >> response.statusCode)) {
+bool SimpleHttpClient::parseStatusLine(std::string_view line, HttpResponse& response) {
+    std::string_view version;
+    std::string_view reason;
+    if (!splitStatusLine(line, version, response.statusCode, reason)) {
         response.errorMessage = "Invalid status line format";
         return false;
     }
-    
-    std::string word;
-    response.reasonPhrase = "";
-    while (statusStream >> word) {
-        if (!response.reasonPhrase.empty()) {
-            response.reasonPhrase += " ";
-        }
-        response.reasonPhrase += word;
-    }
-    
+    response.httpVersion.assign(version);
+    response.reasonPhrase.assign(reason);
     return true;
 }
 
-void SimpleHttpClient::parseHeaderLine(const std::string& line, HttpResponse& response) {
-    size_t colonPos = line.find(':');
+void SimpleHttpClient::parseHeaderLine(std::string_view line, HttpResponse& response) {
+    size_t colonPos = scanForByte(line.data(), line.length(), ':');
     if (colonPos != std::string::npos) {
-        std::string key = line.substr(0, colonPos);
-        std::string value = line.substr(colonPos + 1);
+        std::string_view key(line.data(), colonPos);
+        std::string_view value(line.data() + colonPos + 1, line.length() - colonPos - 1);
         
         // Trim whitespace
         size_t start = value.find_first_not_of(" \t");
         size_t end = value.find_last_not_of(" \t");
-        if (start != std::string::npos) {
+        if (start != std::string_view::npos) {
             value = value.substr(start, end - start + 1);
         } else {
-            value = "";
+            value = std::string_view();
         }
         
-        // Convert header key to lowercase for easier lookup
-        std::transform(key.begin(), key.end(), key.begin(), ::tolower);
-        response.headers[key] = value;
+        // Lookups are case-insensitive, so the name is kept as received
+        response.headers.add(key, value);
+    }
+}
+
+bool SimpleHttpClient::isChunkedEncoding(const HttpResponse& response) {
+    // Only a final chunked coding frames the body (RFC 9112 section 6.3)
+    std::string_view finalCoding;
+    for (std::string_view value : response.headers.getAll("Transfer-Encoding")) {
+        std::string_view coding = lastListEntry(value);
+        if (!coding.empty()) {
+            finalCoding = coding;
+        }
     }
+    return equalsIgnoreCaseAscii(finalCoding, "chunked");
 }
 
-bool SimpleHttpClient::isChunkedEncoding(const std::string& headerSection) {
-    std::string lowerHeaders = headerSection;
-    std::transform(lowerHeaders.begin(), lowerHeaders.end(), lowerHeaders.begin(), ::tolower);
-    return lowerHeaders.find("transfer-encoding: chunked") != std::string::npos;
+std::string SimpleHttpClient::receiveHttpResponse(int sockfd, const std::string& method, bool& keepAlive) {
+    ResponseReader reader(method == "HEAD");
+    readHttpResponse(sockfd, reader);
+    
+    // Only a cleanly framed response leaves the socket usable for the next request
+    keepAlive = reader.isKeepAlive();
+    return reader.takeMessage();
 }
 
-std::string SimpleHttpClient::decodeChunkedBody(const std::string& chunkedBody) {
-    std::string decodedBody;
-    std::istringstream stream(chunkedBody);
-    std::string line;
+size_t SimpleHttpClient::sendPipelineBatch(const std::vector<HttpRequest>& requests,
+                                           const std::vector<size_t>& batch,
+                                           std::vector<HttpResponse>& responses) {
+    const std::string& hostname = requests[batch.front()].hostname;
+    int port = requests[batch.front()].port;
+    // Each request's limits run from the start of the batch
+    RequestTiming::Clock::time_point start = RequestTiming::Clock::now();
+    RequestTimeouts firstLimits = requests[batch.front()].timeouts.withDefaults(timeouts);
     
-    while (std::getline(stream, line)) {
-        if (!line.empty() && line.back() == '\r') {
-            line.pop_back();
+    RequestTiming::Clock::time_point batchDeadline = deadlineAfter(firstLimits.total, RequestTiming::Clock::time_point::max());
+    
+    int sockfd;
+    if (!connectionPool->acquire(hostname, port, batchDeadline, sockfd)) {
+        for (size_t index : batch) {
+            responses[index].errorKind = HttpError::Timeout;
+            responses[index].errorMessage = "Timed out waiting for a connection to " + hostname;
+        }
+        return 0;
+    }
+    if (sockfd == -1) {
+        RequestTiming unused;
+        HttpError error = HttpError::Connect;
+        sockfd = openConnection(hostname, port, unused, deadlineAfter(firstLimits.connect, batchDeadline), error);
+        if (sockfd == -1) {
+            connectionPool->release(hostname, port, -1, false);
+            for (size_t index : batch) {
+                responses[index].errorKind = error;
+                responses[index].errorMessage = error == HttpError::Timeout ? "Timed out connecting to " + hostname
+                                                                            : "Failed to establish connection to " + hostname;
+            }
+            return 0;
+        }
+    }
+    
+    // All requests of the batch go out in a single gathered write
+    std::vector<OutgoingRequest> outgoing(batch.size());
+    std::vector<iovec> segments;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        buildRequest(requests[batch[i]], outgoing[i]);
+        segments.insert(segments.end(), outgoing[i].getSegments().begin(), outgoing[i].getSegments().end());
+    }
+    // A blocking write that stalls this long fails with EAGAIN
+    std::chrono::milliseconds sendTimeout = sendTimeoutFor(firstLimits.idle, batchDeadline);
+    if (sendTimeout.count() > 0) {
+        setSendTimeout(sockfd, sendTimeout);
+    }
+    if (!writeSegments(sockfd, std::move(segments))) {
+        HttpError failure = writeFailureKind(errno);
+        connectionPool->release(hostname, port, sockfd, false);
+        if (failure == HttpError::Timeout) {
+            for (size_t index : batch) {
+                responses[index].errorKind = HttpError::Timeout;
+                responses[index].errorMessage = "Timed out sending the request to " + hostname;
+            }
+        }
+        return 0;
+    }
+    if (sendTimeout.count() > 0) {
+        setSendTimeout(sockfd, std::chrono::milliseconds(0));
+    }
+    
+    size_t answered = 0;
+    bool keepAlive = true;
+    std::string pending;
+    
+    while (answered < batch.size() && keepAlive) {
+        const HttpRequest& request = requests[batch[answered]];
+        RequestTimeouts limits = request.timeouts.withDefaults(timeouts);
+        RequestTiming::Clock::time_point deadline = limits.total.count() > 0 ? start + limits.total
+                                                                               : RequestTiming::Clock::time_point::max();
+        ResponseReader reader(request.method == "HEAD");
+        reader.setDechunkInPlace(true);
+        if (!readHttpResponse(sockfd, reader, pending, readDeadlineFor(limits, deadline))) {
+            if (reader.getErrorKind() == HttpError::Timeout) {
+                responses[batch[answered]].errorKind = HttpError::Timeout;
+                responses[batch[answered]].errorMessage = reader.getError();
+            }
+            keepAlive = false;
+            break;
+        }
+        keepAlive = reader.isKeepAlive();
+        responses[batch[answered]] = parseHttpResponse(reader);
+        answered++;
+    }
+    
+    // Leftover bytes after the last expected response mean the stream is out of sync
+    connectionPool->release(hostname, port, sockfd,
+                            keepAlive && answered == batch.size() && pending.empty());
+    return answered;
+}
+
+int SimpleHttpClient::openConnection(const std::string& hostname, int port, RequestTiming& timing,
+                                     RequestTiming::Clock::time_point deadline, HttpError& error) {
+    ResolveResult resolved;
+    if (deadline == RequestTiming::Clock::time_point::max()) {
+        resolved = resolver->resolve(hostname);
+    } else {
+        // The lookup carries on in the background if we stop waiting for it
+        std::shared_future<ResolveResult> lookup = resolver->resolveAsync(hostname);
+        if (lookup.wait_until(deadline) != std::future_status::ready) {
+            error = HttpError::Timeout;
+            return -1;
+        }
+        resolved = lookup.get();
+    }
+    timing.dnsResolved = RequestTiming::Clock::now();
+    if (!resolved.ok()) {
+        std::cerr << "resolve: " << resolved.errorMessage() << std::endl;
+        error = HttpError::Resolve;
+        return -1;
+    }
+    
+    ConnectOptions options = connectOptions;
+    if (deadline != RequestTiming::Clock::time_point::max()) {
+        options.overallTimeout = std::min(options.overallTimeout, std::max(
+            std::chrono::ceil<std::chrono::milliseconds>(deadline - timing.dnsResolved), std::chrono::milliseconds(1)));
+    }
+    int sockfd = connectToAddresses(resolved.addresses, port, options);
+    if (sockfd == -1) {
+        error = RequestTiming::Clock::now() >= deadline ? HttpError::Timeout : HttpError::Connect;
+        return -1;
+    }
+    timing.connected = RequestTiming::Clock::now();
+    return sockfd;
+}
+
+const RequestTemplate& SimpleHttpClient::requestTemplateFor(const std::string& hostname, int port) {
+    std::string origin = hostname + ":" + std::to_string(port);
+    std::lock_guard<std::mutex> lock(requestTemplates->mutex);
+    auto it = requestTemplates->templates.find(origin);
+    if (it == requestTemplates->templates.end()) {
+        it = requestTemplates->templates.emplace(origin, RequestTemplate(hostname, port, defaultHeaders)).first;
+    }
+    // Map nodes never move, so the reference stays valid after the lock is released
+    return it->second;
+}
+
+HttpResponse SimpleHttpClient::performRequest(const HttpRequest& request, ResponseReader& reader,
+                                              RequestTiming::Clock::time_point deadline, bool hedgeable) {
+    HttpResponse response;
+    response.isSuccess = false;
+    
+    RequestTiming timing;
+    timing.start = RequestTiming::Clock::now();
+    reader.setDechunkInPlace(true);
+    
+    const std::string& hostname = request.hostname;
+    int port = request.port;
+    RequestTimeouts limits = request.timeouts.withDefaults(timeouts);
+    if (request.body.hasError()) {
+        response.errorKind = HttpError::InvalidRequest;
+        response.errorMessage = request.body.getError();
+        response.timing = timing;
+        return response;
+    }
+    OutgoingRequest outgoing;
+    buildRequest(request, outgoing);
+    hedgeable = hedgeable && hedging && (request.method == "GET" || request.method == "HEAD") && request.body.empty();
+    
+    // A pooled socket can be closed by the server between the staleness check
+    // and our write. That race is only worth one retry on a fresh connection.
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (RequestTiming::Clock::now() >= deadline) {
+            response.errorKind = HttpError::Timeout;
+            response.errorMessage = "Timed out before the request to " + hostname + " was sent";
+            response.timing = timing;
+            return response;
+        }
+        int sockfd;
+        if (!connectionPool->acquire(hostname, port, deadline, sockfd)) {
+            response.errorKind = HttpError::Timeout;
+            response.errorMessage = "Timed out waiting for a connection to " + hostname;
+            response.timing = timing;
+            return response;
+        }
+        bool reused = sockfd != -1;
+        
+        RequestTiming::Clock::time_point start = timing.start;
+        timing = RequestTiming();
+        timing.start = start;
+        timing.acquired = RequestTiming::Clock::now();
+        timing.connectionReused = reused;
+        
+        if (!reused) {
+            HttpError error = HttpError::Connect;
+            sockfd = openConnection(hostname, port, timing, deadlineAfter(limits.connect, deadline), error);
+            if (sockfd == -1) {
+                connectionPool->release(hostname, port, -1, false);
+                response.errorKind = error;
+                response.errorMessage = error == HttpError::Timeout ? "Timed out connecting to " + hostname
+                                                                    : "Failed to establish connection to " + hostname;
+                response.timing = timing;
+                return response;
+            }
+        }
+        
+        // A blocking write that stalls this long fails with EAGAIN
+        std::chrono::milliseconds sendTimeout = sendTimeoutFor(limits.idle, deadline);
+        if (sendTimeout.count() > 0) {
+            setSendTimeout(sockfd, sendTimeout);
+        }
+        
+        std::string pending;
+        bool bodySkipped = false;
+        std::string sendError = "Failed to send HTTP request";
+        HttpError sendFailure = HttpError::None;
+        bool sent = sendHttpRequest(sockfd, outgoing, &sendFailure);
+        bool bodyStarted = false;
+        if (sent && outgoing.bodyFollows()) {
+            bodyStarted = true;
+            sendFailure = sendRequestBody(sockfd, request, pending, bodySkipped, sendError);
+            sent = sendFailure == HttpError::None;
+        }
+        bool sendTimedOut = sendFailure == HttpError::Timeout;
+        if (!sent) {
+            connectionPool->release(hostname, port, sockfd, false);
+            if (reused && !sendTimedOut && (!bodyStarted || request.body.isReplayable())) {
+                continue;
+            }
+            response.errorKind = sendTimedOut ? HttpError::Timeout : HttpError::Send;
+            response.errorMessage = sendTimedOut ? "Timed out sending the request to " + hostname : sendError;
+            response.timing = timing;
+            return response;
+        }
+        if (sendTimeout.count() > 0) {
+            setSendTimeout(sockfd, std::chrono::milliseconds(0));
         }
+        timing.requestWritten = RequestTiming::Clock::now();
         
-        size_t chunkSize;
-        std::stringstream ss;
-        ss << std::hex << line;
-        ss >> chunkSize;
+        reader.reset(request.method == "HEAD");
+        bool complete = hedgeable ? receiveHedged(request, outgoing, sockfd, reader, pending,
+                                                  readDeadlineFor(limits, deadline), limits.connect)
+                                  : readHttpResponse(sockfd, reader, pending, readDeadlineFor(limits, deadline));
+        timing.firstByte = reader.getFirstByteTime();
+        timing.headersComplete = reader.getHeadersTime();
+        timing.bodyComplete = reader.getCompleteTime();
+        
+        if (!complete) {
+            connectionPool->release(hostname, port, sockfd, false);
+            // Running out of time is not a stale connection, so it is not retried
+            if (reader.getMessage().empty() && reused && isIdempotentMethod(request.method) &&
+                request.body.isReplayable() && reader.getErrorKind() != HttpError::Timeout) {
+                continue;
+            }
+            response.errorKind = reader.hasError() ? reader.getErrorKind() : HttpError::Receive;
+            response.errorMessage = reader.hasError() ? reader.getError() : "Error receiving response";
+            response.timing = timing;
+            return response;
+        }
+        
+        bool keepAlive = reader.isKeepAlive();
+        response = parseHttpResponse(reader);
+        response.timing = timing;
+        // A body declared but never sent leaves the connection out of sync
+        connectionPool->release(hostname, port, sockfd, keepAlive && response.isSuccess && !bodySkipped);
+        return response;
+    }
+    
+    response.errorKind = HttpError::Receive;
+    response.errorMessage = "Connection to " + hostname + " closed before a response was received";
+    response.timing = timing;
+    return response;
+}
+
+HttpResponse SimpleHttpClient::performCachedRequest(const HttpRequest& request,
+                                                    RequestTiming::Clock::time_point deadline) {
+    ResponseReader reader(request.method == "HEAD");
+    if (!responseCache) {
+        return performRequest(request, reader, deadline, true);
+    }
+    
+    if (request.method != "GET" && request.method != "HEAD") {
+        // A successful unsafe request may have changed the resource (RFC 9111 section 4.4)
+        HttpResponse response = performRequest(request, reader, deadline, true);
+        if (response.isSuccess && response.statusCode < 400) {
+            responseCache->erase(ResponseCache::makeKey("GET", request.hostname, request.port, request.path));
+            responseCache->erase(ResponseCache::makeKey("HEAD", request.hostname, request.port, request.path));
+        }
+        return response;
+    }
+    
+    // The caller's own conditional or partial requests, and no-store, bypass the cache
+    const std::string* cacheControl = findHeader(request.headers, "Cache-Control");
+    if (!request.body.empty() || findHeader(request.headers, "If-None-Match") != nullptr ||
+        findHeader(request.headers, "If-Modified-Since") != nullptr || findHeader(request.headers, "Range") != nullptr ||
+        (responseCache->isShared() && findHeader(request.headers, "Authorization") != nullptr) ||
+        (cacheControl != nullptr && findIgnoreCaseAscii(*cacheControl, "no-store") != std::string::npos)) {
+        return performRequest(request, reader, deadline, true);
+    }
+    
+    bool forceRevalidate = cacheControl != nullptr && (findIgnoreCaseAscii(*cacheControl, "no-cache") != std::string::npos ||
+                                                       findIgnoreCaseAscii(*cacheControl, "max-age=0") != std::string::npos);
+    std::string key = ResponseCache::makeKey(request.method, request.hostname, request.port, request.path);
+    bool fresh;
+    ResponseCache::Entry cached = responseCache->lookup(key, forceRevalidate, fresh);
+    if (fresh) {
+        HttpResponse response = cached->response;
+        response.fromCache = true;
+        return response;
+    }
+    
+    HttpResponse response;
+    if (cached) {
+        HttpRequest conditional = request;
+        if (!cached->etag.empty()) {
+            conditional.headers.emplace_back("If-None-Match", cached->etag);
+        }
+        if (!cached->lastModified.empty()) {
+            conditional.headers.emplace_back("If-Modified-Since", cached->lastModified);
+        }
+        response = performRequest(conditional, reader, deadline, true);
+        if (response.isSuccess && response.statusCode == 304) {
+            ResponseCache::Entry refreshed = responseCache->refresh(key, cached, response);
+            HttpResponse served = refreshed->response;
+            served.timing = response.timing;
+            served.fromCache = true;
+            return served;
+        }
+    } else {
+        response = performRequest(request, reader, deadline, true);
+    }
+    
+    // Server errors leave the stored copy alone; anything else replaces it
+    if (response.isSuccess && response.statusCode < 500) {
+        responseCache->store(key, response);
+    }
+    return response;
+}
+
+HttpError SimpleHttpClient::sendRequestBody(int sockfd, const HttpRequest& request, std::string& pending,
+                                            bool& bodySkipped, std::string& error) {
+    if (request.expectContinue) {
+        switch (awaitContinue(sockfd, continueTimeoutMs, pending)) {
+            case ContinueResult::Continue:
+            case ContinueResult::Timeout:
+                break;
+            case ContinueResult::FinalResponse:
+                // Rejected (or answered) before upload: the body is never sent
+                bodySkipped = true;
+                return HttpError::None;
+            case ContinueResult::Closed:
+                error = "Connection closed while waiting for 100 Continue";
+                return HttpError::Send;
+        }
+    }
+    HttpError kind = HttpError::None;
+    return request.body.sendTo(sockfd, &error, &kind) ? HttpError::None : kind;
+}
+
+bool SimpleHttpClient::receiveHedged(const HttpRequest& request, const OutgoingRequest& outgoing, int& sockfd,
+                                     ResponseReader& reader, std::string& pending, const ReadDeadline& limits,
+                                     std::chrono::milliseconds connectLimit) {
+    typedef RequestTiming::Clock Clock;
+    std::string origin = request.hostname + ":" + std::to_string(request.port);
+    Clock::time_point sentAt = Clock::now();
+    std::chrono::milliseconds delay = hedging->startRequest(origin);
+    
+    // Hedge only when the delay runs out before any deadline, with no byte of the response seen
+    int hedgefd = -1;
+    bool hedged = false;
+    if (delay != std::chrono::milliseconds::max() && pending.empty()) {
+        Clock::time_point hedgeAt = sentAt + delay;
+        hedged = hedgeAt < std::min(limits.complete, limits.firstByte) && !waitReadable(sockfd, hedgeAt) &&
+                 openHedge(request, outgoing, sockfd, connectLimit, limits.complete, hedgefd);
+    }
+    if (!hedged) {
+        bool complete = readHttpResponse(sockfd, reader, pending, limits);
+        if (reader.getFirstByteTime() != ResponseReader::Clock::time_point()) {
+            hedging->recordLatency(origin, reader.getFirstByteTime() - sentAt);
+        }
+        return complete;
+    }
+    
+    // Both copies are read until one of them completes
+    ResponseReader hedgeReader(request.method == "HEAD");
+    hedgeReader.setDechunkInPlace(true);
+    std::string hedgePending;
+    Clock::time_point hedgeSent = Clock::now();
+    Clock::time_point hedgeFirstByte = limits.firstByte == Clock::time_point::max()
+                                           ? Clock::time_point::max()
+                                           : std::min(limits.complete, limits.firstByte + (hedgeSent - sentAt));
+    HedgeLeg legs[2] = {{sockfd, &reader, &pending, limits.firstByte, sentAt, true},
+                        {hedgefd, &hedgeReader, &hedgePending, hedgeFirstByte, hedgeSent, true}};
+    char buffer[16384];
+    int winner = -1;
+    
+    while (winner == -1 && (legs[0].live || legs[1].live)) {
+        pollfd entries[2];
+        int owners[2];
+        nfds_t count = 0;
+        Clock::time_point until = Clock::time_point::max();
+        for (int i = 0; i < 2; ++i) {
+            if (legs[i].live) {
+                entries[count].fd = legs[i].sockfd;
+                entries[count].events = POLLIN;
+                entries[count].revents = 0;
+                owners[count++] = i;
+                until = std::min(until, legDeadline(legs[i], limits));
+            }
+        }
         
-        if (chunkSize == 0) {
+        int timeoutMs = -1;
+        if (until != Clock::time_point::max()) {
+            auto remaining = std::chrono::ceil<std::chrono::milliseconds>(until - Clock::now());
+            timeoutMs = static_cast<int>(std::clamp<long long>(remaining.count(), 0, std::numeric_limits<int>::max()));
+        }
+        if (poll(entries, count, timeoutMs) == -1 && errno != EINTR) {
             break;
         }
         
-        std::string chunkData;
-        for (size_t i = 0; i < chunkSize && std::getline(stream, line); ++i) {
-            if (!line.empty() && line.back() == '\r') {
-                line.pop_back();
+        for (nfds_t i = 0; i < count && winner == -1; ++i) {
+            HedgeLeg& leg = legs[owners[i]];
+            if (entries[i].revents != 0) {
+                drainLeg(leg, buffer, sizeof buffer);
+                if (leg.reader->isComplete()) {
+                    winner = owners[i];
+                }
             }
-            chunkData += line;
-            if (i < chunkSize - 1) chunkData += "\n";
         }
         
-        decodedBody += chunkData;
+        Clock::time_point now = Clock::now();
+        for (int i = 0; i < 2 && winner == -1; ++i) {
+            if (legs[i].live && now >= legDeadline(legs[i], limits)) {
+                legs[i].reader->timeOut(legs[i].reader->getFirstByteTime() == ResponseReader::Clock::time_point()
+                                            ? "Timed out waiting for the response"
+                                            : "Timed out receiving the response");
+                legs[i].live = false;
+            }
+        }
+    }
+    
+    if (winner != -1) {
+        hedging->recordLatency(origin, legs[winner].reader->getFirstByteTime() - sentAt);
+    }
+    // The copy that lost is cancelled by closing its connection
+    if (winner == 1) {
+        connectionPool->release(request.hostname, request.port, sockfd, false);
+        sockfd = hedgefd;
+        reader = std::move(hedgeReader);
+        pending = std::move(hedgePending);
+        hedging->recordWon();
+    } else {
+        connectionPool->release(request.hostname, request.port, hedgefd, false);
+    }
+    return winner != -1;
+}
+
+bool SimpleHttpClient::openHedge(const HttpRequest& request, const OutgoingRequest& outgoing, int primary,
+                                 std::chrono::milliseconds connectLimit, RequestTiming::Clock::time_point deadline,
+                                 int& hedgefd) {
+    const std::string& hostname = request.hostname;
+    int port = request.port;
+    // A hedge never waits for a connection slot
+    if (!connectionPool->tryAcquire(hostname, port, hedgefd)) {
+        return false;
+    }
+    if (!hedging->tryHedge()) {
+        connectionPool->release(hostname, port, hedgefd, true);
+        return false;
+    }
+    
+    if (hedgefd == -1) {
+        // The name was just resolved for the original, so this is a cache hit
+        ResolveResult resolved = resolver->resolve(hostname);
+        if (resolved.ok()) {
+            moveToBack(resolved.addresses, primary, port);
+            ConnectOptions options = connectOptions;
+            RequestTiming::Clock::time_point connectBy = deadlineAfter(connectLimit, deadline);
+            if (connectBy != RequestTiming::Clock::time_point::max()) {
+                options.overallTimeout = std::min(options.overallTimeout, std::max(
+                    std::chrono::ceil<std::chrono::milliseconds>(connectBy - RequestTiming::Clock::now()),
+                    std::chrono::milliseconds(1)));
+            }
+            hedgefd = connectToAddresses(resolved.addresses, port, options);
+        }
+        if (hedgefd == -1) {
+            connectionPool->release(hostname, port, -1, false);
+            return false;
+        }
+    }
+    
+    if (!sendHttpRequest(hedgefd, outgoing)) {
+        connectionPool->release(hostname, port, hedgefd, false);
+        hedgefd = -1;
+        return false;
+    }
+    hedging->recordSent();
+    return true;
+}
+
+bool SimpleHttpClient::decodeContentEncoding(HttpResponse& response) {
+    response.compressedBodySize = response.body.length();
+    response.decodedBodySize = response.body.length();
+    
+    const std::string* encoding = response.headers.get(KnownHeader::ContentEncoding);
+    if (encoding == nullptr || response.body.empty()) {
+        return true;
     }
     
-    return decodedBody;
+    ContentDecoder::Encoding coding = ContentDecoder::parseEncoding(*encoding);
+    if (coding == ContentDecoder::Encoding::Identity || coding == ContentDecoder::Encoding::Unsupported) {
+        // Unknown codings are handed back as received
+        return true;
+    }
+    
+    std::string error;
+    if (!ContentDecoder::decodeBody(response.body, coding, &error)) {
+        response.errorMessage = "Content decoding failed: " + error;
+        return false;
+    }
+    response.decodedBodySize = response.body.length();
+    return true;
+}
+
+bool SimpleHttpClient::decodeChunkedBody(std::string& body, HttpResponse& response) {
+    std::string error;
+    if (!ChunkedDecoder::decodeBody(body, &error)) {
+        response.errorMessage = "Malformed chunked body: " + error;
+        return false;
+    }
+    return true;
 }
 
 void SimpleHttpClient::handleSuccessResponse(const HttpResponse& response) {
     std::cout << "✓ Success! Request completed successfully." << std::endl;
     
-    auto contentType = response.headers.find("content-type");
-    if (contentType != response.headers.end()) {
-        std::cout << "Content Type: " << contentType->second << std::endl;
+    const std::string* contentType = response.headers.get(KnownHeader::ContentType);
+    if (contentType != nullptr) {
+        std::cout << "Content Type: " << *contentType << std::endl;
     }
 }
 
 void SimpleHttpClient::handleRedirectResponse(const HttpResponse& response) {
     std::cout << "↻ Redirect response." << std::endl;
     
-    auto location = response.headers.find("location");
-    if (location != response.headers.end()) {
-        std::cout << "Redirect location: " << location->second << std::endl;
-        std::cout << "Note: This client doesn't automatically follow redirects." << std::endl;
+    const std::string* location = response.headers.get(KnownHeader::Location);
+    if (location != nullptr) {
+        std::cout << "Redirect location: " << *location << std::endl;
+        if (!isFollowableRedirect(response.statusCode)) {
+            std::cout << "Note: " << response.statusCode << " responses are not followed automatically." << std::endl;
+        } else if (static_cast<int>(response.redirectChain.size()) >= maxRedirects) {
+            std::cout << "Note: Not followed, the limit of " << maxRedirects << " redirects was reached." << std::endl;
+        } else {
+            std::cout << "Note: Not followed, the location is not a plain HTTP URL or the body could not be resent."
+                      << std::endl;
+        }
     }
 }
 
@@ -387,32 +1537,42 @@ void SimpleHttpClient::handleServerErrorResponse(const HttpResponse& response) {
 void SimpleHttpClient::displayImportantHeaders(const HttpResponse& response) {
     std::cout << "\nImportant Headers:" << std::endl;
     
-    std::vector<std::string> importantHeaders = {
-        "content-length", "content-type", "server", "date", 
-        "cache-control", "set-cookie", "location"
+    static const KnownHeader importantHeaders[] = {
+        KnownHeader::ContentLength, KnownHeader::ContentType, KnownHeader::Server, KnownHeader::Date,
+        KnownHeader::CacheControl, KnownHeader::SetCookie, KnownHeader::Location
     };
     
-    for (const std::string& headerName : importantHeaders) {
-        auto it = response.headers.find(headerName);
-        if (it != response.headers.end()) {
-            std::cout << "  " << headerName << ": " << it->second << std::endl;
+    for (KnownHeader id : importantHeaders) {
+        if (!response.headers.contains(id)) {
+            continue;
+        }
+        // Repeated fields such as Set-Cookie are listed one per line
+        for (std::string_view value : response.headers.getAll(HeaderTable::nameOf(id))) {
+            std::cout << "  " << HeaderTable::nameOf(id) << ": " << value << std::endl;
         }
     }
 }
 
 void SimpleHttpClient::displayBodyInfo(const HttpResponse& response) {
     std::cout << "\nResponse Body:" << std::endl;
-    std::cout << "Length: " << response.body.length() << " bytes" << std::endl;
+    std::cout << "Length: " << response.body.length() << " bytes";
+    const std::string* encoding = response.headers.get(KnownHeader::ContentEncoding);
+    if (encoding != nullptr && response.compressedBodySize != response.decodedBodySize) {
+        std::cout << " (" << response.compressedBodySize << " bytes " << *encoding << ")";
+    }
+    std::cout << std::endl;
     
     if (!response.body.empty()) {
-        auto contentType = response.headers.find("content-type");
-        bool isText = true;
+        const std::string* contentType = response.headers.get(KnownHeader::ContentType);
+        bool isText;
         
-        if (contentType != response.headers.end()) {
-            std::string type = contentType->second;
+        if (contentType != nullptr) {
+            const std::string& type = *contentType;
             isText = (type.find("text/") == 0 || 
                      type.find("application/json") != std::string::npos ||
                      type.find("application/xml") != std::string::npos);
+        } else {
+            isText = looksLikeText(response.body);
         }
         
         if (isText) {
@@ -428,3 +1588,31 @@ void SimpleHttpClient::displayBodyInfo(const HttpResponse& response) {
         }
     }
 }
+
+void SimpleHttpClient::displayTiming(const HttpResponse& response) {
+    const RequestTiming& timing = response.timing;
+    if (timing.total().count() == 0) {
+        return;
+    }
+    
+    auto ms = [](std::chrono::nanoseconds duration) { return duration.count() / 1e6; };
+    std::cout << "\nTiming (" << (timing.connectionReused ? "reused connection" : "new connection") << "):" << std::endl;
+    std::cout << "  DNS: " << ms(timing.dnsTime()) << " ms, connect: " << ms(timing.connectTime())
+              << " ms, send: " << ms(timing.sendTime()) << " ms" << std::endl;
+    std::cout << "  first byte: " << ms(timing.timeToFirstByte()) << " ms, headers: " << ms(timing.headerTime())
+              << " ms, body: " << ms(timing.bodyTime()) << " ms" << std::endl;
+    std::cout << "  total: " << ms(timing.total()) << " ms" << std::endl;
+}
+
+void SimpleHttpClient::displayRedirectChain(const HttpResponse& response) {
+    if (response.redirectChain.empty()) {
+        return;
+    }
+    
+    std::cout << "Redirects followed: " << response.redirectChain.size() << std::endl;
+    for (const RedirectHop& hop : response.redirectChain) {
+        std::cout << "  " << hop.statusCode << " " << hop.method << " " << hop.url << " -> " << hop.location
+                  << " (" << hop.timing.total().count() / 1e6 << " ms, "
+                  << (hop.timing.connectionReused ? "reused connection" : "new connection") << ")" << std::endl;
+    }
+}
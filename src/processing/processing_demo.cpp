@@ -29,10 +29,18 @@ int main() {
         {"httpbin.org", "/redirect/1"}       // Redirect
     };
     
+    // Fetch them all at once; responses come back in the same order
+    std::vector<std::string> urls;
     for (const auto& testCase : testCases) {
+        urls.push_back(testCase.first + testCase.second);
+    }
+    std::vector<HttpResponse> responses = client.getMany(urls);
+    
+    for (size_t i = 0; i < testCases.size(); ++i) {
+        const auto& testCase = testCases[i];
         std::cout << "\n=== Testing: " << testCase.first << testCase.second << " ===" << std::endl;
         
-        response = client.makeHttpRequest(testCase.first, testCase.second);
+        response = responses[i];
         client.processResponse(response);
         
         // Check status using utility methods
@@ -0,0 +1,345 @@
+#include "processing/response_cache.h"
+#include "request/http_scan.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <time.h>
+
+namespace {
+
+const long long kMaxHeuristicLifetime = 24 * 60 * 60;
+
+struct CacheControl {
+    bool noStore = false;
+    bool noCache = false;
+    bool isPrivate = false;
+    bool hasMaxAge = false;
+    bool hasSharedMaxAge = false;
+    long long maxAge = 0;
+    long long sharedMaxAge = 0;
+};
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+// Delta-seconds: digits only; anything else makes the directive invalid
+bool parseSeconds(std::string_view text, long long& seconds) {
+    if (text.size() >= 2 && text.front() == '"' && text.back() == '"') {
+        text = text.substr(1, text.size() - 2);
+    }
+    if (text.empty() || text.size() > 18 || text.find_first_not_of("0123456789") != std::string_view::npos) {
+        return false;
+    }
+    seconds = std::atoll(std::string(text).c_str());
+    return true;
+}
+
+CacheControl parseCacheControl(const HeaderTable& headers) {
+    CacheControl result;
+    for (std::string_view value : headers.getAll("Cache-Control")) {
+        while (!value.empty()) {
+            size_t comma = value.find(',');
+            std::string_view directive = trim(value.substr(0, comma));
+            value = comma == std::string_view::npos ? std::string_view() : value.substr(comma + 1);
+
+            size_t equals = directive.find('=');
+            std::string_view name = trim(directive.substr(0, equals));
+            std::string_view argument = equals == std::string_view::npos ? std::string_view()
+                                                                         : trim(directive.substr(equals + 1));
+
+            // no-cache="field" and private="field" are treated as applying to the whole response
+            if (equalsIgnoreCaseAscii(name, "no-store")) {
+                result.noStore = true;
+            } else if (equalsIgnoreCaseAscii(name, "no-cache")) {
+                result.noCache = true;
+            } else if (equalsIgnoreCaseAscii(name, "private")) {
+                result.isPrivate = true;
+            } else if (equalsIgnoreCaseAscii(name, "max-age")) {
+                result.hasMaxAge = parseSeconds(argument, result.maxAge);
+            } else if (equalsIgnoreCaseAscii(name, "s-maxage")) {
+                result.hasSharedMaxAge = parseSeconds(argument, result.sharedMaxAge);
+            }
+        }
+    }
+    return result;
+}
+
+bool isCacheableStatus(int statusCode) {
+    switch (statusCode) {
+        case 200: case 203: case 204: case 300: case 301: case 308:
+        case 404: case 405: case 410: case 414: case 501:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Header fields a 304 must not overwrite in the stored response
+bool describesBody(std::string_view name) {
+    return equalsIgnoreCaseAscii(name, "Content-Length") || equalsIgnoreCaseAscii(name, "Content-Encoding") ||
+           equalsIgnoreCaseAscii(name, "Transfer-Encoding") || equalsIgnoreCaseAscii(name, "Content-Range");
+}
+
+} // namespace
+
+ResponseCache::ResponseCache(size_t maxBytes, size_t shardCount, bool shared)
+    : maxBytes(maxBytes), shared(shared), hits(0), misses(0), revalidations(0), notModifiedCount(0),
+      stores(0), evictions(0) {
+    shardCount = std::max<size_t>(shardCount, 1);
+    shardBytes = std::max<size_t>(maxBytes / shardCount, 1);
+    for (size_t i = 0; i < shardCount; ++i) {
+        shards.emplace_back(new Shard());
+    }
+}
+
+std::string ResponseCache::makeKey(std::string_view method, const std::string& hostname, int port,
+                                   std::string_view path) {
+    std::string key;
+    key.reserve(method.size() + hostname.size() + path.size() + 8);
+    key.append(method).append(" ").append(hostname).append(":").append(std::to_string(port)).append(path);
+    return key;
+}
+
+ResponseCache::Entry ResponseCache::lookup(const std::string& key, bool forceRevalidate, bool& fresh) {
+    fresh = false;
+    Entry entry;
+    {
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            entry = it->second->second;
+        }
+    }
+
+    if (entry && !forceRevalidate && entry->isFresh(Clock::now())) {
+        fresh = true;
+        hits++;
+        return entry;
+    }
+    if (entry && entry->hasValidator()) {
+        revalidations++;
+        return entry;
+    }
+    misses++;
+    return nullptr;
+}
+
+ResponseCache::Entry ResponseCache::store(const std::string& key, const HttpResponse& response) {
+    std::shared_ptr<CachedResponse> entry = makeEntry(response, key);
+    if (!entry) {
+        // Whatever was stored has been superseded by a response we may not keep
+        erase(key);
+        return nullptr;
+    }
+    if (!insert(key, entry)) {
+        return nullptr;
+    }
+    stores++;
+    return entry;
+}
+
+ResponseCache::Entry ResponseCache::refresh(const std::string& key, const Entry& stale,
+                                            const HttpResponse& notModified) {
+    notModifiedCount++;
+
+    HttpResponse merged = stale->response;
+    for (const HeaderTable::Field& field : notModified.headers) {
+        if (!describesBody(field.name)) {
+            merged.headers.erase(field.name);
+        }
+    }
+    for (const HeaderTable::Field& field : notModified.headers) {
+        if (!describesBody(field.name)) {
+            merged.headers.add(field.name, field.value);
+        }
+    }
+
+    std::shared_ptr<CachedResponse> entry = makeEntry(merged, key);
+    if (!entry) {
+        // Still good for this request, but the server no longer lets us keep it
+        erase(key);
+        std::shared_ptr<CachedResponse> once = std::make_shared<CachedResponse>(*stale);
+        once->response = std::move(merged);
+        return once;
+    }
+    insert(key, entry);
+    return entry;
+}
+
+void ResponseCache::erase(const std::string& key) {
+    Shard& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    eraseLocked(shard, key);
+}
+
+void ResponseCache::clear() {
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->lru.clear();
+        shard->index.clear();
+        shard->bytes = 0;
+    }
+}
+
+size_t ResponseCache::size() const {
+    size_t total = 0;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total += shard->index.size();
+    }
+    return total;
+}
+
+size_t ResponseCache::bytes() const {
+    size_t total = 0;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total += shard->bytes;
+    }
+    return total;
+}
+
+CacheStats ResponseCache::getStats() const {
+    CacheStats stats;
+    stats.hits = hits.load();
+    stats.misses = misses.load();
+    stats.revalidations = revalidations.load();
+    stats.notModified = notModifiedCount.load();
+    stats.stores = stores.load();
+    stats.evictions = evictions.load();
+    return stats;
+}
+
+bool ResponseCache::parseHttpDate(std::string_view text, std::time_t& result) {
+    // IMF-fixdate first; RFC 850 and asctime dates are still accepted from old servers
+    static const char* const formats[] = {
+        "%a, %d %b %Y %H:%M:%S GMT",
+        "%A, %d-%b-%y %H:%M:%S GMT",
+        "%a %b %e %H:%M:%S %Y",
+    };
+    std::string date(trim(text));
+    for (const char* format : formats) {
+        struct tm parts;
+        std::memset(&parts, 0, sizeof parts);
+        const char* end = strptime(date.c_str(), format, &parts);
+        if (end != nullptr && *end == '\0') {
+            result = timegm(&parts);
+            return result != static_cast<std::time_t>(-1);
+        }
+    }
+    return false;
+}
+
+// Private helper methods
+ResponseCache::Shard& ResponseCache::shardFor(const std::string& key) {
+    return *shards[std::hash<std::string>()(key) % shards.size()];
+}
+
+std::shared_ptr<CachedResponse> ResponseCache::makeEntry(const HttpResponse& response,
+                                                         const std::string& key) const {
+    if (!response.isSuccess || response.bodyStreamed || !isCacheableStatus(response.statusCode) ||
+        response.headers.contains(KnownHeader::Vary)) {
+        return nullptr;
+    }
+    CacheControl control = parseCacheControl(response.headers);
+    if (control.noStore || (shared && control.isPrivate)) {
+        return nullptr;
+    }
+
+    std::time_t now = std::time(nullptr);
+    std::time_t date = now;
+    const std::string* dateHeader = response.headers.get(KnownHeader::Date);
+    if (dateHeader != nullptr && !parseHttpDate(*dateHeader, date)) {
+        date = now;
+    }
+
+    // How old the response already is: the Age header or clock skew, whichever is more
+    long long age = std::max<long long>(0, static_cast<long long>(now - date));
+    long long ageHeader = 0;
+    const std::string* ageValue = response.headers.get(KnownHeader::Age);
+    if (ageValue != nullptr && parseSeconds(trim(*ageValue), ageHeader)) {
+        age = std::max(age, ageHeader);
+    }
+
+    long long lifetime = 0;
+    std::time_t parsed;
+    const std::string* expires = response.headers.get(KnownHeader::Expires);
+    const std::string* lastModified = response.headers.get(KnownHeader::LastModified);
+    if (shared && control.hasSharedMaxAge) {
+        lifetime = control.sharedMaxAge;
+    } else if (control.hasMaxAge) {
+        lifetime = control.maxAge;
+    } else if (expires != nullptr) {
+        // An invalid Expires means already expired
+        lifetime = parseHttpDate(*expires, parsed) ? static_cast<long long>(parsed - date) : 0;
+    } else if (lastModified != nullptr && parseHttpDate(*lastModified, parsed) && parsed < date) {
+        lifetime = std::min<long long>((date - parsed) / 10, kMaxHeuristicLifetime);
+    }
+
+    std::shared_ptr<CachedResponse> entry = std::make_shared<CachedResponse>();
+    const std::string* etag = response.headers.get(KnownHeader::ETag);
+    if (etag != nullptr) {
+        entry->etag = *etag;
+    }
+    if (lastModified != nullptr) {
+        entry->lastModified = *lastModified;
+    }
+    long long remaining = std::max<long long>(lifetime - age, 0);
+    if (remaining == 0 && !entry->hasValidator()) {
+        return nullptr;  // would never be served
+    }
+
+    entry->expires = Clock::now() + std::chrono::seconds(remaining);
+    entry->alwaysRevalidate = control.noCache;
+    entry->response = response;
+    entry->response.timing = RequestTiming();
+    entry->response.redirectChain.clear();
+
+    entry->size = sizeof(CachedResponse) + key.size() + response.body.size();
+    for (const HeaderTable::Field& field : response.headers) {
+        entry->size += field.name.size() + field.value.size() + 4;
+    }
+    return entry;
+}
+
+bool ResponseCache::insert(const std::string& key, Entry entry) {
+    Shard& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    eraseLocked(shard, key);
+    if (entry->size > shardBytes) {
+        return false;  // larger than the whole shard; keeping it would flush everything else
+    }
+
+    shard.lru.emplace_front(key, entry);
+    shard.index[key] = shard.lru.begin();
+    shard.bytes += entry->size;
+
+    while (shard.bytes > shardBytes) {
+        auto& oldest = shard.lru.back();
+        shard.bytes -= oldest.second->size;
+        shard.index.erase(oldest.first);
+        shard.lru.pop_back();
+        evictions++;
+    }
+    return true;
+}
+
+void ResponseCache::eraseLocked(Shard& shard, const std::string& key) {
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        return;
+    }
+    shard.bytes -= it->second->second->size;
+    shard.lru.erase(it->second);
+    shard.index.erase(it);
+}
@@ -0,0 +1,209 @@
+#include "processing/timer_wheel.h"
+#include <algorithm>
+
+namespace {
+
+const uint64_t kNoTick = ~uint64_t(0);
+
+} // namespace
+
+TimerWheel::Timer::~Timer() {
+    if (wheel != nullptr) {
+        wheel->cancel(*this);
+    }
+}
+
+TimerWheel::TimerWheel(Clock::time_point origin) : origin(origin), current(0), count(0) {
+    std::fill(buckets, buckets + kBuckets, nullptr);
+    std::fill(occupied, occupied + kOverflow / 64, 0);
+}
+
+TimerWheel::~TimerWheel() {
+    for (size_t bucket = 0; bucket < kBuckets; ++bucket) {
+        for (Timer* timer = buckets[bucket]; timer != nullptr; timer = timer->next) {
+            timer->wheel = nullptr;
+        }
+    }
+}
+
+void TimerWheel::schedule(Timer& timer, Clock::time_point deadline) {
+    if (timer.wheel == this) {
+        unlink(timer);
+    } else if (timer.wheel != nullptr) {
+        timer.wheel->cancel(timer);
+    }
+    timer.wheel = this;
+    timer.expiry = std::max(tickOf(deadline), current);
+    place(timer);
+}
+
+void TimerWheel::cancel(Timer& timer) {
+    if (timer.wheel != this) {
+        return;
+    }
+    unlink(timer);
+    timer.wheel = nullptr;
+}
+
+size_t TimerWheel::advance(Clock::time_point now) {
+    if (now < origin) {
+        return 0;
+    }
+    uint64_t target = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(now - origin).count());
+
+    size_t fired = 0;
+    while (current <= target) {
+        // Jump straight to the next tick with work; the slots in between are empty
+        uint64_t tick = count == 0 ? kNoTick : nextTick();
+        if (tick > target) {
+            current = target + 1;
+            break;
+        }
+        current = tick;
+
+        // Bring down the timers of every level whose slot starts on this tick, coarsest first
+        if ((current & ((uint64_t(1) << (kLevels * kLevelBits)) - 1)) == 0) {
+            cascade(kOverflow);
+        }
+        for (size_t level = kLevels - 1; level > 0; --level) {
+            size_t shift = level * kLevelBits;
+            if ((current & ((uint64_t(1) << shift) - 1)) == 0) {
+                cascade(level * kSlots + ((current >> shift) & (kSlots - 1)));
+            }
+        }
+
+        // Level 0 holds exactly the timers due on this tick
+        size_t slot = current & (kSlots - 1);
+        Timer* due = buckets[slot];
+        buckets[slot] = nullptr;
+        occupied[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+        for (Timer* timer = due; timer != nullptr; timer = timer->next) {
+            timer->bucket = kFiring;
+        }
+        buckets[kFiring] = due;
+
+        // Timers scheduled by the callbacks land on later ticks
+        current++;
+        while (Timer* timer = buckets[kFiring]) {
+            unlink(*timer);
+            timer->wheel = nullptr;
+            fired++;
+            if (timer->callback) {
+                // Called through a copy: the callback may destroy its own timer
+                std::function<void()> callback = timer->callback;
+                callback();
+            }
+        }
+    }
+    return fired;
+}
+
+TimerWheel::Clock::time_point TimerWheel::nextWakeup() const {
+    uint64_t tick = count == 0 ? kNoTick : nextTick();
+    if (tick == kNoTick) {
+        return Clock::time_point::max();
+    }
+    return origin + std::chrono::milliseconds(tick);
+}
+
+// Private helper methods
+uint64_t TimerWheel::tickOf(Clock::time_point deadline) const {
+    if (deadline <= origin) {
+        return 0;
+    }
+    // Rounded up, so a timer never fires before its deadline
+    return static_cast<uint64_t>(std::chrono::ceil<std::chrono::milliseconds>(deadline - origin).count());
+}
+
+void TimerWheel::place(Timer& timer) {
+    // The finest level whose current turn the expiry falls in
+    for (size_t level = 0; level < kLevels; ++level) {
+        size_t shift = level * kLevelBits;
+        if ((timer.expiry >> (shift + kLevelBits)) == (current >> (shift + kLevelBits))) {
+            link(timer, level * kSlots + ((timer.expiry >> shift) & (kSlots - 1)));
+            return;
+        }
+    }
+    link(timer, kOverflow);
+}
+
+void TimerWheel::link(Timer& timer, size_t bucket) {
+    timer.bucket = bucket;
+    timer.prev = nullptr;
+    timer.next = buckets[bucket];
+    if (timer.next != nullptr) {
+        timer.next->prev = &timer;
+    }
+    buckets[bucket] = &timer;
+    if (bucket < kOverflow) {
+        occupied[bucket / 64] |= uint64_t(1) << (bucket % 64);
+    }
+    count++;
+}
+
+void TimerWheel::unlink(Timer& timer) {
+    if (timer.prev != nullptr) {
+        timer.prev->next = timer.next;
+    } else {
+        buckets[timer.bucket] = timer.next;
+    }
+    if (timer.next != nullptr) {
+        timer.next->prev = timer.prev;
+    }
+    if (timer.bucket < kOverflow && buckets[timer.bucket] == nullptr) {
+        occupied[timer.bucket / 64] &= ~(uint64_t(1) << (timer.bucket % 64));
+    }
+    timer.prev = nullptr;
+    timer.next = nullptr;
+    count--;
+}
+
+void TimerWheel::cascade(size_t bucket) {
+    // Detached first: overflow timers that are still far off go straight back
+    Timer* timer = buckets[bucket];
+    buckets[bucket] = nullptr;
+    if (bucket < kOverflow) {
+        occupied[bucket / 64] &= ~(uint64_t(1) << (bucket % 64));
+    }
+    while (timer != nullptr) {
+        Timer* next = timer->next;
+        count--;
+        place(*timer);
+        timer = next;
+    }
+}
+
+uint64_t TimerWheel::nextTick() const {
+    // A level's slot is due when the wheel turns onto it; the slot the wheel
+    // is on can only hold timers if it turned there without processing yet
+    uint64_t best = kNoTick;
+    for (size_t level = 0; level < kLevels; ++level) {
+        size_t shift = level * kLevelBits;
+        size_t slot = findSlot(level, (current >> shift) & (kSlots - 1));
+        if (slot != kSlots) {
+            uint64_t turn = (current >> (shift + kLevelBits)) << (shift + kLevelBits);
+            best = std::min(best, std::max(turn | (uint64_t(slot) << shift), current));
+        }
+    }
+    if (buckets[kOverflow] != nullptr) {
+        size_t span = kLevels * kLevelBits;
+        uint64_t turn = (current >> span) << span;
+        best = std::min(best, turn == current ? current : turn + (uint64_t(1) << span));
+    }
+    return best;
+}
+
+size_t TimerWheel::findSlot(size_t level, size_t from) const {
+    const uint64_t* words = occupied + level * (kSlots / 64);
+    for (size_t word = from / 64; word < kSlots / 64; ++word) {
+        uint64_t bits = words[word];
+        if (word == from / 64) {
+            bits &= ~uint64_t(0) << (from % 64);
+        }
+        if (bits != 0) {
+            return word * 64 + __builtin_ctzll(bits);
+        }
+    }
+    return kSlots;
+}
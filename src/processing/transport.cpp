@@ -0,0 +1,92 @@
+#include "processing/transport.h"
+#include "processing/uring_transport.h"
+#include <cerrno>
+#include <sys/socket.h>
+#include <unistd.h>
+
+std::shared_ptr<Transport> Transport::create(IoScheduler& scheduler, TransportKind kind) {
+    if (kind != TransportKind::Epoll) {
+        std::shared_ptr<UringTransport> uring = std::make_shared<UringTransport>(scheduler);
+        if (uring->isReady()) {
+            return uring;
+        }
+    }
+    return std::make_shared<EpollTransport>(scheduler);
+}
+
+Task<int> EpollTransport::connect(int sockfd, ResolvedAddress address, CancellationToken token) {
+    // A socket closed without forget() may have left this number watched
+    scheduler.forget(sockfd);
+    if (::connect(sockfd, address.sockaddrPtr(), address.length) == 0) {
+        co_return 0;
+    }
+    if (errno != EINPROGRESS) {
+        co_return -errno;
+    }
+    if (!co_await scheduler.writable(sockfd, token)) {
+        co_return -ECANCELED;
+    }
+    int error = 0;
+    socklen_t length = sizeof error;
+    if (getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &error, &length) == -1) {
+        co_return -errno;
+    }
+    co_return -error;
+}
+
+Task<ssize_t> EpollTransport::send(int sockfd, const iovec* segments, size_t count, CancellationToken token) {
+    msghdr message = {};
+    message.msg_iov = const_cast<iovec*>(segments);
+    message.msg_iovlen = count;
+    while (true) {
+        ssize_t n = sendmsg(sockfd, &message, MSG_NOSIGNAL);
+        if (n >= 0) {
+            co_return n;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            co_return -errno;
+        }
+        if (!co_await scheduler.writable(sockfd, token)) {
+            co_return -ECANCELED;
+        }
+    }
+}
+
+Task<bool> EpollTransport::writable(int sockfd, CancellationToken token) {
+    co_return co_await scheduler.writable(sockfd, token);
+}
+
+Task<ssize_t> EpollTransport::receive(int sockfd, char* buffer, size_t length, CancellationToken token) {
+    while (true) {
+        ssize_t n = recv(sockfd, buffer, length, 0);
+        if (n >= 0) {
+            co_return n;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            co_return -errno;
+        }
+        if (!co_await scheduler.readable(sockfd, token)) {
+            co_return -ECANCELED;
+        }
+    }
+}
+
+bool EpollTransport::isStale(int sockfd) {
+    char byte;
+    ssize_t n = recv(sockfd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (n >= 0) {
+        return true;
+    }
+    return errno != EAGAIN && errno != EWOULDBLOCK;
+}
+
+void EpollTransport::close(int sockfd) {
+    scheduler.forget(sockfd);
+    ::close(sockfd);
+}
@@ -0,0 +1,600 @@
+#include "processing/uring_transport.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+const unsigned kRingEntries = 1024;
+const unsigned kCompletionEntries = 4 * kRingEntries;  // multishot receives post several per request
+const unsigned kBufferCount = 1024;                    // power of two, at most 32768
+const size_t kBufferSize = 16384;
+const uint16_t kBufferGroup = 0;
+
+// Indices shared with the kernel: read what it published, publish what we filled in
+unsigned loadAcquire(unsigned* value) {
+    return std::atomic_ref<unsigned>(*value).load(std::memory_order_acquire);
+}
+
+void storeRelease(unsigned* value, unsigned update) {
+    std::atomic_ref<unsigned>(*value).store(update, std::memory_order_release);
+}
+
+io_uring_sqe blankSqe(uint8_t opcode, int fd) {
+    io_uring_sqe sqe;
+    memset(&sqe, 0, sizeof sqe);
+    sqe.opcode = opcode;
+    sqe.fd = fd;
+    return sqe;
+}
+
+bool wouldBlock(int result) {
+    return result == -EAGAIN || result == -EWOULDBLOCK || result == -EINPROGRESS;
+}
+
+} // namespace
+
+class UringTransport::Operation : public Completion {
+public:
+    Operation(UringTransport& transport, const io_uring_sqe& request, CancellationToken token)
+        : transport(transport), request(request), token(std::move(token)), id(0), result(-ECANCELED) {}
+
+    // A coroutine destroyed mid-operation leaves the completion to be ignored
+    ~Operation() {
+        if (id != 0) {
+            transport.abandon(id);
+        }
+    }
+
+    Operation(const Operation&) = delete;
+    Operation& operator=(const Operation&) = delete;
+
+    bool await_ready() const noexcept { return token.isCancelled(); }
+    void await_suspend(std::coroutine_handle<> handle) {
+        this->handle = handle;
+        id = transport.submit(request, this);
+        // The request may still complete; either way its completion resumes us
+        registration.bind(token, [this]() { transport.cancel(id); });
+    }
+    int await_resume() noexcept { return result; }
+
+    void complete(int result, uint32_t flags) override {
+        (void)flags;
+        id = 0;
+        registration.reset();
+        this->result = result;
+        transport.scheduler.wake(handle);
+    }
+
+private:
+    UringTransport& transport;
+    io_uring_sqe request;
+    CancellationToken token;
+    CancellationRegistration registration;
+    std::coroutine_handle<> handle;
+    uint64_t id;
+    int result;
+};
+
+class UringTransport::ReceiveAwaiter {
+public:
+    ReceiveAwaiter(Stream& stream, CancellationToken token)
+        : stream(stream), token(std::move(token)), cancelled(false) {}
+
+    ~ReceiveAwaiter() {
+        if (stream.waiter == this) {
+            stream.waiter = nullptr;
+        }
+    }
+
+    ReceiveAwaiter(const ReceiveAwaiter&) = delete;
+    ReceiveAwaiter& operator=(const ReceiveAwaiter&) = delete;
+
+    bool await_ready() const noexcept { return token.isCancelled(); }
+    void await_suspend(std::coroutine_handle<> handle) {
+        this->handle = handle;
+        stream.waiter = this;
+        // Only the wait is abandoned: the receive stays armed for the next caller
+        registration.bind(token, [this]() {
+            stream.waiter = nullptr;
+            cancelled = true;
+            stream.transport.scheduler.wake(this->handle);
+        });
+    }
+    bool await_resume() noexcept { return !cancelled && !token.isCancelled(); }
+
+    void wake() {
+        registration.reset();
+        stream.transport.scheduler.wake(handle);
+    }
+
+private:
+    Stream& stream;
+    CancellationToken token;
+    CancellationRegistration registration;
+    std::coroutine_handle<> handle;
+    bool cancelled;
+};
+
+UringTransport::UringTransport(IoScheduler& scheduler)
+    : scheduler(scheduler),
+      ringFd(-1),
+      ring(MAP_FAILED),
+      ringSize(0),
+      sqes(nullptr),
+      sqesSize(0),
+      sqHead(nullptr),
+      sqTail(nullptr),
+      sqFlags(nullptr),
+      sqMask(0),
+      sqEntries(0),
+      queuedTail(0),
+      cqHead(nullptr),
+      cqTail(nullptr),
+      cqMask(0),
+      cqes(nullptr),
+      buffers(nullptr),
+      buffersSize(0),
+      bufferRing(nullptr),
+      bufferRingSize(0),
+      bufferTail(0),
+      multishot(true),
+      nextId(0),
+      outstanding(0) {
+    if (setup()) {
+        scheduler.addPoller(ringFd, *this);
+    } else if (ringFd != -1) {
+        ::close(ringFd);
+        ringFd = -1;
+    }
+}
+
+UringTransport::~UringTransport() {
+    if (ringFd != -1) {
+        scheduler.removePoller(ringFd);
+
+        // The kernel may still write into the receive buffers until every
+        // request has completed, so wait for that before unmapping them
+        io_uring_sqe* sqe = nextSqe();
+        *sqe = blankSqe(IORING_OP_ASYNC_CANCEL, -1);
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_ALL | IORING_ASYNC_CANCEL_ANY;
+        inflight.clear();
+        flush();
+        while (outstanding > 0) {
+            if (enter(0, 1, IORING_ENTER_GETEVENTS) == -1 && errno != EINTR) {
+                break;
+            }
+            reap();
+        }
+        streams.clear();
+        closing.clear();
+        ::close(ringFd);
+    }
+
+    if (bufferRing != nullptr) {
+        munmap(bufferRing, bufferRingSize);
+    }
+    if (buffers != nullptr) {
+        munmap(buffers, buffersSize);
+    }
+    if (sqes != nullptr) {
+        munmap(sqes, sqesSize);
+    }
+    if (ring != MAP_FAILED) {
+        munmap(ring, ringSize);
+    }
+}
+
+Task<int> UringTransport::connect(int sockfd, ResolvedAddress address, CancellationToken token) {
+    io_uring_sqe request = blankSqe(IORING_OP_CONNECT, sockfd);
+    request.addr = reinterpret_cast<uint64_t>(address.sockaddrPtr());
+    request.off = address.length;
+    Operation operation(*this, request, token);
+    int result = co_await operation;
+    if (!wouldBlock(result)) {
+        co_return result;
+    }
+
+    // Kernels that honour O_NONBLOCK for io_uring report EINPROGRESS instead of waiting
+    if (!co_await writable(sockfd, token)) {
+        co_return -ECANCELED;
+    }
+    int error = 0;
+    socklen_t length = sizeof error;
+    if (getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &error, &length) == -1) {
+        co_return -errno;
+    }
+    co_return -error;
+}
+
+Task<ssize_t> UringTransport::send(int sockfd, const iovec* segments, size_t count, CancellationToken token) {
+    msghdr message = {};
+    message.msg_iov = const_cast<iovec*>(segments);
+    message.msg_iovlen = count;
+    io_uring_sqe request = blankSqe(IORING_OP_SENDMSG, sockfd);
+    request.addr = reinterpret_cast<uint64_t>(&message);
+    request.len = 1;
+    request.msg_flags = MSG_NOSIGNAL;
+
+    while (true) {
+        Operation operation(*this, request, token);
+        int result = co_await operation;
+        if (!wouldBlock(result)) {
+            co_return result;
+        }
+        if (!co_await writable(sockfd, token)) {
+            co_return -ECANCELED;
+        }
+    }
+}
+
+Task<bool> UringTransport::writable(int sockfd, CancellationToken token) {
+    co_return co_await pollFor(sockfd, POLLOUT, token);
+}
+
+Task<ssize_t> UringTransport::receive(int sockfd, char* buffer, size_t length, CancellationToken token) {
+    Stream& stream = streamFor(sockfd);
+    while (true) {
+        if (!stream.chunks.empty()) {
+            co_return static_cast<ssize_t>(take(stream, buffer, length));
+        }
+        if (stream.error != 0) {
+            co_return -stream.error;
+        }
+        if (stream.ended) {
+            co_return 0;
+        }
+        if (stream.starved) {
+            // Every provided buffer is taken: read straight into the caller's
+            ssize_t n = recv(sockfd, buffer, length, MSG_DONTWAIT);
+            if (n >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                stream.starved = false;  // arm again next time
+                co_return n >= 0 ? n : -errno;
+            }
+            if (!co_await pollFor(sockfd, POLLIN, token)) {
+                co_return -ECANCELED;
+            }
+            continue;
+        }
+        if (stream.id == 0) {
+            arm(stream);
+        }
+        ReceiveAwaiter wait(stream, token);
+        if (!co_await wait) {
+            co_return -ECANCELED;
+        }
+    }
+}
+
+bool UringTransport::isStale(int sockfd) {
+    reap();
+    auto it = streams.find(sockfd);
+    if (it != streams.end()) {
+        const Stream& stream = *it->second;
+        if (!stream.chunks.empty() || stream.ended || stream.error != 0) {
+            return true;
+        }
+        if (stream.id != 0) {
+            return false;  // the armed receive would have reported anything that arrived
+        }
+    }
+
+    char byte;
+    ssize_t n = recv(sockfd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (n >= 0) {
+        return true;
+    }
+    return errno != EAGAIN && errno != EWOULDBLOCK;
+}
+
+void UringTransport::close(int sockfd) {
+    auto it = streams.find(sockfd);
+    if (it != streams.end()) {
+        std::unique_ptr<Stream> stream = std::move(it->second);
+        streams.erase(it);
+        for (const Chunk& chunk : stream->chunks) {
+            recycle(chunk.bufferId);
+        }
+        stream->chunks.clear();
+        if (stream->id != 0) {
+            // The armed receive holds the socket open until it is cancelled
+            uint64_t id = stream->id;
+            stream->closed = true;
+            cancel(id);
+            closing[id] = std::move(stream);
+        }
+    }
+
+    // Batched with everything else; the descriptor is gone by the next round
+    io_uring_sqe* sqe = nextSqe();
+    *sqe = blankSqe(IORING_OP_CLOSE, sockfd);
+}
+
+// Private helper methods
+bool UringTransport::setup() {
+    io_uring_params params;
+    memset(&params, 0, sizeof params);
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = kCompletionEntries;
+    ringFd = static_cast<int>(syscall(__NR_io_uring_setup, kRingEntries, &params));
+    if (ringFd == -1) {
+        error = std::string("io_uring_setup failed: ") + strerror(errno);
+        return false;
+    }
+    unsigned needed = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_FAST_POLL;
+    if ((params.features & needed) != needed) {
+        error = "io_uring lacks single mmap, no-drop or fast poll support";
+        return false;
+    }
+
+    ringSize = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    ring = mmap(nullptr, ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqeMemory = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+                           IORING_OFF_SQES);
+    if (ring == MAP_FAILED || sqeMemory == MAP_FAILED) {
+        error = std::string("Failed to map the io_uring queues: ") + strerror(errno);
+        return false;
+    }
+    sqes = static_cast<io_uring_sqe*>(sqeMemory);
+
+    char* base = static_cast<char*>(ring);
+    sqHead = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+    sqFlags = reinterpret_cast<unsigned*>(base + params.sq_off.flags);
+    sqMask = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+    sqEntries = params.sq_entries;
+    queuedTail = *sqTail;
+    cqHead = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+    cqMask = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+
+    // SQE slots are used in order, so the indirection array is the identity
+    unsigned* sqArray = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+    for (unsigned i = 0; i < sqEntries; ++i) {
+        sqArray[i] = i;
+    }
+
+    // Every operation used must be known to this kernel
+    std::vector<char> probeMemory(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(probeMemory.data());
+    if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PROBE, probe, 256) == -1) {
+        error = std::string("io_uring probe failed: ") + strerror(errno);
+        return false;
+    }
+    const uint8_t opcodes[] = {IORING_OP_CONNECT,  IORING_OP_SENDMSG,      IORING_OP_RECV,
+                               IORING_OP_POLL_ADD, IORING_OP_ASYNC_CANCEL, IORING_OP_CLOSE};
+    for (uint8_t opcode : opcodes) {
+        if (opcode > probe->last_op || !(probe->ops[opcode].flags & IO_URING_OP_SUPPORTED)) {
+            error = "io_uring lacks operation " + std::to_string(opcode);
+            return false;
+        }
+    }
+
+    buffersSize = kBufferCount * kBufferSize;
+    bufferRingSize = kBufferCount * sizeof(io_uring_buf);
+    void* bufferMemory = mmap(nullptr, buffersSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    void* bufferRingMemory = mmap(nullptr, bufferRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    buffers = bufferMemory == MAP_FAILED ? nullptr : static_cast<char*>(bufferMemory);
+    bufferRing = bufferRingMemory == MAP_FAILED ? nullptr : static_cast<io_uring_buf*>(bufferRingMemory);
+    if (buffers == nullptr || bufferRing == nullptr) {
+        error = "Failed to allocate io_uring receive buffers";
+        return false;
+    }
+
+    io_uring_buf_reg registration;
+    memset(&registration, 0, sizeof registration);
+    registration.ring_addr = reinterpret_cast<uint64_t>(bufferRing);
+    registration.ring_entries = kBufferCount;
+    registration.bgid = kBufferGroup;
+    if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PBUF_RING, &registration, 1) == -1) {
+        error = std::string("Failed to register io_uring receive buffers: ") + strerror(errno);
+        return false;
+    }
+    for (unsigned i = 0; i < kBufferCount; ++i) {
+        recycle(static_cast<uint16_t>(i));
+    }
+    return true;
+}
+
+void UringTransport::flush() {
+    storeRelease(sqTail, queuedTail);
+    while (true) {
+        unsigned pending = queuedTail - loadAcquire(sqHead);
+        if (pending == 0) {
+            return;
+        }
+        if (enter(pending, 0, 0) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EBUSY || errno == EAGAIN) {
+                // Completions the kernel is holding back must be reaped first
+                reap();
+                if (enter(pending, 0, 0) != -1) {
+                    continue;
+                }
+            }
+            return;
+        }
+    }
+}
+
+void UringTransport::poll() {
+    reap();
+}
+
+Task<bool> UringTransport::pollFor(int sockfd, uint32_t events, CancellationToken token) {
+    io_uring_sqe request = blankSqe(IORING_OP_POLL_ADD, sockfd);
+    request.poll32_events = events;
+    Operation operation(*this, request, token);
+    int result = co_await operation;
+    co_return result >= 0;
+}
+
+io_uring_sqe* UringTransport::nextSqe() {
+    if (queuedTail - loadAcquire(sqHead) >= sqEntries) {
+        flush();
+    }
+    io_uring_sqe* sqe = &sqes[queuedTail & sqMask];
+    ++queuedTail;
+    return sqe;
+}
+
+uint64_t UringTransport::submit(const io_uring_sqe& request, Completion* completion) {
+    uint64_t id = ++nextId;
+    io_uring_sqe* sqe = nextSqe();
+    *sqe = request;
+    sqe->user_data = id;
+    inflight[id] = completion;
+    ++outstanding;
+    ++stats.operations;
+    return id;
+}
+
+void UringTransport::cancel(uint64_t id) {
+    io_uring_sqe* sqe = nextSqe();
+    *sqe = blankSqe(IORING_OP_ASYNC_CANCEL, -1);
+    sqe->addr = id;
+}
+
+void UringTransport::abandon(uint64_t id) {
+    if (inflight.erase(id) != 0) {
+        cancel(id);
+    }
+}
+
+int UringTransport::enter(unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    ++stats.enters;
+    return static_cast<int>(syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+void UringTransport::reap() {
+    while (true) {
+        unsigned head = *cqHead;
+        unsigned tail = loadAcquire(cqTail);
+        while (head != tail) {
+            io_uring_cqe cqe = cqes[head & cqMask];
+            ++head;
+            storeRelease(cqHead, head);
+            if (cqe.user_data == 0) {
+                continue;  // cancel and close requests
+            }
+            ++stats.completions;
+
+            bool last = !(cqe.flags & IORING_CQE_F_MORE);
+            auto it = inflight.find(cqe.user_data);
+            Completion* completion = it == inflight.end() ? nullptr : it->second;
+            if (last) {
+                if (it != inflight.end()) {
+                    inflight.erase(it);
+                }
+                --outstanding;
+            }
+            if (completion != nullptr) {
+                completion->complete(cqe.res, cqe.flags);
+            } else if (cqe.flags & IORING_CQE_F_BUFFER) {
+                recycle(static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+            }
+        }
+
+        // Completions that did not fit are flushed into the queue on request
+        if (!(loadAcquire(sqFlags) & IORING_SQ_CQ_OVERFLOW)) {
+            return;
+        }
+        if (enter(0, 0, IORING_ENTER_GETEVENTS) == -1 && errno != EINTR) {
+            return;
+        }
+    }
+}
+
+UringTransport::Stream& UringTransport::streamFor(int sockfd) {
+    std::unique_ptr<Stream>& stream = streams[sockfd];
+    if (!stream) {
+        stream = std::make_unique<Stream>(*this, sockfd);
+    }
+    return *stream;
+}
+
+void UringTransport::arm(Stream& stream) {
+    io_uring_sqe request = blankSqe(IORING_OP_RECV, stream.sockfd);
+    request.flags = IOSQE_BUFFER_SELECT;
+    request.buf_group = kBufferGroup;
+    request.ioprio = multishot ? IORING_RECV_MULTISHOT : 0;
+    stream.id = submit(request, &stream);
+}
+
+void UringTransport::onReceive(Stream& stream, int result, uint32_t flags) {
+    bool last = !(flags & IORING_CQE_F_MORE);
+    uint64_t id = stream.id;
+    if (last) {
+        stream.id = 0;
+    }
+
+    if (flags & IORING_CQE_F_BUFFER) {
+        uint16_t bufferId = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+        if (result > 0 && !stream.closed) {
+            stream.chunks.push_back(Chunk{bufferId, static_cast<uint32_t>(result), 0});
+        } else {
+            recycle(bufferId);
+        }
+    }
+    if (result == 0) {
+        stream.ended = true;
+    } else if (result == -EINVAL && multishot) {
+        multishot = false;  // kernel before 6.0: receive again one read at a time
+    } else if (result == -ENOBUFS) {
+        stream.starved = true;
+    } else if (result < 0 && result != -ECANCELED && !wouldBlock(result)) {
+        stream.error = -result;
+    }
+
+    if (stream.closed) {
+        if (last) {
+            closing.erase(id);  // destroys the stream
+        }
+        return;
+    }
+    if (stream.waiter != nullptr) {
+        ReceiveAwaiter* waiter = stream.waiter;
+        stream.waiter = nullptr;
+        waiter->wake();
+    }
+}
+
+size_t UringTransport::take(Stream& stream, char* buffer, size_t length) {
+    size_t copied = 0;
+    while (copied < length && !stream.chunks.empty()) {
+        Chunk& chunk = stream.chunks.front();
+        size_t count = std::min<size_t>(length - copied, chunk.length - chunk.offset);
+        memcpy(buffer + copied, buffers + chunk.bufferId * kBufferSize + chunk.offset, count);
+        copied += count;
+        chunk.offset += static_cast<uint32_t>(count);
+        if (chunk.offset == chunk.length) {
+            recycle(chunk.bufferId);
+            stream.chunks.pop_front();
+        }
+    }
+    return copied;
+}
+
+void UringTransport::recycle(uint16_t bufferId) {
+    // Not io_uring_buf_ring::bufs: in C++ its empty placeholder member shifts
+    // the array by 8 bytes. The ring is a plain array whose tail overlays
+    // the first entry's resv field.
+    io_uring_buf& entry = bufferRing[bufferTail & (kBufferCount - 1)];
+    entry.addr = reinterpret_cast<uint64_t>(buffers + bufferId * kBufferSize);
+    entry.len = static_cast<uint32_t>(kBufferSize);
+    entry.bid = bufferId;
+    ++bufferTail;
+    std::atomic_ref<uint16_t>(bufferRing[0].resv).store(bufferTail, std::memory_order_release);
+}
@@ -0,0 +1,23 @@
+#include "request/body_sink.h"
+#include <cerrno>
+#include <unistd.h>
+
+bool StreamBodySink::write(const char* data, size_t length) {
+    stream.write(data, static_cast<std::streamsize>(length));
+    return static_cast<bool>(stream);
+}
+
+bool FdBodySink::write(const char* data, size_t length) {
+    size_t total = 0;
+    while (total < length) {
+        ssize_t n = ::write(fd, data + total, length - total);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        total += static_cast<size_t>(n);
+    }
+    return true;
+}
@@ -0,0 +1,206 @@
+#include "request/chunked_decoder.h"
+#include "request/http_scan.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const size_t kMaxSizeLineBytes = 4096;
+const size_t kMaxTrailerBytes = 64 * 1024;
+const size_t kMaxSizeDigits = 15;  // keeps chunk sizes below 2^60
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+} // namespace
+
+ChunkedDecoder::ChunkedDecoder() {
+    reset();
+}
+
+void ChunkedDecoder::reset() {
+    state = State::Size;
+    chunkSize = 0;
+    remaining = 0;
+    payloadBytes = 0;
+    sizeDigits = 0;
+    lineBytes = 0;
+    trailerLine.clear();
+    trailers.clear();
+    error.clear();
+}
+
+size_t ChunkedDecoder::decode(const char* data, size_t length, std::vector<iovec>& payload) {
+    size_t pos = 0;
+    while (pos < length) {
+        switch (state) {
+            case State::Size: {
+                int value = hexValue(data[pos]);
+                if (value >= 0) {
+                    if (++sizeDigits > kMaxSizeDigits) {
+                        fail("Chunk size too large");
+                        return pos;
+                    }
+                    chunkSize = (chunkSize << 4) | static_cast<uint64_t>(value);
+                    ++pos;
+                    ++lineBytes;
+                    break;
+                }
+                char c = data[pos];
+                if (sizeDigits == 0 || (c != ';' && c != ' ' && c != '\t' && c != '\r' && c != '\n')) {
+                    fail("Invalid chunk size line");
+                    return pos;
+                }
+                state = State::Extension;
+                break;
+            }
+
+            case State::Extension: {
+                // Extensions carry nothing we use; skip to the end of the line
+                size_t lineEnd = scanForByte(data + pos, length - pos, '\n');
+                size_t skipped = lineEnd == std::string::npos ? length - pos : lineEnd + 1;
+                lineBytes += skipped;
+                pos += skipped;
+                if (lineBytes > kMaxSizeLineBytes) {
+                    fail("Chunk size line too long");
+                    return pos;
+                }
+                if (lineEnd == std::string::npos) {
+                    break;
+                }
+                remaining = chunkSize;
+                state = chunkSize == 0 ? State::Trailers : State::Data;
+                lineBytes = 0;
+                break;
+            }
+
+            case State::Data: {
+                size_t take = static_cast<size_t>(std::min<uint64_t>(remaining, length - pos));
+                iovec slice;
+                slice.iov_base = const_cast<char*>(data + pos);
+                slice.iov_len = take;
+                payload.push_back(slice);
+                pos += take;
+                remaining -= take;
+                payloadBytes += take;
+                if (remaining == 0) {
+                    state = State::DataCr;
+                }
+                break;
+            }
+
+            case State::DataCr:
+                if (data[pos] == '\r') {
+                    state = State::DataLf;
+                } else if (data[pos] == '\n') {
+                    chunkSize = 0;
+                    sizeDigits = 0;
+                    state = State::Size;
+                } else {
+                    fail("Missing CRLF after chunk data");
+                    return pos;
+                }
+                ++pos;
+                break;
+
+            case State::DataLf:
+                if (data[pos] != '\n') {
+                    fail("Missing CRLF after chunk data");
+                    return pos;
+                }
+                ++pos;
+                chunkSize = 0;
+                sizeDigits = 0;
+                state = State::Size;
+                break;
+
+            case State::Trailers: {
+                size_t lineEnd = scanForByte(data + pos, length - pos, '\n');
+                size_t take = lineEnd == std::string::npos ? length - pos : lineEnd;
+                lineBytes += take + 1;
+                if (lineBytes > kMaxTrailerBytes) {
+                    fail("Trailer section too large");
+                    return pos;
+                }
+                trailerLine.append(data + pos, take);
+                if (lineEnd == std::string::npos) {
+                    return length;
+                }
+                pos += take + 1;
+                if (!finishTrailerLine()) {
+                    return pos;
+                }
+                break;
+            }
+
+            case State::Complete:
+            case State::Error:
+                return pos;
+        }
+    }
+    return pos;
+}
+
+size_t ChunkedDecoder::decodeInPlace(char* data, size_t length, size_t& payloadLength) {
+    scratch.clear();
+    size_t used = decode(data, length, scratch);
+
+    // Each slice starts at or after the write position, so memmove is safe
+    payloadLength = 0;
+    for (const iovec& slice : scratch) {
+        if (static_cast<char*>(slice.iov_base) != data + payloadLength) {
+            memmove(data + payloadLength, slice.iov_base, slice.iov_len);
+        }
+        payloadLength += slice.iov_len;
+    }
+    return used;
+}
+
+bool ChunkedDecoder::decodeBody(std::string& body, std::string* error) {
+    ChunkedDecoder decoder;
+    size_t payloadLength = 0;
+    decoder.decodeInPlace(&body[0], body.length(), payloadLength);
+    body.resize(payloadLength);
+
+    if (decoder.hasError()) {
+        if (error != nullptr) {
+            *error = decoder.getError();
+        }
+        return false;
+    }
+    return true;
+}
+
+// Private helper methods
+bool ChunkedDecoder::finishTrailerLine() {
+    if (!trailerLine.empty() && trailerLine.back() == '\r') {
+        trailerLine.pop_back();
+    }
+    if (trailerLine.empty()) {
+        state = State::Complete;
+        return true;
+    }
+
+    size_t colon = scanForByte(trailerLine.data(), trailerLine.length(), ':');
+    if (colon == std::string::npos || colon == 0) {
+        fail("Invalid trailer field");
+        return false;
+    }
+    size_t valueStart = trailerLine.find_first_not_of(" \t", colon + 1);
+    size_t valueEnd = trailerLine.find_last_not_of(" \t");
+    std::string value = valueStart == std::string::npos
+                            ? ""
+                            : trailerLine.substr(valueStart, valueEnd - valueStart + 1);
+    trailers.emplace_back(trailerLine.substr(0, colon), value);
+    trailerLine.clear();
+    return true;
+}
+
+void ChunkedDecoder::fail(const std::string& reason) {
+    state = State::Error;
+    error = reason;
+}
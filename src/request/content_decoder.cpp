@@ -0,0 +1,201 @@
+#include "request/content_decoder.h"
+#include "request/http_scan.h"
+#include <cstring>
+#include <zlib.h>
+
+namespace {
+
+const size_t kOutputChunk = 16 * 1024;
+
+std::string_view trim(std::string_view value) {
+    size_t start = value.find_first_not_of(" \t");
+    if (start == std::string_view::npos) {
+        return std::string_view();
+    }
+    size_t end = value.find_last_not_of(" \t");
+    return value.substr(start, end - start + 1);
+}
+
+} // namespace
+
+struct ContentDecoder::Stream {
+    z_stream z;
+
+    Stream() { memset(&z, 0, sizeof z); }
+    ~Stream() { inflateEnd(&z); }
+};
+
+ContentDecoder::Encoding ContentDecoder::parseEncoding(std::string_view value) {
+    // Identity entries are no-ops; more than one real coding is not supported
+    Encoding result = Encoding::Identity;
+    while (!value.empty()) {
+        size_t comma = scanForByte(value.data(), value.length(), ',');
+        std::string_view coding = trim(value.substr(0, comma));
+        value = comma == std::string_view::npos ? std::string_view() : value.substr(comma + 1);
+
+        Encoding next;
+        if (coding.empty() || equalsIgnoreCaseAscii(coding, "identity")) {
+            continue;
+        } else if (equalsIgnoreCaseAscii(coding, "gzip") || equalsIgnoreCaseAscii(coding, "x-gzip")) {
+            next = Encoding::Gzip;
+        } else if (equalsIgnoreCaseAscii(coding, "deflate")) {
+            next = Encoding::Deflate;
+        } else {
+            return Encoding::Unsupported;
+        }
+
+        if (result != Encoding::Identity) {
+            return Encoding::Unsupported;
+        }
+        result = next;
+    }
+    return result;
+}
+
+ContentDecoder::ContentDecoder(Encoding encoding)
+    : encoding(encoding), streamEnded(false), compressedBytes(0), decodedBytes(0) {
+    if (encoding == Encoding::Gzip) {
+        start(false);
+    } else if (encoding == Encoding::Unsupported) {
+        error = "Unsupported content encoding";
+    }
+}
+
+ContentDecoder::~ContentDecoder() = default;
+
+bool ContentDecoder::decode(const char* data, size_t length, const Output& output) {
+    if (hasError()) {
+        return false;
+    }
+    compressedBytes += length;
+
+    if (encoding == Encoding::Identity) {
+        decodedBytes += length;
+        if (length > 0 && !output(data, length)) {
+            error = "Decoded body rejected";
+            return false;
+        }
+        return true;
+    }
+
+    if (!stream) {
+        // Deflate: the first two bytes tell a zlib header from a raw stream
+        size_t take = std::min(length, 2 - header.length());
+        header.append(data, take);
+        data += take;
+        length -= take;
+        if (header.length() < 2) {
+            return true;
+        }
+
+        unsigned char cmf = static_cast<unsigned char>(header[0]);
+        unsigned char flg = static_cast<unsigned char>(header[1]);
+        bool zlibWrapped = (cmf & 0x0F) == Z_DEFLATED && ((cmf << 8) | flg) % 31 == 0;
+        if (!start(!zlibWrapped) || !inflateInput(header.data(), header.length(), output)) {
+            return false;
+        }
+    }
+    return inflateInput(data, length, output);
+}
+
+bool ContentDecoder::finish() {
+    if (hasError()) {
+        return false;
+    }
+    if (encoding == Encoding::Identity) {
+        return true;
+    }
+    if (!stream) {
+        if (header.empty()) {
+            return true;  // empty body
+        }
+        error = "Compressed body truncated";
+        return false;
+    }
+    if (!streamEnded) {
+        error = "Compressed body truncated";
+        return false;
+    }
+    return true;
+}
+
+bool ContentDecoder::decodeBody(std::string& body, Encoding encoding, std::string* error) {
+    ContentDecoder decoder(encoding);
+    std::string decoded;
+    decoded.reserve(body.length() * 4);
+
+    bool ok = decoder.decode(body.data(), body.length(), [&decoded](const char* data, size_t length) {
+        decoded.append(data, length);
+        return true;
+    }) && decoder.finish();
+
+    if (!ok) {
+        if (error != nullptr) {
+            *error = decoder.getError();
+        }
+        return false;
+    }
+    body.swap(decoded);
+    return true;
+}
+
+// Private helper methods
+bool ContentDecoder::start(bool rawDeflate) {
+    stream.reset(new Stream());
+    int windowBits = rawDeflate ? -MAX_WBITS : encoding == Encoding::Gzip ? MAX_WBITS + 16 : MAX_WBITS;
+    if (inflateInit2(&stream->z, windowBits) != Z_OK) {
+        error = "Failed to initialize zlib";
+        return false;
+    }
+    return true;
+}
+
+bool ContentDecoder::inflateInput(const char* data, size_t length, const Output& output) {
+    z_stream& z = stream->z;
+    z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    z.avail_in = static_cast<uInt>(length);
+
+    char buffer[kOutputChunk];
+    while (true) {
+        if (streamEnded) {
+            if (z.avail_in == 0 || encoding != Encoding::Gzip) {
+                return true;  // anything after a deflate stream is ignored
+            }
+            // Another gzip member follows
+            inflateReset(&z);
+            streamEnded = false;
+        }
+
+        z.next_out = reinterpret_cast<Bytef*>(buffer);
+        z.avail_out = sizeof buffer;
+        int result = inflate(&z, Z_NO_FLUSH);
+        if (result == Z_STREAM_END) {
+            streamEnded = true;
+        } else if (result != Z_OK && result != Z_BUF_ERROR) {
+            error = z.msg != nullptr ? z.msg : "Corrupt compressed body";
+            return false;
+        }
+
+        size_t produced = sizeof buffer - z.avail_out;
+        if (produced > 0) {
+            decodedBytes += produced;
+            if (!output(buffer, produced)) {
+                error = "Decoded body rejected";
+                return false;
+            }
+        }
+
+        if (!streamEnded && z.avail_in == 0 && z.avail_out != 0) {
+            return true;  // need more input
+        }
+        if (!streamEnded && produced == 0) {
+            return true;  // no progress possible until more input arrives
+        }
+    }
+}
+
+bool DecodingBodySink::write(const char* data, size_t length) {
+    return decoder.decode(data, length, [this](const char* decoded, size_t decodedLength) {
+        return downstream.write(decoded, decodedLength);
+    });
+}
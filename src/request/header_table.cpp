@@ -0,0 +1,190 @@
+#include "request/header_table.h"
+#include "request/http_scan.h"
+#include <algorithm>
+
+namespace {
+
+// Indexed by KnownHeader
+const std::string_view kNames[] = {
+    "content-length", "content-type", "content-encoding", "content-range", "transfer-encoding",
+    "connection", "keep-alive", "location", "set-cookie", "date", "server", "cache-control",
+    "etag", "last-modified", "expires", "age", "vary", "retry-after", "trailer", "upgrade",
+    "accept-ranges", "www-authenticate"
+};
+
+static_assert(sizeof(kNames) / sizeof(kNames[0]) == static_cast<size_t>(KnownHeader::Unknown),
+              "every known header needs a name");
+
+inline bool is(std::string_view name, KnownHeader id) {
+    return equalsIgnoreCaseAscii(name, kNames[static_cast<size_t>(id)]);
+}
+
+inline char lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+// Compare a field against a lookup: known names by id, others by name
+inline bool matches(const HeaderTable::Field& field, KnownHeader id, std::string_view name) {
+    if (id != KnownHeader::Unknown) {
+        return field.id == id;
+    }
+    return field.id == KnownHeader::Unknown && equalsIgnoreCaseAscii(field.name, name);
+}
+
+} // namespace
+
+HeaderTable::HeaderTable() {
+    std::fill(slots, slots + kKnownCount, 0);
+}
+
+KnownHeader HeaderTable::classify(std::string_view name) {
+    if (name.empty()) {
+        return KnownHeader::Unknown;
+    }
+
+    // At most two full comparisons: the length and first letter narrow it down
+    KnownHeader candidate = KnownHeader::Unknown;
+    KnownHeader alternate = KnownHeader::Unknown;
+    char first = lower(name[0]);
+    switch (name.length()) {
+        case 3:
+            candidate = KnownHeader::Age;
+            break;
+        case 4:
+            candidate = first == 'd' ? KnownHeader::Date : first == 'e' ? KnownHeader::ETag : KnownHeader::Vary;
+            break;
+        case 6:
+            candidate = KnownHeader::Server;
+            break;
+        case 7:
+            candidate = first == 'e' ? KnownHeader::Expires : first == 't' ? KnownHeader::Trailer : KnownHeader::Upgrade;
+            break;
+        case 8:
+            candidate = KnownHeader::Location;
+            break;
+        case 10:
+            candidate = first == 'c' ? KnownHeader::Connection : first == 'k' ? KnownHeader::KeepAlive : KnownHeader::SetCookie;
+            break;
+        case 11:
+            candidate = KnownHeader::RetryAfter;
+            break;
+        case 12:
+            candidate = KnownHeader::ContentType;
+            break;
+        case 13:
+            if (first == 'c') {
+                candidate = KnownHeader::ContentRange;
+                alternate = KnownHeader::CacheControl;
+            } else {
+                candidate = first == 'l' ? KnownHeader::LastModified : KnownHeader::AcceptRanges;
+            }
+            break;
+        case 14:
+            candidate = KnownHeader::ContentLength;
+            break;
+        case 16:
+            candidate = first == 'c' ? KnownHeader::ContentEncoding : KnownHeader::WwwAuthenticate;
+            break;
+        case 17:
+            candidate = KnownHeader::TransferEncoding;
+            break;
+        default:
+            return KnownHeader::Unknown;
+    }
+
+    if (is(name, candidate)) {
+        return candidate;
+    }
+    if (alternate != KnownHeader::Unknown && is(name, alternate)) {
+        return alternate;
+    }
+    return KnownHeader::Unknown;
+}
+
+std::string_view HeaderTable::nameOf(KnownHeader id) {
+    return id == KnownHeader::Unknown ? std::string_view() : kNames[static_cast<size_t>(id)];
+}
+
+void HeaderTable::add(std::string_view name, std::string_view value) {
+    KnownHeader id = classify(name);
+    fields.push_back(Field{std::string(name), std::string(value), id});
+
+    if (id != KnownHeader::Unknown) {
+        uint16_t& slot = slots[static_cast<size_t>(id)];
+        if (slot == 0 && fields.size() <= UINT16_MAX) {
+            slot = static_cast<uint16_t>(fields.size());
+        }
+    }
+}
+
+void HeaderTable::set(std::string_view name, std::string_view value) {
+    erase(name);
+    add(name, value);
+}
+
+size_t HeaderTable::erase(std::string_view name) {
+    KnownHeader id = classify(name);
+    size_t before = fields.size();
+    fields.erase(std::remove_if(fields.begin(), fields.end(),
+                                [&](const Field& field) { return matches(field, id, name); }),
+                 fields.end());
+    size_t removed = before - fields.size();
+    if (removed > 0) {
+        reindex();
+    }
+    return removed;
+}
+
+const std::string* HeaderTable::get(KnownHeader id) const {
+    if (id == KnownHeader::Unknown) {
+        return nullptr;
+    }
+    uint16_t slot = slots[static_cast<size_t>(id)];
+    return slot == 0 ? nullptr : &fields[slot - 1].value;
+}
+
+const std::string* HeaderTable::get(std::string_view name) const {
+    KnownHeader id = classify(name);
+    if (id != KnownHeader::Unknown) {
+        return get(id);
+    }
+    for (const Field& field : fields) {
+        if (matches(field, id, name)) {
+            return &field.value;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<std::string_view> HeaderTable::getAll(std::string_view name) const {
+    KnownHeader id = classify(name);
+    std::vector<std::string_view> values;
+    for (const Field& field : fields) {
+        if (matches(field, id, name)) {
+            values.push_back(field.value);
+        }
+    }
+    return values;
+}
+
+size_t HeaderTable::count(std::string_view name) const {
+    KnownHeader id = classify(name);
+    return static_cast<size_t>(std::count_if(fields.begin(), fields.end(),
+                                             [&](const Field& field) { return matches(field, id, name); }));
+}
+
+void HeaderTable::clear() {
+    fields.clear();
+    std::fill(slots, slots + kKnownCount, 0);
+}
+
+// Private helper methods
+void HeaderTable::reindex() {
+    std::fill(slots, slots + kKnownCount, 0);
+    for (size_t i = 0; i < fields.size() && i < UINT16_MAX; ++i) {
+        KnownHeader id = fields[i].id;
+        if (id != KnownHeader::Unknown && slots[static_cast<size_t>(id)] == 0) {
+            slots[static_cast<size_t>(id)] = static_cast<uint16_t>(i + 1);
+        }
+    }
+}
@@ -0,0 +1,281 @@
+#include "request/http_scan.h"
+#include <charconv>
+
+#if defined(__x86_64__)
+#define HTTP_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const size_t npos = std::string_view::npos;
+
+inline char lowerAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + 32) : c;
+}
+
+// Scalar kernels (also used for the tails of the vector kernels)
+size_t scalarFindByte(const char* data, size_t length, char c) {
+    for (size_t i = 0; i < length; ++i) {
+        if (data[i] == c) {
+            return i;
+        }
+    }
+    return npos;
+}
+
+size_t scalarFindCrlf(const char* data, size_t length, size_t from) {
+    for (size_t i = from; i + 1 < length; ++i) {
+        if (data[i] == '\r' && data[i + 1] == '\n') {
+            return i;
+        }
+    }
+    return npos;
+}
+
+size_t scalarFindHeaderEnd(const char* data, size_t length, size_t from) {
+    for (size_t i = from; i + 3 < length; ++i) {
+        if (data[i] == '\r' && data[i + 1] == '\n' && data[i + 2] == '\r' && data[i + 3] == '\n') {
+            return i;
+        }
+    }
+    return npos;
+}
+
+size_t scalarCrlf(const char* data, size_t length) {
+    return scalarFindCrlf(data, length, 0);
+}
+
+size_t scalarHeaderEnd(const char* data, size_t length) {
+    return scalarFindHeaderEnd(data, length, 0);
+}
+
+#ifdef HTTP_SCAN_X86
+
+// SSE2 kernels, 16 bytes per step (baseline on x86-64)
+size_t sse2FindByte(const char* data, size_t length, char c) {
+    const __m128i needle = _mm_set1_epi8(c);
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    size_t tail = scalarFindByte(data + i, length - i, c);
+    return tail == npos ? npos : i + tail;
+}
+
+size_t sse2FindCrlf(const char* data, size_t length) {
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    size_t i = 0;
+    for (; i + 17 <= length; i += 16) {
+        __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 1));
+        int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, cr), _mm_cmpeq_epi8(second, lf)));
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return scalarFindCrlf(data, length, i);
+}
+
+size_t sse2FindHeaderEnd(const char* data, size_t length) {
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    size_t i = 0;
+    for (; i + 19 <= length; i += 16) {
+        const __m128i* p = reinterpret_cast<const __m128i*>(data + i);
+        __m128i m = _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128(p), cr),
+                                  _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 1)), lf));
+        m = _mm_and_si128(m, _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 2)), cr));
+        m = _mm_and_si128(m, _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 3)), lf));
+        int mask = _mm_movemask_epi8(m);
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return scalarFindHeaderEnd(data, length, i);
+}
+
+// AVX2 kernels, 32 bytes per step
+__attribute__((target("avx2")))
+size_t avx2FindByte(const char* data, size_t length, char c) {
+    const __m256i needle = _mm256_set1_epi8(c);
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    size_t tail = sse2FindByte(data + i, length - i, c);
+    return tail == npos ? npos : i + tail;
+}
+
+__attribute__((target("avx2")))
+size_t avx2FindCrlf(const char* data, size_t length) {
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    size_t i = 0;
+    for (; i + 33 <= length; i += 32) {
+        __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 1));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(first, cr), _mm256_cmpeq_epi8(second, lf))));
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return scalarFindCrlf(data, length, i);
+}
+
+__attribute__((target("avx2")))
+size_t avx2FindHeaderEnd(const char* data, size_t length) {
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    size_t i = 0;
+    for (; i + 35 <= length; i += 32) {
+        __m256i m = _mm256_and_si256(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)), cr),
+            _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 1)), lf));
+        m = _mm256_and_si256(m, _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 2)), cr));
+        m = _mm256_and_si256(m, _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 3)), lf));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(m));
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return scalarFindHeaderEnd(data, length, i);
+}
+
+#endif // HTTP_SCAN_X86
+
+struct ScanKernels {
+    const char* name;
+    size_t (*findByte)(const char*, size_t, char);
+    size_t (*findCrlf)(const char*, size_t);
+    size_t (*findHeaderEnd)(const char*, size_t);
+};
+
+ScanKernels selectKernels() {
+#ifdef HTTP_SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return ScanKernels{"avx2", avx2FindByte, avx2FindCrlf, avx2FindHeaderEnd};
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return ScanKernels{"sse2", sse2FindByte, sse2FindCrlf, sse2FindHeaderEnd};
+    }
+#endif
+    return ScanKernels{"scalar", scalarFindByte, scalarCrlf, scalarHeaderEnd};
+}
+
+const ScanKernels& kernels() {
+    static const ScanKernels selected = selectKernels();
+    return selected;
+}
+
+} // namespace
+
+size_t scanForByte(const char* data, size_t length, char c) {
+    return kernels().findByte(data, length, c);
+}
+
+size_t scanForCrlf(const char* data, size_t length) {
+    return kernels().findCrlf(data, length);
+}
+
+size_t scanForHeaderEnd(const char* data, size_t length) {
+    return kernels().findHeaderEnd(data, length);
+}
+
+bool equalsIgnoreCaseAscii(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (lowerAscii(a[i]) != lowerAscii(b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t findIgnoreCaseAscii(std::string_view haystack, std::string_view needle) {
+    if (needle.empty()) {
+        return 0;
+    }
+    if (needle.size() > haystack.size()) {
+        return npos;
+    }
+
+    char first = needle[0];
+    char firstUpper = (first >= 'a' && first <= 'z') ? static_cast<char>(first - 32) : first;
+    size_t last = haystack.size() - needle.size();
+    size_t pos = 0;
+
+    while (pos <= last) {
+        // Jump between candidate first bytes with the vector kernel
+        size_t lower = scanForByte(haystack.data() + pos, last - pos + 1, first);
+        size_t upperLimit = lower == npos ? last - pos + 1 : lower;
+        size_t upper = firstUpper == first ? npos : scanForByte(haystack.data() + pos, upperLimit, firstUpper);
+        size_t next = lower < upper ? lower : upper;
+        if (next == npos) {
+            return npos;
+        }
+        pos += next;
+        if (equalsIgnoreCaseAscii(haystack.substr(pos, needle.size()), needle)) {
+            return pos;
+        }
+        ++pos;
+    }
+    return npos;
+}
+
+std::string_view lastListEntry(std::string_view value) {
+    while (!value.empty()) {
+        size_t comma = value.rfind(',');
+        std::string_view entry = comma == std::string_view::npos ? value : value.substr(comma + 1);
+        size_t start = entry.find_first_not_of(" \t");
+        if (start != std::string_view::npos) {
+            size_t last = entry.find_last_not_of(" \t");
+            return entry.substr(start, last - start + 1);
+        }
+        value = comma == std::string_view::npos ? std::string_view() : value.substr(0, comma);
+    }
+    return std::string_view();
+}
+
+bool splitStatusLine(std::string_view line, std::string_view& version, int& statusCode, std::string_view& reason) {
+    size_t versionEnd = scanForByte(line.data(), line.length(), ' ');
+    if (versionEnd == 0 || versionEnd == npos) {
+        return false;
+    }
+    size_t codeStart = line.find_first_not_of(' ', versionEnd);
+    if (codeStart == npos) {
+        return false;
+    }
+    const char* end = line.data() + line.length();
+    int code = 0;
+    std::from_chars_result parsed = std::from_chars(line.data() + codeStart, end, code);
+    if (parsed.ec != std::errc() || (parsed.ptr != end && *parsed.ptr != ' ')) {
+        return false;
+    }
+
+    version = line.substr(0, versionEnd);
+    statusCode = code;
+    size_t reasonStart = line.find_first_not_of(' ', static_cast<size_t>(parsed.ptr - line.data()));
+    reason = reasonStart == npos ? std::string_view() : line.substr(reasonStart);
+    while (!reason.empty() && (reason.back() == ' ' || reason.back() == '\t')) {
+        reason.remove_suffix(1);
+    }
+    return true;
+}
+
+const char* scanKernelName() {
+    return kernels().name;
+}
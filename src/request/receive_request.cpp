@@ -4,40 +4,31 @@
 #include <sys/socket.h> // For socket functions
 #include <netdb.h>      // For getaddrinfo
 #include <unistd.h>     // For close
-#include <sstream>      // For stringstream
 #include <map>          // For headers storage
+#include "request/http_scan.h"
+#include "request/receive_request.h"
+#include "request/response_reader.h"
                         //
                         //
 using std::string;
 
 
 
-struct HttpResponse {
-    std::string httpVersion;
-    int statusCode;
-    std::string reasonPhrase;
-    std::map<std::string, std::string> headers;
-    std::string body;
-};
-
 // New function to receive the complete HTTP response
 std::string receiveHttpResponse(int sockfd) {
-    std::string response;
-    char buffer[4096];
-    int bytesReceived;
-    
-    // Keep receiving until the server closes the connection
-    while ((bytesReceived = recv(sockfd, buffer, sizeof(buffer) - 1, 0)) > 0) {
-        buffer[bytesReceived] = '\0';  // Null-terminate the buffer
-        response += buffer;
-    }
+    ResponseReader reader;
     
-    if (bytesReceived == -1) {
-        std::cerr << "Error receiving response: " << strerror(errno) << std::endl;
+    // Read until the response framing says the message is complete
+    if (!readHttpResponse(sockfd, reader)) {
+        if (reader.hasError()) {
+            std::cerr << "Error receiving response: " << reader.getError() << std::endl;
+        } else {
+            std::cerr << "Error receiving response: " << strerror(errno) << std::endl;
+        }
         return "";
     }
     
-    return response;
+    return reader.takeMessage();
 }
 
 // New function to parse the HTTP response
@@ -45,46 +36,47 @@ HttpResponse parseHttpResponse(const std::string& rawResponse) {
     HttpResponse response;
     
     // Find the position where headers end (first occurrence of \r\n\r\n)
-    size_t headerEndPos = rawResponse.find("\r\n\r\n");
+    size_t headerEndPos = scanForHeaderEnd(rawResponse.data(), rawResponse.length());
     if (headerEndPos == std::string::npos) {
         std::cerr << "Invalid HTTP response format" << std::endl;
+        response.errorKind = HttpError::Protocol;
+        response.errorMessage = "Invalid HTTP response format";
         return response;
     }
     
     // Split headers and body
-    std::string headerSection = rawResponse.substr(0, headerEndPos);
+    std::string_view headerSection(rawResponse.data(), headerEndPos);
     response.body = rawResponse.substr(headerEndPos + 4); // +4 to skip \r\n\r\n
     
     // Parse headers line by line
-    std::istringstream headerStream(headerSection);
-    std::string line;
+    size_t lineStart = 0;
     bool isFirstLine = true;
     
-    while (std::getline(headerStream, line)) {
-        // Remove \r if present (since getline only removes \n)
-        if (!line.empty() && line.back() == '\r') {
-            line.pop_back();
+    while (lineStart < headerSection.length()) {
+        size_t lineLength = scanForCrlf(headerSection.data() + lineStart,
+                                        headerSection.length() - lineStart);
+        if (lineLength == std::string::npos) {
+            lineLength = headerSection.length() - lineStart;
         }
+        std::string line(headerSection.substr(lineStart, lineLength));
+        lineStart += lineLength + 2;
         
         if (isFirstLine) {
             // Parse status line: HTTP/1.1 200 OK
-            std::istringstream statusStream(line);
-            statusStream >> response.httpVersion >> response.statusCode;
-            
-            // Get the reason phrase (everything after status code)
-            std::string word;
-            response.reasonPhrase = "";
-            while (statusStream >> word) {
-                if (!response.reasonPhrase.empty()) {
-                    response.reasonPhrase += " ";
-                }
-                response.reasonPhrase += word;
+            std::string_view version;
+            std::string_view reason;
+            if (!splitStatusLine(line, version, response.statusCode, reason)) {
+                response.errorKind = HttpError::Protocol;
+                response.errorMessage = "Invalid status line format";
+                return response;
             }
+            response.httpVersion.assign(version);
+            response.reasonPhrase.assign(reason);
             
             isFirstLine = false;
         } else {
             // Parse header: Key: Value
-            size_t colonPos = line.find(':');
+            size_t colonPos = scanForByte(line.data(), line.length(), ':');
             if (colonPos != std::string::npos) {
                 std::string key = line.substr(0, colonPos);
                 std::string value = line.substr(colonPos + 1);
@@ -98,11 +90,12 @@ HttpResponse parseHttpResponse(const std::string& rawResponse) {
                     value = "";
                 }
                 
-                response.headers[key] = value;
+                response.headers.add(key, value);
             }
         }
     }
     
+    response.isSuccess = true;
     return response;
 }
 
@@ -113,8 +106,8 @@ void printHttpResponse(const HttpResponse& response) {
               << response.statusCode << " " << response.reasonPhrase << std::endl;
     
     std::cout << "\nHeaders:" << std::endl;
-    for (const auto& header : response.headers) {
-        std::cout << "  " << header.first << ": " << header.second << std::endl;
+    for (const HeaderTable::Field& header : response.headers) {
+        std::cout << "  " << header.name << ": " << header.value << std::endl;
     }
     
     std::cout << "\nBody length: " << response.body.length() << " bytes" << std::endl;
@@ -9,15 +9,6 @@
 #include "request/receive_request.h"
 #include "request/send_request.h"
 #include "socket/socket.h"
-// Structure to hold parsed HTTP response
-struct HttpResponse {
-    std::string httpVersion;
-    int statusCode;
-    std::string reasonPhrase;
-    std::map<std::string, std::string> headers;
-    std::string body;
-};
-
 
 int main() {
     std::string hostname = "example.com";
@@ -0,0 +1,242 @@
+#include "request/request_body.h"
+#include "request/request_builder.h"
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+// Largest single sendfile/splice call; keeps each call well inside ssize_t
+const size_t kMaxTransfer = 1 << 30;
+const size_t kChunkSize = 64 * 1024;
+
+// sendfile and splice have no MSG_NOSIGNAL. Block SIGPIPE on this thread
+// for the duration and swallow one raised by a peer that went away, so a
+// closed connection is reported as EPIPE like it is for send.
+class SigpipeGuard {
+public:
+    SigpipeGuard() {
+        sigemptyset(&pipeSet);
+        sigaddset(&pipeSet, SIGPIPE);
+        sigset_t pending;
+        sigpending(&pending);
+        alreadyPending = sigismember(&pending, SIGPIPE) == 1;
+        pthread_sigmask(SIG_BLOCK, &pipeSet, &previous);
+    }
+
+    ~SigpipeGuard() {
+        if (!alreadyPending) {
+            sigset_t pending;
+            sigpending(&pending);
+            if (sigismember(&pending, SIGPIPE) == 1) {
+                timespec zero = {0, 0};
+                while (sigtimedwait(&pipeSet, nullptr, &zero) == -1 && errno == EINTR) {
+                }
+            }
+        }
+        pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+    }
+
+private:
+    sigset_t pipeSet;
+    sigset_t previous;
+    bool alreadyPending;
+};
+
+ssize_t transferFile(int sockfd, int fd, bool pipe, off_t position, size_t count) {
+    count = std::min(count, kMaxTransfer);
+    if (pipe) {
+        return splice(fd, nullptr, sockfd, nullptr, count, SPLICE_F_MOVE | SPLICE_F_MORE);
+    }
+    return sendfile(sockfd, fd, &position, count);
+}
+
+void setError(std::string* error, const std::string& reason) {
+    if (error != nullptr) {
+        *error = reason;
+    }
+}
+
+void setErrorKind(HttpError* errorKind, HttpError value) {
+    if (errorKind != nullptr) {
+        *errorKind = value;
+    }
+}
+
+} // namespace
+
+const size_t RequestBody::npos;
+
+RequestBody::FileHandle::~FileHandle() {
+    if (owned && fd != -1) {
+        close(fd);
+    }
+}
+
+RequestBody::RequestBody() : kind(Kind::Empty), offset(0), length(0) {}
+
+RequestBody::RequestBody(std::string data)
+    : kind(data.empty() ? Kind::Empty : Kind::Buffer), data(std::move(data)), offset(0), length(0) {
+    length = this->data.length();
+}
+
+RequestBody::RequestBody(const char* data) : RequestBody(std::string(data)) {}
+
+RequestBody RequestBody::fromFile(int fd, off_t offset, size_t length) {
+    RequestBody body;
+    body.kind = Kind::File;
+    body.offset = offset;
+
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) == -1) {
+        body.error = std::string("Cannot read request body: ") + strerror(fd < 0 ? EBADF : errno);
+        return body;
+    }
+    bool pipe = S_ISFIFO(info.st_mode);
+    body.file = std::make_shared<FileHandle>(FileHandle{fd, false, pipe});
+
+    if (length == npos) {
+        if (pipe || !S_ISREG(info.st_mode)) {
+            body.error = "Cannot read request body: the length of a pipe or device must be given";
+            return body;
+        }
+        length = info.st_size > offset ? static_cast<size_t>(info.st_size - offset) : 0;
+    }
+    body.length = length;
+    return body;
+}
+
+RequestBody RequestBody::fromPath(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        RequestBody body;
+        body.kind = Kind::File;
+        body.error = "Cannot open " + path + ": " + strerror(errno);
+        return body;
+    }
+
+    RequestBody body = fromFile(fd);
+    if (body.file) {
+        body.file->owned = true;
+    } else {
+        close(fd);
+    }
+    return body;
+}
+
+RequestBody RequestBody::fromGenerator(Generator generator) {
+    RequestBody body;
+    body.kind = Kind::Generator;
+    body.generator = std::make_shared<Generator>(std::move(generator));
+    return body;
+}
+
+bool RequestBody::sendTo(int sockfd, std::string* error, HttpError* errorKind) const {
+    if (hasError()) {
+        setError(error, this->error);
+        setErrorKind(errorKind, HttpError::InvalidRequest);
+        return false;
+    }
+
+    switch (kind) {
+        case Kind::Empty:
+            return true;
+        case Kind::Buffer:
+            if (!writeSegments(sockfd, {iovec{const_cast<char*>(data.data()), data.length()}})) {
+                setErrorKind(errorKind, writeFailureKind(errno));
+                setError(error, std::string("Failed to send request body: ") + strerror(errno));
+                return false;
+            }
+            return true;
+        case Kind::File:
+            return sendFile(sockfd, error, errorKind);
+        case Kind::Generator:
+            return sendChunked(sockfd, error, errorKind);
+    }
+    return false;
+}
+
+ssize_t RequestBody::sendFrom(int sockfd, size_t offset) const {
+    if (offset >= length) {
+        return 0;
+    }
+    if (kind == Kind::Buffer) {
+        return send(sockfd, data.data() + offset, length - offset, MSG_NOSIGNAL);
+    }
+    if (kind != Kind::File || !file) {
+        errno = ENOTSUP;
+        return -1;
+    }
+
+    // A pipe has no position of its own: it is consumed in order
+    SigpipeGuard guard;
+    return transferFile(sockfd, file->fd, file->pipe, this->offset + static_cast<off_t>(offset), length - offset);
+}
+
+// Private helper methods
+bool RequestBody::sendFile(int sockfd, std::string* error, HttpError* errorKind) const {
+    SigpipeGuard guard;
+    size_t sent = 0;
+    while (sent < length) {
+        ssize_t n = transferFile(sockfd, file->fd, file->pipe, offset + static_cast<off_t>(sent), length - sent);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            setErrorKind(errorKind, writeFailureKind(errno));
+            setError(error, std::string("Failed to send request body: ") + strerror(errno));
+            return false;
+        }
+        if (n == 0) {
+            // The declared Content-Length can no longer be honoured
+            setErrorKind(errorKind, HttpError::Send);
+            setError(error, "Request body file ended " + std::to_string(length - sent) + " bytes early");
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool RequestBody::sendChunked(int sockfd, std::string* error, HttpError* errorKind) const {
+    std::unique_ptr<char[]> buffer(new char[kChunkSize]);
+    char sizeLine[24];
+    char crlf[] = "\r\n";
+    char lastChunk[] = "0\r\n\r\n";
+
+    while (true) {
+        ssize_t produced = (*generator)(buffer.get(), kChunkSize);
+        if (produced < 0) {
+            setErrorKind(errorKind, HttpError::Send);
+            setError(error, "Request body generator failed");
+            return false;
+        }
+        if (produced == 0) {
+            break;
+        }
+
+        size_t count = std::min(static_cast<size_t>(produced), kChunkSize);
+        int sizeLength = std::snprintf(sizeLine, sizeof sizeLine, "%zx\r\n", count);
+        if (!writeSegments(sockfd, {iovec{sizeLine, static_cast<size_t>(sizeLength)},
+                                    iovec{buffer.get(), count},
+                                    iovec{crlf, 2}})) {
+            setErrorKind(errorKind, writeFailureKind(errno));
+            setError(error, std::string("Failed to send request body: ") + strerror(errno));
+            return false;
+        }
+    }
+
+    if (!writeSegments(sockfd, {iovec{lastChunk, sizeof lastChunk - 1}})) {
+        setErrorKind(errorKind, writeFailureKind(errno));
+        setError(error, std::string("Failed to send request body: ") + strerror(errno));
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,205 @@
+#include "request/request_builder.h"
+#include "request/http_scan.h"
+#include <sys/socket.h>
+#include <cerrno>
+#include <climits>
+#include <algorithm>
+
+namespace {
+
+const size_t kMaxSegments = IOV_MAX;
+
+ssize_t sendSegments(int sockfd, iovec* segments, size_t count) {
+    msghdr message = {};
+    message.msg_iov = segments;
+    message.msg_iovlen = std::min(count, kMaxSegments);
+    return sendmsg(sockfd, &message, MSG_NOSIGNAL);
+}
+
+bool hasHeader(const HeaderList& headers, std::string_view name) {
+    for (const auto& header : headers) {
+        if (equalsIgnoreCaseAscii(header.first, name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool expectsBody(std::string_view method) {
+    return method == "POST" || method == "PUT" || method == "PATCH";
+}
+
+} // namespace
+
+RequestTemplate::RequestTemplate(const std::string& hostname, int port, const HeaderList& defaults) {
+    std::string host = hostname.find(':') == std::string::npos ? hostname : "[" + hostname + "]";
+    if (port != 80) {
+        host += ":" + std::to_string(port);
+    }
+
+    HeaderList all;
+    all.reserve(defaults.size() + 1);
+    all.emplace_back("Host", host);
+    all.insert(all.end(), defaults.begin(), defaults.end());
+
+    for (const auto& header : all) {
+        size_t offset = block.length();
+        block += header.first;
+        block += ": ";
+        block += header.second;
+        block += "\r\n";
+        lines.emplace_back(offset, block.length() - offset);
+        names.push_back(header.first);
+    }
+}
+
+HeaderList RequestTemplate::defaultHeaders() {
+    return {
+        {"User-Agent", "SimpleHTTPClient/1.0"},
+        {"Accept", "*/*"},
+        {"Accept-Encoding", "gzip, deflate"},
+        {"Connection", "keep-alive"},
+    };
+}
+
+void RequestTemplate::build(std::string_view method, std::string_view path, const HeaderList& headers,
+                            const RequestBody& body, bool expectContinue, OutgoingRequest& out) const {
+    out.clear();
+
+    out.head.reserve(method.length() + path.length() + 12);
+    out.head.append(method).append(" ").append(path).append(" HTTP/1.1\r\n");
+
+    for (const auto& header : headers) {
+        out.headers.append(header.first).append(": ").append(header.second).append("\r\n");
+    }
+    bool framed = hasHeader(headers, "Content-Length") || hasHeader(headers, "Transfer-Encoding");
+    if (!framed && !body.hasLength()) {
+        out.headers.append("Transfer-Encoding: chunked\r\n");
+    } else if (!framed && (!body.empty() || expectsBody(method))) {
+        out.headers.append("Content-Length: ").append(std::to_string(body.getLength())).append("\r\n");
+    }
+    expectContinue = expectContinue && !body.empty();
+    if (expectContinue && !hasHeader(headers, "Expect")) {
+        out.headers.append("Expect: 100-continue\r\n");
+    }
+    out.headers.append("\r\n");
+
+    out.append(out.head.data(), out.head.length());
+
+    // The cached block goes out whole unless the request overrides one of its lines
+    size_t runStart = 0;
+    size_t runLength = 0;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (!headers.empty() && hasHeader(headers, names[i])) {
+            out.append(block.data() + runStart, runLength);
+            runStart = lines[i].first + lines[i].second;
+            runLength = 0;
+        } else {
+            runLength += lines[i].second;
+        }
+    }
+    out.append(block.data() + runStart, runLength);
+
+    out.append(out.headers.data(), out.headers.length());
+    if (body.isInline() && !expectContinue) {
+        out.append(body.getData().data(), body.getData().length());
+    } else {
+        out.bodyPending = !body.empty();
+    }
+}
+
+void OutgoingRequest::clear() {
+    head.clear();
+    headers.clear();
+    segments.clear();
+    totalBytes = 0;
+    bodyPending = false;
+}
+
+std::string OutgoingRequest::toString() const {
+    std::string flat;
+    flat.reserve(totalBytes);
+    for (const iovec& segment : segments) {
+        flat.append(static_cast<const char*>(segment.iov_base), segment.iov_len);
+    }
+    return flat;
+}
+
+bool OutgoingRequest::sendAll(int sockfd, HttpError* errorKind) const {
+    if (writeSegments(sockfd, segments)) {
+        return true;
+    }
+    if (errorKind != nullptr) {
+        *errorKind = writeFailureKind(errno);
+    }
+    return false;
+}
+
+ssize_t OutgoingRequest::sendFrom(int sockfd, size_t offset) const {
+    // Skip the segments already written and trim the first partial one
+    size_t first = 0;
+    while (first < segments.size() && offset >= segments[first].iov_len) {
+        offset -= segments[first].iov_len;
+        ++first;
+    }
+    if (first == segments.size()) {
+        return 0;
+    }
+
+    iovec pending[kMaxSegments];
+    size_t count = std::min(segments.size() - first, kMaxSegments);
+    std::copy(segments.begin() + first, segments.begin() + first + count, pending);
+    pending[0].iov_base = static_cast<char*>(pending[0].iov_base) + offset;
+    pending[0].iov_len -= offset;
+    return sendSegments(sockfd, pending, count);
+}
+
+void OutgoingRequest::segmentsFrom(size_t offset, std::vector<iovec>& out) const {
+    out.clear();
+    for (const iovec& segment : segments) {
+        if (offset >= segment.iov_len) {
+            offset -= segment.iov_len;
+            continue;
+        }
+        out.push_back(iovec{static_cast<char*>(segment.iov_base) + offset, segment.iov_len - offset});
+        offset = 0;
+    }
+}
+
+// Private helper methods
+void OutgoingRequest::append(const char* data, size_t length) {
+    if (length == 0) {
+        return;
+    }
+    segments.push_back(iovec{const_cast<char*>(data), length});
+    totalBytes += length;
+}
+
+bool writeSegments(int sockfd, std::vector<iovec> segments) {
+    size_t first = 0;
+    while (first < segments.size()) {
+        ssize_t n = sendSegments(sockfd, segments.data() + first, segments.size() - first);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        // A partial write can stop anywhere, including mid-segment
+        size_t written = static_cast<size_t>(n);
+        while (first < segments.size() && written >= segments[first].iov_len) {
+            written -= segments[first].iov_len;
+            ++first;
+        }
+        if (written > 0) {
+            segments[first].iov_base = static_cast<char*>(segments[first].iov_base) + written;
+            segments[first].iov_len -= written;
+        }
+    }
+    return true;
+}
+
+HttpError writeFailureKind(int error) {
+    return error == EAGAIN || error == EWOULDBLOCK ? HttpError::Timeout : HttpError::Send;
+}
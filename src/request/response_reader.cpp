@@ -0,0 +1,463 @@
+#include "request/response_reader.h"
+#include "request/http_scan.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <poll.h>
+#include <sys/socket.h>
+
+namespace {
+
+const size_t kMaxHeaderBytes = 64 * 1024;
+
+// Wait for a socket to become readable (or fail) until a deadline
+bool waitReadable(int sockfd, std::chrono::steady_clock::time_point until) {
+    typedef std::chrono::steady_clock Clock;
+    while (true) {
+        int timeoutMs = -1;
+        if (until != Clock::time_point::max()) {
+            long long remaining = std::chrono::ceil<std::chrono::milliseconds>(until - Clock::now()).count();
+            if (remaining <= 0) {
+                return false;
+            }
+            timeoutMs = static_cast<int>(std::min<long long>(remaining, std::numeric_limits<int>::max()));
+        }
+        pollfd poller = {sockfd, POLLIN, 0};
+        int ready = poll(&poller, 1, timeoutMs);
+        if (ready == -1 && errno == EINTR) {
+            continue;
+        }
+        // An error is left for the next recv to report
+        return ready != 0;
+    }
+}
+
+std::string_view trimWhitespace(std::string_view value) {
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+        value.remove_prefix(1);
+    }
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+        value.remove_suffix(1);
+    }
+    return value;
+}
+
+// A Content-Length value is digits only and must fit in a signed length
+bool parseContentLength(std::string_view value, unsigned long long& length) {
+    value = trimWhitespace(value);
+    if (value.empty()) {
+        return false;
+    }
+    const char* end = value.data() + value.size();
+    std::from_chars_result parsed = std::from_chars(value.data(), end, length);
+    return parsed.ec == std::errc() && parsed.ptr == end &&
+           length <= static_cast<unsigned long long>(std::numeric_limits<long long>::max());
+}
+
+} // namespace
+
+ResponseReader::ResponseReader(bool headRequest) : dechunkInPlace(false), bodySink(nullptr) {
+    reset(headRequest);
+}
+
+void ResponseReader::reset(bool headRequest) {
+    state = State::Headers;
+    framing = Framing::None;
+    this->headRequest = headRequest;
+    connectionClose = false;
+    http11 = false;
+    statusCode = 0;
+    headerLength = 0;
+    cursor = 0;
+    scanFrom = 0;
+    bytesRemaining = 0;
+    contentLength = -1;
+    bodyBytes = 0;
+    bodyDechunked = false;
+    chunkedDecoder.reset();
+    firstByteTime = Clock::time_point();
+    headersTime = Clock::time_point();
+    completeTime = Clock::time_point();
+    message.clear();
+    error.clear();
+    errorKind = HttpError::None;
+}
+
+size_t ResponseReader::feed(const char* data, size_t length) {
+    if (state == State::Complete || state == State::Error) {
+        return 0;
+    }
+
+    if (length > 0 && firstByteTime == Clock::time_point()) {
+        firstByteTime = Clock::now();
+    }
+    message.append(data, length);
+    advance();
+    if (state == State::Complete) {
+        completeTime = Clock::now();
+    }
+
+    if (bodySink != nullptr && headerLength != 0 && cursor > headerLength) {
+        // Streamed body bytes and chunk framing have been handled; drop them
+        message.erase(headerLength, cursor - headerLength);
+        cursor = headerLength;
+    }
+
+    if (state == State::Complete && cursor < message.length()) {
+        // Whatever follows the end of this message belongs to the next one
+        size_t excess = message.length() - cursor;
+        message.resize(cursor);
+        return length - excess;
+    }
+    return length;
+}
+
+void ResponseReader::finish() {
+    if (state == State::UntilClose) {
+        state = State::Complete;
+        completeTime = Clock::now();
+    } else if (state != State::Complete && state != State::Error) {
+        fail(message.empty() ? "Connection closed before any response was received"
+                             : "Connection closed before the end of the response",
+             HttpError::Receive);
+    }
+}
+
+void ResponseReader::timeOut(const std::string& reason) {
+    if (state != State::Complete && state != State::Error) {
+        fail(reason, HttpError::Timeout);
+    }
+}
+
+bool ResponseReader::isKeepAlive() const {
+    return state == State::Complete && http11 && !connectionClose &&
+           framing != Framing::CloseDelimited;
+}
+
+std::string ResponseReader::takeMessage() {
+    std::string taken;
+    taken.swap(message);
+    return taken;
+}
+
+// Private helper methods
+size_t ResponseReader::findLineEnd() const {
+    size_t end = scanForCrlf(message.data() + cursor, message.length() - cursor);
+    return end == std::string::npos ? end : cursor + end;
+}
+
+void ResponseReader::advance() {
+    while (true) {
+        switch (state) {
+            case State::Headers: {
+                size_t start = scanFrom > 3 ? scanFrom - 3 : 0;
+                size_t end = scanForHeaderEnd(message.data() + start, message.length() - start);
+                if (end == std::string::npos) {
+                    scanFrom = message.length();
+                    if (message.length() > kMaxHeaderBytes) {
+                        fail("Response header block too large");
+                    }
+                    return;
+                }
+                headerLength = start + end + 4;
+                if (!parseHeaderBlock()) {
+                    return;
+                }
+                cursor = headerLength;
+                if (headerLength != 0) {
+                    headersTime = Clock::now();
+                    if (headersCallback) {
+                        headersCallback(*this);
+                    }
+                }
+                break;
+            }
+
+            case State::Body: {
+                size_t take = std::min(bytesRemaining, message.length() - cursor);
+                if (!consumeBody(take)) {
+                    return;
+                }
+                bytesRemaining -= take;
+                if (bytesRemaining > 0) {
+                    return;
+                }
+                state = State::Complete;
+                break;
+            }
+
+            case State::Chunked: {
+                if (dechunkInPlace && bodySink == nullptr) {
+                    // Move payload over the chunk framing so message holds the decoded body
+                    size_t decoded = 0;
+                    size_t used = chunkedDecoder.decodeInPlace(&message[cursor], message.length() - cursor, decoded);
+                    message.erase(cursor + decoded, used - decoded);
+                    bodyBytes += decoded;
+                    cursor += decoded;
+                    bodyDechunked = true;
+                } else {
+                    payload.clear();
+                    size_t used = chunkedDecoder.decode(message.data() + cursor, message.length() - cursor, payload);
+                    for (const iovec& slice : payload) {
+                        if (!deliver(static_cast<const char*>(slice.iov_base), slice.iov_len)) {
+                            return;
+                        }
+                    }
+                    cursor += used;
+                }
+                if (chunkedDecoder.hasError()) {
+                    fail(chunkedDecoder.getError());
+                    return;
+                }
+                if (chunkedDecoder.isComplete()) {
+                    state = State::Complete;
+                }
+                return;
+            }
+
+            case State::UntilClose:
+                consumeBody(message.length() - cursor);
+                return;
+
+            case State::Complete:
+            case State::Error:
+                return;
+        }
+    }
+}
+
+bool ResponseReader::parseHeaderBlock() {
+    // Status line: HTTP/1.1 200 OK
+    size_t lineEnd = scanForCrlf(message.data(), headerLength);
+    if (message.compare(0, 5, "HTTP/") != 0 || lineEnd < 12) {
+        fail("Invalid status line");
+        return false;
+    }
+    http11 = message.compare(0, 9, "HTTP/1.1 ") == 0;
+    statusCode = std::atoi(message.c_str() + 9);
+    if (statusCode < 100 || statusCode > 999) {
+        fail("Invalid status code");
+        return false;
+    }
+
+    bool hasTransferEncoding = false;
+    std::string finalCoding;  // the last coding across every Transfer-Encoding header
+    bool hasContentLength = false;
+    bool keepAliveRequested = false;
+    unsigned long long declaredLength = 0;
+
+    size_t pos = lineEnd + 2;
+    while (pos < headerLength - 2) {
+        size_t end = pos + scanForCrlf(message.data() + pos, headerLength - pos);
+        size_t colon = scanForByte(message.data() + pos, end - pos, ':');
+        if (colon != std::string::npos) {
+            std::string_view name(message.data() + pos, colon);
+            size_t valueStart = message.find_first_not_of(" \t", pos + colon + 1);
+            std::string value = valueStart < end ? message.substr(valueStart, end - valueStart) : "";
+
+            if (equalsIgnoreCaseAscii(name, "content-length")) {
+                unsigned long long length = 0;
+                if (!parseContentLength(value, length)) {
+                    fail("Invalid Content-Length header");
+                    return false;
+                }
+                // Differing lengths leave the message boundary ambiguous (RFC 9112 section 6.3)
+                if (hasContentLength && length != declaredLength) {
+                    fail("Conflicting Content-Length headers");
+                    return false;
+                }
+                declaredLength = length;
+                hasContentLength = true;
+            } else if (equalsIgnoreCaseAscii(name, "transfer-encoding")) {
+                std::string_view coding = lastListEntry(value);
+                if (!coding.empty()) {
+                    finalCoding.assign(coding);
+                }
+                hasTransferEncoding = true;
+            } else if (equalsIgnoreCaseAscii(name, "connection")) {
+                connectionClose = findIgnoreCaseAscii(value, "close") != std::string::npos;
+                keepAliveRequested = findIgnoreCaseAscii(value, "keep-alive") != std::string::npos;
+            }
+        }
+        pos = end + 2;
+    }
+
+    // HTTP/1.0 connections only persist when the server explicitly says so
+    if (!http11 && !keepAliveRequested) {
+        connectionClose = true;
+    }
+
+    if (statusCode / 100 == 1 && statusCode != 101) {
+        // Interim response (e.g. 100 Continue): drop it and read the final one
+        message.erase(0, headerLength);
+        headerLength = 0;
+        scanFrom = 0;
+        connectionClose = false;
+        return true;
+    }
+
+    if (headRequest || statusCode / 100 == 1 || statusCode == 204 || statusCode == 304) {
+        framing = Framing::None;
+        state = State::Complete;
+    } else if (hasTransferEncoding) {
+        // Transfer-Encoding overrides any Content-Length (RFC 9112 section 6.3).
+        // Unless chunked is the final coding, only the close ends the body.
+        if (equalsIgnoreCaseAscii(finalCoding, "chunked")) {
+            framing = Framing::Chunked;
+            state = State::Chunked;
+        } else {
+            framing = Framing::CloseDelimited;
+            state = State::UntilClose;
+            connectionClose = true;
+        }
+    } else if (hasContentLength) {
+        framing = Framing::ContentLength;
+        contentLength = static_cast<long long>(declaredLength);
+        bytesRemaining = static_cast<size_t>(declaredLength);
+        state = State::Body;
+    } else {
+        framing = Framing::CloseDelimited;
+        state = State::UntilClose;
+    }
+    return true;
+}
+
+bool ResponseReader::consumeBody(size_t length) {
+    if (!deliver(message.data() + cursor, length)) {
+        return false;
+    }
+    cursor += length;
+    return true;
+}
+
+bool ResponseReader::deliver(const char* data, size_t length) {
+    if (length == 0) {
+        return true;
+    }
+    if (bodySink != nullptr && !bodySink->write(data, length)) {
+        fail("Body sink rejected the response body", HttpError::Receive);
+        return false;
+    }
+    bodyBytes += length;
+    return true;
+}
+
+void ResponseReader::fail(const std::string& reason, HttpError kind) {
+    state = State::Error;
+    error = reason;
+    errorKind = kind;
+}
+
+bool readHttpResponse(int sockfd, ResponseReader& reader, std::string& pending) {
+    return readHttpResponse(sockfd, reader, pending, ReadDeadline());
+}
+
+bool readHttpResponse(int sockfd, ResponseReader& reader) {
+    std::string pending;
+    return readHttpResponse(sockfd, reader, pending);
+}
+
+bool readHttpResponse(int sockfd, ResponseReader& reader, std::string& pending, const ReadDeadline& deadline) {
+    typedef ReadDeadline::Clock Clock;
+
+    if (!pending.empty()) {
+        size_t used = reader.feed(pending.data(), pending.length());
+        pending.erase(0, used);
+    }
+
+    // With a deadline, reads never block; the waiting happens in poll()
+    bool limited = deadline.isSet();
+    Clock::time_point lastProgress = Clock::now();
+    char buffer[16384];
+    while (!reader.isComplete() && !reader.hasError()) {
+        ssize_t bytesReceived = recv(sockfd, buffer, sizeof(buffer), limited ? MSG_DONTWAIT : 0);
+        if (bytesReceived == 0) {
+            reader.finish();
+            break;
+        }
+        if (bytesReceived < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (!limited || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                return false;
+            }
+
+            bool started = reader.getFirstByteTime() != Clock::time_point();
+            Clock::time_point until = deadline.complete;
+            if (!started) {
+                until = std::min(until, deadline.firstByte);
+            } else if (deadline.idle.count() > 0) {
+                until = std::min(until, lastProgress + deadline.idle);
+            }
+            if (!waitReadable(sockfd, until)) {
+                reader.timeOut(started ? "Timed out receiving the response" : "Timed out waiting for the response");
+                return false;
+            }
+            continue;
+        }
+
+        lastProgress = Clock::now();
+        size_t used = reader.feed(buffer, static_cast<size_t>(bytesReceived));
+        if (used < static_cast<size_t>(bytesReceived)) {
+            pending.append(buffer + used, bytesReceived - used);
+        }
+    }
+
+    return reader.isComplete();
+}
+
+ContinueResult awaitContinue(int sockfd, int timeoutMs, std::string& pending) {
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+    char buffer[4096];
+
+    while (true) {
+        // Consume complete interim responses; anything else is the final one
+        size_t blankLine = scanForHeaderEnd(pending.data(), pending.length());
+        while (blankLine != std::string::npos && pending.length() >= 12 && pending.compare(0, 5, "HTTP/") == 0) {
+            int statusCode = std::atoi(pending.c_str() + 9);
+            if (statusCode / 100 != 1 || statusCode == 101) {
+                return ContinueResult::FinalResponse;
+            }
+            pending.erase(0, blankLine + 4);
+            if (statusCode == 100) {
+                return ContinueResult::Continue;
+            }
+            blankLine = scanForHeaderEnd(pending.data(), pending.length());
+        }
+        if (pending.length() >= 5 && pending.compare(0, 5, "HTTP/") != 0) {
+            return ContinueResult::FinalResponse;  // not a status line; let the reader report it
+        }
+
+        int remaining = static_cast<int>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count());
+        if (remaining <= 0) {
+            return ContinueResult::Timeout;
+        }
+        pollfd poller = {sockfd, POLLIN, 0};
+        int ready = poll(&poller, 1, remaining);
+        if (ready == -1 && errno == EINTR) {
+            continue;
+        }
+        if (ready == 0) {
+            return ContinueResult::Timeout;
+        }
+        if (ready == -1) {
+            return ContinueResult::Closed;
+        }
+
+        ssize_t n = recv(sockfd, buffer, sizeof(buffer), 0);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return pending.empty() ? ContinueResult::Closed : ContinueResult::FinalResponse;
+        }
+        pending.append(buffer, static_cast<size_t>(n));
+    }
+}
@@ -5,6 +5,7 @@
 #include <netdb.h>      // For getaddrinfo
 #include <unistd.h>     // For close
 #include <sstream>      // For stringstream
+#include "request/request_builder.h"
 
 
 // New function to format an HTTP request
@@ -29,21 +30,10 @@ std::string formatHttpRequest(const std::string& hostname, const std::string& pa
 
 // New function to send an HTTP request
 bool sendHttpRequest(int sockfd, const std::string& request) {
-    // Send the request to the server
-    int total = 0;
-    int bytesleft = request.length();
-    int n;
-    
-    // Keep sending until all bytes are sent
-    while(total < request.length()) {
-        n = send(sockfd, request.c_str() + total, bytesleft, 0);
-        if (n == -1) { 
-            std::cerr << "Error sending request: " << strerror(errno) << std::endl;
-            return false; 
-        }
-        total += n;
-        bytesleft -= n;
+    // Resumes after partial writes and never raises SIGPIPE on a closed peer
+    if (!writeSegments(sockfd, {iovec{const_cast<char*>(request.data()), request.length()}})) {
+        std::cerr << "Error sending request: " << strerror(errno) << std::endl;
+        return false;
     }
-    
     return true;
 }
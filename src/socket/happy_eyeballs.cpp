@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <vector>
+#include <fcntl.h>      // For fcntl
+#include <poll.h>       // For poll
+#include <sys/socket.h> // For socket functions
+#include <unistd.h>     // For close
+#include "socket/socket.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Attempt {
+    int sockfd;
+    Clock::time_point deadline;
+};
+
+// RFC 8305 section 4: alternate address families, starting with IPv6
+std::vector<ResolvedAddress> interleaveFamilies(const std::vector<ResolvedAddress>& addresses) {
+    std::vector<ResolvedAddress> v6, v4, ordered;
+    for (const ResolvedAddress& address : addresses) {
+        (address.family() == AF_INET6 ? v6 : v4).push_back(address);
+    }
+    for (size_t i = 0; i < std::max(v6.size(), v4.size()); ++i) {
+        if (i < v6.size()) ordered.push_back(v6[i]);
+        if (i < v4.size()) ordered.push_back(v4[i]);
+    }
+    return ordered;
+}
+
+int millisecondsUntil(Clock::time_point when, Clock::time_point now) {
+    if (when <= now) {
+        return 0;
+    }
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(when - now).count();
+    return static_cast<int>(std::min<long long>(ms + 1, 60 * 60 * 1000));
+}
+
+} // namespace
+
+int connectToAddresses(const std::vector<ResolvedAddress>& addresses, int port,
+                       const ConnectOptions& options) {
+    std::vector<ResolvedAddress> candidates = interleaveFamilies(addresses);
+    std::vector<Attempt> attempts;
+    size_t next = 0;
+    int lastError = ECONNREFUSED;
+    int winner = -1;
+
+    Clock::time_point start = Clock::now();
+    Clock::time_point overallDeadline = start + options.overallTimeout;
+    Clock::time_point nextStart = start;
+
+    while (winner == -1) {
+        Clock::time_point now = Clock::now();
+
+        // Step 1: Start another attempt when the previous one had its head
+        // start, or right away when nothing is in flight
+        while (next < candidates.size() && (attempts.empty() || now >= nextStart)) {
+            ResolvedAddress address = candidates[next++].withPort(port);
+            int sockfd = socket(address.family(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (sockfd == -1) {
+                lastError = errno;
+                continue;
+            }
+
+            if (connect(sockfd, address.sockaddrPtr(), address.length) == 0) {
+                winner = sockfd;
+                break;
+            }
+            if (errno != EINPROGRESS) {
+                lastError = errno;
+                close(sockfd);
+                continue;
+            }
+
+            attempts.push_back(Attempt{sockfd, now + options.attemptTimeout});
+            nextStart = now + options.attemptDelay;
+        }
+        if (winner != -1) {
+            break;
+        }
+
+        if (attempts.empty()) {
+            break;  // every address failed outright
+        }
+        if (now >= overallDeadline) {
+            lastError = ETIMEDOUT;
+            break;
+        }
+
+        // Step 2: Wait for a result, the next stagger point, or a deadline
+        Clock::time_point wakeAt = overallDeadline;
+        if (next < candidates.size()) {
+            wakeAt = std::min(wakeAt, nextStart);
+        }
+        std::vector<pollfd> fds;
+        for (const Attempt& attempt : attempts) {
+            wakeAt = std::min(wakeAt, attempt.deadline);
+            fds.push_back(pollfd{attempt.sockfd, POLLOUT, 0});
+        }
+
+        int ready = poll(fds.data(), fds.size(), millisecondsUntil(wakeAt, now));
+        if (ready == -1 && errno != EINTR) {
+            lastError = errno;
+            break;
+        }
+
+        // Step 3: Collect finished and expired attempts
+        now = Clock::now();
+        std::vector<Attempt> stillPending;
+        for (size_t i = 0; i < attempts.size(); ++i) {
+            if (winner == -1 && fds[i].revents != 0) {
+                int error = 0;
+                socklen_t length = sizeof error;
+                if (getsockopt(attempts[i].sockfd, SOL_SOCKET, SO_ERROR, &error, &length) == -1) {
+                    error = errno;
+                }
+                if (error == 0) {
+                    winner = attempts[i].sockfd;
+                    continue;
+                }
+                lastError = error;
+                close(attempts[i].sockfd);
+                nextStart = now;  // a failure lets the next address go immediately
+                continue;
+            }
+            if (winner == -1 && now >= attempts[i].deadline) {
+                lastError = ETIMEDOUT;
+                close(attempts[i].sockfd);
+                nextStart = now;
+                continue;
+            }
+            stillPending.push_back(attempts[i]);
+        }
+        attempts.swap(stillPending);
+    }
+
+    // Cancel the attempts that lost the race
+    for (const Attempt& attempt : attempts) {
+        if (attempt.sockfd != winner) {
+            close(attempt.sockfd);
+        }
+    }
+
+    if (winner == -1) {
+        errno = lastError;
+        return -1;
+    }
+
+    // Callers use the socket with blocking I/O
+    int flags = fcntl(winner, F_GETFL, 0);
+    fcntl(winner, F_SETFL, flags & ~O_NONBLOCK);
+    return winner;
+}
@@ -0,0 +1,334 @@
+#include "socket/resolver.h"
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+
+ResolvedAddress ResolvedAddress::withPort(int port) const {
+    ResolvedAddress copy = *this;
+    if (copy.address.ss_family == AF_INET) {
+        reinterpret_cast<sockaddr_in*>(&copy.address)->sin_port = htons(static_cast<uint16_t>(port));
+    } else if (copy.address.ss_family == AF_INET6) {
+        reinterpret_cast<sockaddr_in6*>(&copy.address)->sin6_port = htons(static_cast<uint16_t>(port));
+    }
+    return copy;
+}
+
+std::string ResolvedAddress::toString() const {
+    char text[INET6_ADDRSTRLEN] = "";
+    if (address.ss_family == AF_INET) {
+        inet_ntop(AF_INET, &reinterpret_cast<const sockaddr_in*>(&address)->sin_addr, text, sizeof text);
+    } else if (address.ss_family == AF_INET6) {
+        inet_ntop(AF_INET6, &reinterpret_cast<const sockaddr_in6*>(&address)->sin6_addr, text, sizeof text);
+    }
+    return text;
+}
+
+std::string ResolveResult::errorMessage() const {
+    if (error != 0) {
+        return gai_strerror(error);
+    }
+    return addresses.empty() ? "no addresses" : "";
+}
+
+DnsResolver::DnsResolver(const ResolverOptions& options, LookupFunction lookup)
+    : options(options), lookup(std::move(lookup)), stopping(false) {
+    size_t threads = options.workerThreads == 0 ? 1 : options.workerThreads;
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back(&DnsResolver::workerLoop, this);
+    }
+}
+
+DnsResolver::~DnsResolver() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    // Answer anyone still waiting on a lookup that never ran
+    ResolveResult cancelled;
+    cancelled.error = EAI_AGAIN;
+    for (auto& pending : inFlight) {
+        pending.second->promise.set_value(cancelled);
+        for (ResolveCallback& callback : pending.second->callbacks) {
+            callback(cancelled);
+        }
+    }
+}
+
+ResolveResult DnsResolver::resolve(const std::string& hostname) {
+    return resolveAsync(hostname).get();
+}
+
+std::shared_future<ResolveResult> DnsResolver::resolveAsync(const std::string& hostname) {
+    ResolveResult result;
+    ResolvedAddress numeric;
+    if (parseNumericAddress(hostname, numeric)) {
+        result.addresses.push_back(numeric);
+        std::promise<ResolveResult> ready;
+        ready.set_value(result);
+        return ready.get_future().share();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (findCachedLocked(hostname, result)) {
+        std::promise<ResolveResult> ready;
+        ready.set_value(result);
+        return ready.get_future().share();
+    }
+    return startLookupLocked(hostname)->future;
+}
+
+void DnsResolver::resolveAsync(const std::string& hostname, ResolveCallback callback) {
+    ResolveResult result;
+    ResolvedAddress numeric;
+    if (parseNumericAddress(hostname, numeric)) {
+        result.addresses.push_back(numeric);
+        callback(result);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!findCachedLocked(hostname, result)) {
+            startLookupLocked(hostname)->callbacks.push_back(std::move(callback));
+            return;
+        }
+    }
+    callback(result);
+}
+
+void DnsResolver::preload(const std::string& hostname, const std::vector<ResolvedAddress>& addresses,
+                          std::chrono::seconds ttl) {
+    ResolveResult result;
+    result.addresses = addresses;
+    std::lock_guard<std::mutex> lock(mutex);
+    storeLocked(hostname, result, false, ttl);
+}
+
+void DnsResolver::pin(const std::string& hostname, const std::vector<ResolvedAddress>& addresses) {
+    ResolveResult result;
+    result.addresses = addresses;
+    std::lock_guard<std::mutex> lock(mutex);
+    storeLocked(hostname, result, true, std::chrono::seconds(0));
+}
+
+void DnsResolver::unpin(const std::string& hostname) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = cache.find(hostname);
+    if (it != cache.end() && it->second.pinned) {
+        eraseLocked(it);
+    }
+}
+
+int DnsResolver::loadHostsFile(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        return -1;
+    }
+
+    std::map<std::string, std::vector<ResolvedAddress>> entries;
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+
+        std::istringstream fields(line);
+        std::string addressText, name;
+        ResolvedAddress address;
+        if (!(fields >> addressText) || !parseNumericAddress(addressText, address)) {
+            continue;
+        }
+        while (fields >> name) {
+            entries[name].push_back(address);
+        }
+    }
+
+    for (const auto& entry : entries) {
+        pin(entry.first, entry.second);
+    }
+    return static_cast<int>(entries.size());
+}
+
+void DnsResolver::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    cache.clear();
+    expiryOrder.clear();
+}
+
+DnsResolver::Stats DnsResolver::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+ResolveResult DnsResolver::systemLookup(const std::string& hostname) {
+    ResolveResult result;
+    struct addrinfo hints, *servinfo, *p;
+
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_UNSPEC;     // Use IPv4 or IPv6, whichever
+    hints.ai_socktype = SOCK_STREAM;
+
+    result.error = getaddrinfo(hostname.c_str(), NULL, &hints, &servinfo);
+    if (result.error != 0) {
+        return result;
+    }
+
+    for (p = servinfo; p != NULL; p = p->ai_next) {
+        ResolvedAddress address;
+        memset(&address.address, 0, sizeof address.address);
+        memcpy(&address.address, p->ai_addr, p->ai_addrlen);
+        address.length = p->ai_addrlen;
+        result.addresses.push_back(address);
+    }
+
+    freeaddrinfo(servinfo);
+    if (result.addresses.empty()) {
+        result.error = EAI_NONAME;
+    }
+    return result;
+}
+
+bool DnsResolver::parseNumericAddress(const std::string& hostname, ResolvedAddress& address) {
+    memset(&address.address, 0, sizeof address.address);
+
+    sockaddr_in* v4 = reinterpret_cast<sockaddr_in*>(&address.address);
+    if (inet_pton(AF_INET, hostname.c_str(), &v4->sin_addr) == 1) {
+        v4->sin_family = AF_INET;
+        address.length = sizeof(sockaddr_in);
+        return true;
+    }
+
+    // Accept both "::1" and the bracketed URL form "[::1]"
+    std::string literal = hostname;
+    if (literal.size() > 2 && literal.front() == '[' && literal.back() == ']') {
+        literal = literal.substr(1, literal.size() - 2);
+    }
+    sockaddr_in6* v6 = reinterpret_cast<sockaddr_in6*>(&address.address);
+    if (inet_pton(AF_INET6, literal.c_str(), &v6->sin6_addr) == 1) {
+        v6->sin6_family = AF_INET6;
+        address.length = sizeof(sockaddr_in6);
+        return true;
+    }
+    return false;
+}
+
+std::shared_ptr<DnsResolver> DnsResolver::getDefault() {
+    static std::shared_ptr<DnsResolver> resolver = std::make_shared<DnsResolver>();
+    return resolver;
+}
+
+// Private helper methods
+bool DnsResolver::findCachedLocked(const std::string& hostname, ResolveResult& result) {
+    auto it = cache.find(hostname);
+    if (it == cache.end()) {
+        return false;
+    }
+    if (!it->second.pinned && Clock::now() >= it->second.expires) {
+        eraseLocked(it);
+        return false;
+    }
+
+    result = it->second.result;
+    if (result.ok()) {
+        stats.hits++;
+    } else {
+        stats.negativeHits++;
+    }
+    return true;
+}
+
+std::shared_ptr<DnsResolver::InFlight> DnsResolver::startLookupLocked(const std::string& hostname) {
+    auto existing = inFlight.find(hostname);
+    if (existing != inFlight.end()) {
+        stats.coalesced++;
+        return existing->second;
+    }
+
+    stats.misses++;
+    std::shared_ptr<InFlight> lookupState = std::make_shared<InFlight>();
+    lookupState->future = lookupState->promise.get_future().share();
+    inFlight[hostname] = lookupState;
+    work.push_back(hostname);
+    workAvailable.notify_one();
+    return lookupState;
+}
+
+void DnsResolver::storeLocked(const std::string& hostname, const ResolveResult& result, bool pinned,
+                              std::chrono::seconds ttl) {
+    // A pin outranks anything learned later: a lookup that was in flight when
+    // the name was pinned, or a preload
+    auto existing = cache.find(hostname);
+    if (!pinned && existing != cache.end() && existing->second.pinned) {
+        return;
+    }
+
+    if (existing != cache.end()) {
+        eraseLocked(existing);
+    } else if (cache.size() >= options.maxEntries) {
+        // Make room by dropping the unpinned entry closest to expiry
+        if (expiryOrder.empty()) {
+            return;
+        }
+        eraseLocked(cache.find(expiryOrder.begin()->second));
+    }
+
+    CacheEntry& entry = cache[hostname];
+    entry.result = result;
+    entry.pinned = pinned;
+    entry.expires = Clock::now() + ttl;
+    entry.expiry = pinned ? expiryOrder.end() : expiryOrder.emplace(entry.expires, hostname);
+}
+
+void DnsResolver::eraseLocked(std::map<std::string, CacheEntry>::iterator entry) {
+    if (!entry->second.pinned) {
+        expiryOrder.erase(entry->second.expiry);
+    }
+    cache.erase(entry);
+}
+
+void DnsResolver::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        workAvailable.wait(lock, [this]() { return stopping || !work.empty(); });
+        if (stopping) {
+            return;
+        }
+
+        std::string hostname = work.front();
+        work.pop_front();
+
+        lock.unlock();
+        ResolveResult result = lookup(hostname);
+        lock.lock();
+
+        std::chrono::seconds ttl = result.ttl.count() > 0 ? result.ttl
+                                 : result.ok()            ? options.positiveTtl
+                                                          : options.negativeTtl;
+        auto pinned = cache.find(hostname);
+        if (pinned != cache.end() && pinned->second.pinned) {
+            // Pinned while the lookup ran: the pin stands and the waiters get it
+            result = pinned->second.result;
+        } else if (ttl.count() > 0) {
+            storeLocked(hostname, result, false, ttl);
+        }
+
+        std::shared_ptr<InFlight> finished = inFlight[hostname];
+        inFlight.erase(hostname);
+
+        lock.unlock();
+        finished->promise.set_value(result);
+        for (ResolveCallback& callback : finished->callbacks) {
+            callback(result);
+        }
+        lock.lock();
+    }
+}